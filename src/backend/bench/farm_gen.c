@@ -0,0 +1,89 @@
+// Writes one synthetic request (see workload.h) to stdout, either a case of
+// the standard suite or a spec given on the command line. The scheduler
+// binaries and the JS bench read the same bytes.
+//
+//   gcc -O2 -o farm_gen farm_gen.c -lm
+//   ./farm_gen --case large | ../dp_scheduler.out
+//   ./farm_gen --seed 3 --fields 500 --max-need 800 --skew 2 --moisture dry
+//              --water-percent 35 --electricity 400 --delivery-rate 30
+//   ./farm_gen --list
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workload.h"
+
+static void listSuite(void) {
+    static const char *const moistureNames[] = {"uniform", "dry", "wet", "bimodal"};
+    for (int i = 0; i < WORKLOAD_SUITE_SIZE; i++) {
+        const WorkloadSpec *spec = &workloadSuite[i];
+        printf("%-14s seed=%llu fields=%d max_need=%d skew=%.1f moisture=%s water_percent=%d "
+               "electricity=%d delivery_rate=%d dp=%d greedy=%d brute_force=%d js=%d\n",
+               spec->name, (unsigned long long)spec->seed, spec->fieldCount, spec->maxNeed,
+               spec->skew, moistureNames[spec->moisture], spec->waterPercent,
+               spec->totalElectricity, spec->waterDeliveryRate,
+               (spec->schedulers & WORKLOAD_DP) != 0, (spec->schedulers & WORKLOAD_GREEDY) != 0,
+               (spec->schedulers & WORKLOAD_BRUTE_FORCE) != 0,
+               (spec->schedulers & WORKLOAD_JS) != 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    WorkloadSpec spec = {"custom", 1, 100, 500, 1.0, MOISTURE_UNIFORM, 40, 0, 0, WORKLOAD_ALL};
+    size_t length = 0;
+    char *text;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--list") == 0) {
+            listSuite();
+            return 0;
+        } else if (strcmp(argv[i], "--case") == 0 && value) {
+            const WorkloadSpec *found = workloadFind(value);
+            if (!found) {
+                fprintf(stderr, "Error: Unknown case %s (see --list)\n", value);
+                return 1;
+            }
+            spec = *found;
+        } else if (strcmp(argv[i], "--seed") == 0 && value) {
+            spec.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--fields") == 0 && value) {
+            spec.fieldCount = atoi(value);
+        } else if (strcmp(argv[i], "--max-need") == 0 && value) {
+            spec.maxNeed = atoi(value);
+        } else if (strcmp(argv[i], "--skew") == 0 && value) {
+            spec.skew = atof(value);
+        } else if (strcmp(argv[i], "--moisture") == 0 && value) {
+            if (!parseMoistureProfile(value, &spec.moisture)) {
+                fprintf(stderr, "Error: Moisture profile must be uniform, dry, wet or bimodal\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--water-percent") == 0 && value) {
+            spec.waterPercent = atoi(value);
+        } else if (strcmp(argv[i], "--electricity") == 0 && value) {
+            spec.totalElectricity = atoi(value);
+        } else if (strcmp(argv[i], "--delivery-rate") == 0 && value) {
+            spec.waterDeliveryRate = atoi(value);
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    if (spec.skew <= 0 || spec.waterPercent <= 0 || spec.totalElectricity < 0 ||
+        spec.waterDeliveryRate < 0) {
+        fprintf(stderr, "Error: Skew and water percent must be positive, electricity and "
+                        "delivery rate at least 0\n");
+        return 1;
+    }
+
+    text = workloadBuild(&spec, &length);
+    if (!text) {
+        fprintf(stderr, "Error: Fields and max need must be positive\n");
+        return 1;
+    }
+    fwrite(text, 1, length, stdout);
+    fputc('\n', stdout);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Rolling-horizon seasons, planned and advanced to the end. Each season is
+// a random request with a horizon, a season length and a seasonal
+// allocation; every day is advanced with readings for a few fields that
+// differ from the prediction. The water the committed days use must stay
+// within seasonWater, and a season that overruns it fails the run.
+//
+//   gcc -O2 -pthread -o horizon_bench horizon_bench.c -lm
+//   ./horizon_bench [seasons] [fieldCount]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/arena.h"
+#include "../core/dp.h"
+#include "../core/horizon.h"
+#include "../core/incremental.h"
+#include "../core/latency.h"
+
+static unsigned int nextRandom(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+static int randomRange(unsigned int *state, int low, int high) {
+    return low + (int)(nextRandom(state) % (unsigned int)(high - low + 1));
+}
+
+// A request with its horizon members; *seasonWater is what it allows.
+static char *buildSeason(unsigned int *state, int fieldCount, int *seasonWater,
+                         size_t *length) {
+    size_t capacity = 256 + (size_t)fieldCount * 80;
+    char *text = malloc(capacity);
+    int needs[4096];
+    int64_t totalNeed = 0;
+    size_t used;
+
+    if (!text || fieldCount > 4096) {
+        free(text);
+        return NULL;
+    }
+    for (int i = 0; i < fieldCount; i++) {
+        needs[i] = randomRange(state, 1, 300);
+        totalNeed += needs[i];
+    }
+    int totalWater = (int)(totalNeed * randomRange(state, 30, 90) / 100) + 1;
+    int days = randomRange(state, 2, 5);
+    int seasonDays = randomRange(state, days, 20);
+    *seasonWater = (int)((int64_t)totalWater * seasonDays * randomRange(state, 30, 90) / 100);
+
+    used = (size_t)snprintf(text, capacity,
+                            "{\"totalWater\":%d,\"fieldCount\":%d,\"horizonDays\":%d,"
+                            "\"seasonDays\":%d,\"seasonWater\":%d,\"dryingRate\":%d,\"fields\":[",
+                            totalWater, fieldCount, days, seasonDays, *seasonWater,
+                            randomRange(state, 2, 12));
+    for (int i = 0; i < fieldCount; i++) {
+        used += (size_t)snprintf(text + used, capacity - used,
+                                 "%s{\"name\":\"Field %d\",\"moisture\":%d,\"waterNeeded\":%d}",
+                                 i ? "," : "", i + 1, randomRange(state, 0, 90), needs[i]);
+    }
+    used += (size_t)snprintf(text + used, capacity - used, "]}");
+    *length = used;
+    return text;
+}
+
+int main(int argc, char **argv) {
+    int seasons = argc > 1 ? atoi(argv[1]) : 200;
+    int fieldCount = argc > 2 ? atoi(argv[2]) : 30;
+    DPOptions options;
+    FieldUpdate readings[8];
+    Horizon *horizon = malloc(sizeof(Horizon));
+    Arena arena;
+    unsigned int state = 5;
+    int64_t days = 0;
+    uint64_t micros = 0;
+    int overruns = 0;
+
+    if (!horizon || seasons <= 0 || fieldCount <= 0 || fieldCount > 4096) {
+        fprintf(stderr, "usage: horizon_bench [seasons] [fieldCount]\n");
+        return 1;
+    }
+    dpOptionsInit(&options);
+    arenaInit(&arena);
+    for (int s = 0; s < seasons; s++) {
+        int seasonWater;
+        size_t length;
+        char *request = buildSeason(&state, fieldCount, &seasonWater, &length);
+        int64_t committed = 0;
+        uint64_t start = monotonicMicros();
+
+        horizonInit(horizon, &options, INCREMENTAL_DEFAULT_ROW_BUDGET);
+        arenaReset(&arena);
+        if (!request || horizonStart(horizon, request, length, &arena) != INCREMENTAL_OK) {
+            fprintf(stderr, "could not start season %d\n", s);
+            return 1;
+        }
+        while (horizon->seasonDays > 1) {
+            int count = randomRange(&state, 0, 8);
+            for (int r = 0; r < count; r++) {
+                readings[r].index = randomRange(&state, 0, fieldCount - 1);
+                readings[r].moisture = randomRange(&state, 0, 100);
+                readings[r].waterNeeded = -1;
+            }
+            committed += horizon->used[0];
+            arenaReset(&arena);
+            if (horizonAdvance(horizon, readings, count, &arena) != INCREMENTAL_OK) {
+                fprintf(stderr, "could not advance season %d\n", s);
+                return 1;
+            }
+            days++;
+        }
+        committed += horizon->used[0];
+        days++;
+        micros += monotonicMicros() - start;
+        if (committed > seasonWater) {
+            printf("season=%d committed=%lld season_water=%d\n", s, (long long)committed,
+                   seasonWater);
+            overruns++;
+        }
+        horizonRelease(horizon);
+        free(request);
+    }
+
+    printf("seasons=%d fields=%d days=%lld mean_day_us=%.1f overruns=%d\n", seasons, fieldCount,
+           (long long)days, (double)micros / days, overruns);
+    arenaRelease(&arena);
+    free(horizon);
+    return overruns ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+// Incremental update latency against a full recompute. A session is started
+// from one request, then single-field sensor updates arrive, most of them
+// for a small set of fields that change often. Each update is applied to
+// the session and, for comparison, the updated request is scheduled from
+// scratch; the DP scores and the greedy schedules must match.
+//
+//   gcc -O2 -pthread -o incremental_bench incremental_bench.c
+//   ./incremental_bench [fieldCount] [totalWater] [updates] [hotPercent]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/arena.h"
+#include "../core/dp.h"
+#include "../core/farm.h"
+#include "../core/greedy.h"
+#include "../core/incremental.h"
+#include "../core/latency.h"
+
+static unsigned int nextRandom(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+static char *buildRequest(int fieldCount, int totalWater, size_t *length) {
+    size_t capacity = 128 + (size_t)fieldCount * 80;
+    char *text = malloc(capacity);
+    unsigned int seed = 7;
+    size_t used;
+
+    if (!text) return NULL;
+    used = (size_t)snprintf(text, capacity, "{\"totalWater\":%d,\"fieldCount\":%d,\"fields\":[",
+                            totalWater, fieldCount);
+    for (int i = 0; i < fieldCount; i++) {
+        used += (size_t)snprintf(text + used, capacity - used,
+                                 "%s{\"name\":\"Field %d\",\"moisture\":%d,\"waterNeeded\":%d}",
+                                 i ? "," : "", i, (int)(nextRandom(&seed) % 101),
+                                 (int)(nextRandom(&seed) % 400 + 1));
+    }
+    used += (size_t)snprintf(text + used, capacity - used, "]}");
+    *length = used;
+    return text;
+}
+
+static int compareMicros(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+static void report(const char *name, uint64_t *micros, int count) {
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) total += micros[i];
+    qsort(micros, (size_t)count, sizeof(uint64_t), compareMicros);
+    printf("%-18s updates=%d mean_us=%.1f p50_us=%llu p99_us=%llu\n", name, count,
+           (double)total / count, (unsigned long long)micros[count / 2],
+           (unsigned long long)micros[(size_t)count * 99 / 100]);
+}
+
+static double meanMicros(const uint64_t *micros, int count) {
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) total += micros[i];
+    return (double)total / count;
+}
+
+// The session's fields, copied so a full run cannot disturb the session.
+static IrrigationData copyRequest(const IrrigationData *source, Arena *arena) {
+    IrrigationData copy = *source;
+    copy.fields = arenaAlloc(arena, (size_t)source->fieldCount * sizeof(Field));
+    if (copy.fields) {
+        memcpy(copy.fields, source->fields, (size_t)source->fieldCount * sizeof(Field));
+        incrementalClearSchedule(&copy);
+    }
+    return copy;
+}
+
+int main(int argc, char **argv) {
+    int fieldCount = argc > 1 ? atoi(argv[1]) : 2000;
+    int totalWater = argc > 2 ? atoi(argv[2]) : 20000;
+    int updateCount = argc > 3 ? atoi(argv[3]) : 300;
+    int hotPercent = argc > 4 ? atoi(argv[4]) : 1;
+    size_t length = 0;
+    char *request = fieldCount > 0 && totalWater > 0 ? buildRequest(fieldCount, totalWater, &length)
+                                                     : NULL;
+    uint64_t *times = updateCount > 0 ? malloc((size_t)updateCount * 4 * sizeof(uint64_t)) : NULL;
+    int hotCount = fieldCount * hotPercent / 100 > 0 ? fieldCount * hotPercent / 100 : 1;
+    DPOptions options;
+    IncrementalDP dp;
+    IncrementalGreedy greedy;
+    Arena arena;
+    unsigned int seed = 11;
+    int64_t rows = 0;
+    int mismatches = 0;
+
+    if (!request || !times) {
+        fprintf(stderr,
+                "usage: incremental_bench [fieldCount] [totalWater] [updates] [hotPercent]\n");
+        return 1;
+    }
+    dpOptionsInit(&options);
+    incrementalDPInit(&dp, &options, INCREMENTAL_DEFAULT_ROW_BUDGET);
+    incrementalGreedyInit(&greedy);
+    arenaInit(&arena);
+    if (incrementalDPStart(&dp, request, length) != INCREMENTAL_OK ||
+        incrementalGreedyStart(&greedy, request, length) != INCREMENTAL_OK) {
+        fprintf(stderr, "could not start the sessions\n");
+        return 1;
+    }
+
+    uint64_t *dpUpdate = times;
+    uint64_t *dpFull = times + updateCount;
+    uint64_t *greedyUpdate = times + 2 * (size_t)updateCount;
+    uint64_t *greedyFull = times + 3 * (size_t)updateCount;
+    for (int u = 0; u < updateCount; u++) {
+        FieldUpdate update;
+        update.index = nextRandom(&seed) % 10 < 9 ? (int)(nextRandom(&seed) % hotCount)
+                                                  : (int)(nextRandom(&seed) % fieldCount);
+        update.moisture = (int)(nextRandom(&seed) % 101);
+        update.waterNeeded = nextRandom(&seed) % 4 == 0 ? (int)(nextRandom(&seed) % 400 + 1) : -1;
+
+        arenaReset(&arena);
+        incrementalDPUpdate(&dp, &update, 1, &arena);
+        dpUpdate[u] = dp.session.stats.updateMicros;
+        rows += dp.session.stats.rowsRun;
+
+        DPStats stats;
+        IrrigationData fresh = copyRequest(&dp.session.data, &arena);
+        uint64_t start = monotonicMicros();
+        if (!fresh.fields || !dpSchedule(&fresh, &options, &arena, &stats)) return 1;
+        dpFull[u] = monotonicMicros() - start;
+        if (stats.bestScore != dp.dpStats.bestScore) mismatches++;
+
+        incrementalGreedyUpdate(&greedy, &update, 1);
+        greedyUpdate[u] = greedy.session.stats.updateMicros;
+
+        // The session's copy already has the greedy defaults applied
+        arenaReset(&arena);
+        fresh = copyRequest(&greedy.session.data, &arena);
+        start = monotonicMicros();
+        const int *order = fresh.fields ? greedySchedule(&fresh, &arena) : NULL;
+        greedyFull[u] = monotonicMicros() - start;
+        if (!order) return 1;
+        for (int i = 0; i < fieldCount; i++) {
+            if (fresh.fields[i].allocated != greedy.session.data.fields[i].allocated ||
+                order[i] != greedy.session.order[i]) {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    printf("fields=%d water=%d hot_fields=%d dp_row_interval=%d dp_rows_per_update=%.1f\n",
+           fieldCount, totalWater, hotCount, dp.rowInterval, (double)rows / updateCount);
+    double dpSpeedup = meanMicros(dpFull, updateCount) / meanMicros(dpUpdate, updateCount);
+    double greedySpeedup = meanMicros(greedyFull, updateCount) /
+                           meanMicros(greedyUpdate, updateCount);
+    report("dp_incremental", dpUpdate, updateCount);
+    report("dp_full", dpFull, updateCount);
+    report("greedy_incremental", greedyUpdate, updateCount);
+    report("greedy_full", greedyFull, updateCount);
+    printf("dp_speedup=%.1fx greedy_speedup=%.1fx mismatches=%d\n", dpSpeedup, greedySpeedup,
+           mismatches);
+
+    incrementalDPRelease(&dp);
+    incrementalGreedyRelease(&greedy);
+    arenaRelease(&arena);
+    free(times);
+    free(request);
+    return mismatches ? 1 : 0;
+}
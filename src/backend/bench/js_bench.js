@@ -0,0 +1,130 @@
+// Benchmark for the JS ports in schedulers/, over the suite cases sized for
+// them. Requests come from farm_gen, so they are the bytes scheduler_bench
+// runs, and results use its line format; check them against a baseline
+// with scheduler_bench --compare.
+//
+//   gcc -O2 -o farm_gen farm_gen.c -lm
+//   node --expose-gc js_bench.js [--gen ./farm_gen] [--runs N] [--case NAME] [--save FILE]
+//
+// peak_heap_bytes is the largest heap growth over a run, measured from a
+// collected heap when --expose-gc is given.
+import { execFileSync } from "child_process"
+import fs from "fs"
+import path from "path"
+import { fileURLToPath } from "url"
+
+import { dpScheduler } from "../schedulers/dpScheduler.js"
+import { greedyScheduler } from "../schedulers/greedyScheduler.js"
+import { bruteForceScheduler } from "../schedulers/bruteForceScheduler.js"
+
+const __dirname = path.dirname(fileURLToPath(import.meta.url))
+
+const schedulers = [
+  ["js_dp", dpScheduler],
+  ["js_greedy", greedyScheduler],
+  ["js_brute_force", bruteForceScheduler],
+]
+
+function parseOptions(argv) {
+  const options = { gen: path.join(__dirname, "farm_gen"), runs: 5, caseName: null, save: null }
+  for (let i = 0; i < argv.length; i++) {
+    const value = argv[i + 1]
+    if (argv[i] === "--gen" && value) options.gen = value
+    else if (argv[i] === "--runs" && value) options.runs = Number.parseInt(value, 10)
+    else if (argv[i] === "--case" && value) options.caseName = value
+    else if (argv[i] === "--save" && value) options.save = value
+    else throw new Error(`Unknown option ${argv[i]}`)
+    i++
+  }
+  if (!(options.runs >= 1)) throw new Error("Runs must be at least 1")
+  return options
+}
+
+// Cases farm_gen --list marks js=1
+function jsCases(gen) {
+  return execFileSync(gen, ["--list"], { encoding: "utf8" })
+    .split("\n")
+    .filter((line) => / js=1\b/.test(line))
+    .map((line) => line.split(/\s+/)[0])
+}
+
+// Same objective as the C schedulers
+function scheduleScore(result) {
+  return result.scheduled.reduce(
+    (score, field) => score + (field.need > 0 ? ((100 - field.moisture) * field.allocated) / field.need : 0),
+    0,
+  )
+}
+
+function percentile(sorted, share) {
+  return sorted[Math.floor(sorted.length * share)]
+}
+
+// The ports log their progress; keep it out of the timings
+function quietly(run) {
+  const { log, error } = console
+  console.log = () => {}
+  console.error = () => {}
+  try {
+    return run()
+  } finally {
+    console.log = log
+    console.error = error
+  }
+}
+
+function benchCase(caseName, name, scheduler, request, runs) {
+  const micros = []
+  let peakHeap = 0
+  let score = 0
+
+  for (let r = -1; r < runs; r++) {
+    // Each run parses its own copy, as the server does
+    const input = JSON.parse(request)
+    if (global.gc) global.gc()
+    const heapBefore = process.memoryUsage().heapUsed
+    const start = process.hrtime.bigint()
+    const result = quietly(() => scheduler(input))
+    const elapsed = Number(process.hrtime.bigint() - start) / 1000
+    const heapGrowth = process.memoryUsage().heapUsed - heapBefore
+
+    if (result.error) throw new Error(`${caseName} failed on ${name}: ${result.error}`)
+    if (heapGrowth > peakHeap) peakHeap = heapGrowth
+    score = scheduleScore(result)
+    if (r >= 0) micros.push(elapsed)
+  }
+
+  micros.sort((a, b) => a - b)
+  const mean = micros.reduce((total, value) => total + value, 0) / runs
+  return (
+    `bench case=${caseName} scheduler=${name} runs=${runs} ops_per_s=${(1e6 / mean).toFixed(3)} ` +
+    `mean_us=${mean.toFixed(1)} min_us=${Math.round(micros[0])} ` +
+    `p50_us=${Math.round(percentile(micros, 0.5))} p95_us=${Math.round(percentile(micros, 0.95))} ` +
+    `p99_us=${Math.round(percentile(micros, 0.99))} peak_heap_bytes=${peakHeap} ` +
+    `peak_rss_kb=${process.resourceUsage().maxRSS} score=${score.toFixed(4)}\n`
+  )
+}
+
+function main() {
+  const options = parseOptions(process.argv.slice(2))
+  const cases = jsCases(options.gen).filter((name) => !options.caseName || name === options.caseName)
+  const lines = []
+
+  if (cases.length === 0) throw new Error(`No JS case named ${options.caseName}`)
+  for (const caseName of cases) {
+    const request = execFileSync(options.gen, ["--case", caseName], { encoding: "utf8" })
+    for (const [name, scheduler] of schedulers) {
+      const line = benchCase(caseName, name, scheduler, request, options.runs)
+      process.stdout.write(line)
+      lines.push(line)
+    }
+  }
+  if (options.save) fs.writeFileSync(options.save, lines.join(""))
+}
+
+try {
+  main()
+} catch (error) {
+  console.error(`Error: ${error.message}`)
+  process.exit(2)
+}
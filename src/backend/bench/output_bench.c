@@ -0,0 +1,143 @@
+// Output stage cost: the old per-line fprintf path against the buffered
+// emitter, in pretty, compact and binary form.
+//
+//   gcc -O2 -o output_bench output_bench.c
+//   ./output_bench [fieldCount] [iterations] [outputPath]
+//
+// Output goes to a temporary file unless a path is given.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/emit.h"
+#include "../core/farm.h"
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int nextRandom(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+// Greedy-shaped result with time constraints, every field scheduled, so each
+// field produces the largest record.
+static IrrigationData buildResult(int fieldCount, char *names) {
+    IrrigationData data;
+    unsigned int seed = 42;
+
+    memset(&data, 0, sizeof(data));
+    data.fields = calloc((size_t)fieldCount, sizeof(Field));
+    data.fieldCount = fieldCount;
+    data.useTimeConstraints = 1;
+    for (int i = 0; i < fieldCount; i++) {
+        Field *field = &data.fields[i];
+        char *name = names + (size_t)i * 16;
+        field->nameLength = snprintf(name, 16, "Field %d", i);
+        field->name = name;
+        field->moisture = (int)(nextRandom(&seed) % 101);
+        field->waterNeeded = (int)(nextRandom(&seed) % 500 + 1);
+        field->allocated = field->waterNeeded;
+        field->timeNeeded = (field->waterNeeded + 49) / 50;
+        field->scheduled = 1;
+        field->originalIndex = i;
+        data.totalWaterUsed += field->allocated;
+        data.totalTimeUsed += field->timeNeeded;
+    }
+    data.remainingWater = 1234;
+    data.remainingElectricity = 56;
+    return data;
+}
+
+// The fprintf-per-line output every scheduler used before the emitter.
+static void printfOutput(FILE *out, const IrrigationData *data) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"algorithm\": \"Greedy\",\n");
+    fprintf(out, "  \"scheduled\": [\n");
+
+    int scheduledCount = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (data->fields[i].scheduled) {
+            if (scheduledCount > 0) fprintf(out, ",\n");
+            fprintf(out, "    {\n");
+            fprintf(out, "      \"name\": \"%.*s\",\n", data->fields[i].nameLength,
+                    data->fields[i].name);
+            fprintf(out, "      \"moisture\": %d,\n", data->fields[i].moisture);
+            fprintf(out, "      \"need\": %d,\n", data->fields[i].waterNeeded);
+            fprintf(out, "      \"allocated\": %d", data->fields[i].allocated);
+            if (data->useTimeConstraints) {
+                fprintf(out, ",\n      \"timeNeeded\": %d\n", data->fields[i].timeNeeded);
+            } else {
+                fprintf(out, "\n");
+            }
+            fprintf(out, "    }");
+            scheduledCount++;
+        }
+    }
+
+    fprintf(out, "\n  ],\n");
+    fprintf(out, "  \"totalWaterUsed\": %d,\n", data->totalWaterUsed);
+    if (data->useTimeConstraints) {
+        fprintf(out, "  \"totalTimeUsed\": %d,\n", data->totalTimeUsed);
+        fprintf(out, "  \"remainingElectricity\": %d,\n", data->remainingElectricity);
+    }
+    fprintf(out, "  \"remainingWater\": %d\n", data->remainingWater);
+    fprintf(out, "}\n");
+}
+
+typedef struct {
+    const char *name;
+    int format;   // -1 for the printf path, otherwise an OutputFormat
+} Variant;
+
+int main(int argc, char **argv) {
+    int fieldCount = argc > 1 ? atoi(argv[1]) : 10000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    char *names = fieldCount > 0 ? malloc((size_t)fieldCount * 16) : NULL;
+    FILE *out = argc > 3 ? fopen(argv[3], "wb") : tmpfile();
+
+    if (!names || !out || iterations <= 0) {
+        fprintf(stderr, "usage: output_bench [fieldCount] [iterations] [outputPath]\n");
+        return 1;
+    }
+
+    IrrigationData data = buildResult(fieldCount, names);
+    Variant variants[] = {
+        {"printf_pretty", -1},
+        {"emit_pretty", OUTPUT_PRETTY},
+        {"emit_compact", OUTPUT_COMPACT},
+        {"emit_binary", OUTPUT_BINARY},
+    };
+    double baseline = 0;
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        double best = 1e30;
+        long bytes = 0;
+        for (int r = 0; r < iterations; r++) {
+            long before = ftell(out);
+            double start = nowSeconds();
+            if (variants[v].format < 0) {
+                printfOutput(out, &data);
+            } else {
+                emitSchedule(out, &data, NULL, "Greedy", 1, (OutputFormat)variants[v].format);
+            }
+            fflush(out);
+            double elapsed = nowSeconds() - start;
+            if (elapsed < best) best = elapsed;
+            bytes = ftell(out) - before;
+        }
+        if (v == 0) baseline = best;
+        printf("%-14s fields=%d bytes=%ld best_ms=%.3f ns_per_field=%.1f speedup=%.2fx\n",
+               variants[v].name, fieldCount, bytes, best * 1e3, best * 1e9 / fieldCount,
+               baseline / best);
+    }
+
+    fclose(out);
+    free(data.fields);
+    free(names);
+    return 0;
+}
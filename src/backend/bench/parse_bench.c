@@ -0,0 +1,81 @@
+// Parse throughput for the shared request parser.
+//
+//   gcc -O2 -o parse_bench parse_bench.c
+//   ./parse_bench [fieldCount] [iterations]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/arena.h"
+#include "../core/farm.h"
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int nextRandom(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+static char *buildRequest(int fieldCount, size_t *length) {
+    size_t capacity = 128 + (size_t)fieldCount * 96;
+    char *text = malloc(capacity);
+    unsigned int seed = 42;
+    size_t used;
+
+    if (!text) return NULL;
+    used = (size_t)snprintf(text, capacity,
+                            "{\"technique\": \"dynamic\", \"totalWater\": %d, "
+                            "\"totalElectricity\": 500, \"waterDeliveryRate\": 50, "
+                            "\"fieldCount\": %d, \"fields\": [",
+                            fieldCount * 50, fieldCount);
+    for (int i = 0; i < fieldCount; i++) {
+        used += (size_t)snprintf(text + used, capacity - used,
+                                 "%s{\"name\": \"Field %d\", \"moisture\": %u, "
+                                 "\"waterNeeded\": %u}",
+                                 i ? ", " : "", i, nextRandom(&seed) % 101,
+                                 nextRandom(&seed) % 500 + 1);
+    }
+    used += (size_t)snprintf(text + used, capacity - used, "]}");
+    *length = used;
+    return text;
+}
+
+int main(int argc, char **argv) {
+    int fieldCount = argc > 1 ? atoi(argv[1]) : 100000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    size_t length = 0;
+    char *request = buildRequest(fieldCount, &length);
+
+    if (!request || fieldCount <= 0 || iterations <= 0) {
+        fprintf(stderr, "usage: parse_bench [fieldCount] [iterations]\n");
+        return 1;
+    }
+
+    double best = 1e30;
+    for (int r = 0; r < iterations; r++) {
+        Arena arena;
+        IrrigationData data;
+        arenaInit(&arena);
+
+        double start = nowSeconds();
+        int ok = parseIrrigationInput(request, length, &data, &arena);
+        double elapsed = nowSeconds() - start;
+
+        if (!ok || data.fieldCount != fieldCount) {
+            fprintf(stderr, "parse failed\n");
+            return 1;
+        }
+        if (elapsed < best) best = elapsed;
+        arenaRelease(&arena);
+    }
+
+    printf("fields=%d bytes=%zu best_ms=%.3f throughput_mb_s=%.1f fields_per_s=%.0f\n",
+           fieldCount, length, best * 1e3, length / best / 1e6, fieldCount / best);
+    free(request);
+    return 0;
+}
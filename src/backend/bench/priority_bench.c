@@ -0,0 +1,166 @@
+// Prioritization cost: the original qsort over 120-byte records with the
+// nested-loop order restore, qsort over Field with the scatter restore, and
+// the prioritizeFields index permutation the schedulers use now.
+//
+//   gcc -O2 -o priority_bench priority_bench.c
+//   ./priority_bench [fieldCount] [iterations]
+//
+// The nested-loop restore is O(n^2), so above 20000 fields it is timed at
+// 20000 and scaled up; those rows are marked "estimated".
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/arena.h"
+#include "../core/farm.h"
+
+#define LEGACY_SAMPLE_FIELDS 20000
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int nextRandom(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 16) & 0x7fff;
+}
+
+// The record every scheduler sorted before the parser kept names as slices.
+typedef struct {
+    char name[100];
+    int moisture;
+    int waterNeeded;
+    int allocated;
+    int scheduled;
+    int originalIndex;
+} LegacyField;
+
+static int compareLegacyFields(const void *a, const void *b) {
+    const LegacyField *fieldA = a;
+    const LegacyField *fieldB = b;
+    if (fieldA->moisture != fieldB->moisture) return fieldA->moisture - fieldB->moisture;
+    return fieldB->waterNeeded - fieldA->waterNeeded;
+}
+
+static void buildFields(Field *fields, int fieldCount) {
+    unsigned int seed = 42;
+    memset(fields, 0, (size_t)fieldCount * sizeof(Field));
+    for (int i = 0; i < fieldCount; i++) {
+        fields[i].moisture = (int)(nextRandom(&seed) % 101);
+        fields[i].waterNeeded = (int)(nextRandom(&seed) % 5000);
+        fields[i].originalIndex = i;
+    }
+}
+
+// qsort plus the swap loop dp_scheduler.c and brute_force_scheduler.c used
+// to put fields back in input order.
+static double legacyOnce(const Field *source, int fieldCount) {
+    LegacyField *fields = calloc((size_t)fieldCount, sizeof(LegacyField));
+    if (!fields) return -1;
+    for (int i = 0; i < fieldCount; i++) {
+        snprintf(fields[i].name, sizeof(fields[i].name), "Field %d", i);
+        fields[i].moisture = source[i].moisture;
+        fields[i].waterNeeded = source[i].waterNeeded;
+        fields[i].originalIndex = i;
+    }
+
+    double start = nowSeconds();
+    qsort(fields, fieldCount, sizeof(LegacyField), compareLegacyFields);
+    for (int i = 0; i < fieldCount; i++) {
+        for (int j = i + 1; j < fieldCount; j++) {
+            if (fields[j].originalIndex < fields[i].originalIndex) {
+                LegacyField temp = fields[i];
+                fields[i] = fields[j];
+                fields[j] = temp;
+            }
+        }
+    }
+    double elapsed = nowSeconds() - start;
+    free(fields);
+    return elapsed;
+}
+
+// qsort over Field and one scatter pass back to input order.
+static double scatterOnce(const Field *source, int fieldCount, Field *work, Field *ordered) {
+    memcpy(work, source, (size_t)fieldCount * sizeof(Field));
+    double start = nowSeconds();
+    qsort(work, fieldCount, sizeof(Field), compareFields);
+    for (int i = 0; i < fieldCount; i++) ordered[work[i].originalIndex] = work[i];
+    return nowSeconds() - start;
+}
+
+static double permutationOnce(IrrigationData *data, Arena *arena, const int **order) {
+    arenaReset(arena);
+    double start = nowSeconds();
+    *order = prioritizeFields(data, arena);
+    return nowSeconds() - start;
+}
+
+// The permutation must list every field once, in stable compareFields order.
+static int checkOrder(const Field *fields, int fieldCount, const int *order, Field *seen) {
+    memset(seen, 0, (size_t)fieldCount * sizeof(Field));
+    for (int i = 0; i < fieldCount; i++) {
+        if (order[i] < 0 || order[i] >= fieldCount || seen[order[i]].scheduled) return 0;
+        seen[order[i]].scheduled = 1;
+        if (i > 0) {
+            int cmp = compareFields(&fields[order[i - 1]], &fields[order[i]]);
+            if (cmp > 0 || (cmp == 0 && order[i - 1] > order[i])) return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int fieldCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 5;
+    Field *fields = fieldCount > 0 ? malloc((size_t)fieldCount * sizeof(Field)) : NULL;
+    Field *work = fieldCount > 0 ? malloc((size_t)fieldCount * sizeof(Field)) : NULL;
+    Field *ordered = fieldCount > 0 ? malloc((size_t)fieldCount * sizeof(Field)) : NULL;
+    IrrigationData data;
+    Arena arena;
+    const int *order = NULL;
+
+    if (!fields || !work || !ordered || iterations <= 0) {
+        fprintf(stderr, "usage: priority_bench [fieldCount] [iterations]\n");
+        return 1;
+    }
+    buildFields(fields, fieldCount);
+    memset(&data, 0, sizeof(data));
+    data.fields = fields;
+    data.fieldCount = fieldCount;
+    arenaInit(&arena);
+
+    int legacyFields = fieldCount < LEGACY_SAMPLE_FIELDS ? fieldCount : LEGACY_SAMPLE_FIELDS;
+    double scale = (double)fieldCount / legacyFields;
+    double legacy = legacyOnce(fields, legacyFields) * scale * scale;
+    double scatter = 1e30;
+    double permutation = 1e30;
+    for (int r = 0; r < iterations; r++) {
+        double elapsed = scatterOnce(fields, fieldCount, work, ordered);
+        if (elapsed < scatter) scatter = elapsed;
+        elapsed = permutationOnce(&data, &arena, &order);
+        if (elapsed < permutation) permutation = elapsed;
+    }
+    if (!order || !checkOrder(fields, fieldCount, order, work)) {
+        fprintf(stderr, "prioritizeFields order does not match compareFields\n");
+        return 1;
+    }
+
+    printf("%-22s fields=%d best_ms=%.3f ns_per_field=%.1f%s\n", "qsort_nested_restore",
+           fieldCount, legacy * 1e3, legacy * 1e9 / fieldCount,
+           legacyFields < fieldCount ? " (estimated)" : "");
+    printf("%-22s fields=%d best_ms=%.3f ns_per_field=%.1f\n", "qsort_scatter_restore",
+           fieldCount, scatter * 1e3, scatter * 1e9 / fieldCount);
+    printf("%-22s fields=%d best_ms=%.3f ns_per_field=%.1f speedup=%.2fx\n",
+           "prioritize_fields", fieldCount, permutation * 1e3, permutation * 1e9 / fieldCount,
+           scatter / permutation);
+
+    arenaRelease(&arena);
+    free(fields);
+    free(work);
+    free(ordered);
+    return 0;
+}
@@ -0,0 +1,362 @@
+// Scheduler benchmark over the standard workload suite (workload.h). Every
+// case is parsed and scheduled by each scheduler it is sized for, runs
+// times after one warm-up, and gives one line:
+//
+//   bench case=large scheduler=dp runs=5 ops_per_s=2.1 mean_us=... min_us=...
+//         p50_us=... p95_us=... p99_us=... peak_arena_bytes=... peak_rss_kb=...
+//         score=...
+//
+// A run is parse plus schedule, as in the binaries; output is left to
+// output_bench. peak_arena_bytes is the largest the request arena grew to,
+// which holds every per-request buffer; peak_rss_kb is the process's so
+// far. score is the schedule's objective, so a behaviour change shows up
+// next to a speed change.
+//
+// Saved results are the baseline of a regression check: a case fails if
+// its fastest run or its peak memory grew by more than the threshold, or
+// its score changed. The fastest run is the one least disturbed by the
+// rest of the machine; percentiles and the mean move with the load, so
+// they are reported but not checked. Latency differences under
+// BENCH_NOISE_FLOOR_US are ignored as timer noise. The JS bench
+// (js_bench.js) writes the same format, so --compare checks it too.
+//
+//   gcc -O2 -pthread -o scheduler_bench scheduler_bench.c -lm
+//   ./scheduler_bench --save baseline.txt
+//   ./scheduler_bench --baseline baseline.txt --threshold 15
+//   ./scheduler_bench --compare baseline.txt current.txt --threshold 15
+//
+// Options: --runs N, --case NAME, --scheduler dp|greedy|brute_force.
+// Exits 1 on a regression. Run the baseline and the check on the same
+// machine with the same build flags.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/arena.h"
+#include "../core/brute_force.h"
+#include "../core/dp.h"
+#include "../core/farm.h"
+#include "../core/greedy.h"
+#include "../core/latency.h"
+#include "../core/profile.h"
+#include "workload.h"
+
+#define BENCH_DEFAULT_RUNS 5
+#define BENCH_DEFAULT_THRESHOLD 10.0
+#define BENCH_NOISE_FLOOR_US 50.0
+#define BENCH_MAX_RESULTS 256
+#define BENCH_LINE_SIZE 512
+
+typedef struct {
+    int runs;
+    const char *caseName;         // NULL for the whole suite
+    unsigned schedulers;          // WORKLOAD_* bits
+    const char *savePath;
+    const char *baselinePath;
+    const char *comparePath;      // with --compare, the results to check
+    double threshold;             // percent
+} BenchOptions;
+
+// One result line, by key. Missing values are negative.
+typedef struct {
+    char caseName[64];
+    char scheduler[32];
+    double minMicros;
+    double peakBytes;
+    double score;
+} BenchResult;
+
+typedef struct {
+    BenchResult items[BENCH_MAX_RESULTS];
+    int count;
+} BenchResults;
+
+static int compareMicros(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+// Nearest-rank percentile of sorted run times.
+static uint64_t rankMicros(const uint64_t *sorted, int count, int percentile) {
+    return sorted[((size_t)count * percentile + 99) / 100 - 1];
+}
+
+static double scheduleScore(const IrrigationData *data) {
+    Score score = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (field->scheduled && field->waterNeeded > 0) {
+            score += fieldRate(field) * field->allocated;
+        }
+    }
+    return (double)score / (double)(1ll << SCORE_SHIFT);
+}
+
+// Parses and schedules one request. Returns 0 on failure.
+static int runOnce(unsigned scheduler, const char *request, size_t length, Arena *arena,
+                   double *score) {
+    IrrigationData data;
+
+    if (!parseIrrigationInput(request, length, &data, arena)) return 0;
+    if (scheduler == WORKLOAD_DP) {
+        DPOptions options;
+        DPStats stats;
+        dpOptionsInit(&options);
+        if (!dpSchedule(&data, &options, arena, &stats)) return 0;
+    } else if (scheduler == WORKLOAD_GREEDY) {
+        greedyApplyDefaults(&data);
+        if (!greedySchedule(&data, arena)) return 0;
+    } else {
+        BruteForceOptions options;
+        BruteForceStats stats;
+        bruteForceOptionsInit(&options);
+        if (!bruteForceSchedule(&data, &options, arena, &stats)) return 0;
+    }
+    *score = scheduleScore(&data);
+    return 1;
+}
+
+static const char *schedulerName(unsigned scheduler) {
+    if (scheduler == WORKLOAD_DP) return "dp";
+    return scheduler == WORKLOAD_GREEDY ? "greedy" : "brute_force";
+}
+
+// Runs one case on one scheduler and writes its line into line.
+static int benchCase(const WorkloadSpec *spec, unsigned scheduler, int runs, uint64_t *micros,
+                     char *line, size_t lineSize) {
+    size_t length = 0;
+    char *request = workloadBuild(spec, &length);
+    Arena arena;
+    size_t peakBytes = 0;
+    uint64_t total = 0;
+    double score = 0;
+
+    if (!request) return 0;
+    arenaInit(&arena);
+    for (int r = -1; r < runs; r++) {
+        uint64_t start = monotonicMicros();
+        int ok = runOnce(scheduler, request, length, &arena, &score);
+        uint64_t elapsed = monotonicMicros() - start;
+        if (!ok) {
+            arenaRelease(&arena);
+            free(request);
+            return 0;
+        }
+        if (arena.reservedBytes > peakBytes) peakBytes = arena.reservedBytes;
+        arenaReset(&arena);
+        if (r < 0) continue;
+        micros[r] = elapsed;
+        total += elapsed;
+    }
+    arenaRelease(&arena);
+    free(request);
+
+    qsort(micros, (size_t)runs, sizeof(uint64_t), compareMicros);
+    double mean = (double)total / runs;
+    snprintf(line, lineSize,
+             "bench case=%s scheduler=%s runs=%d ops_per_s=%.3f mean_us=%.1f min_us=%llu "
+             "p50_us=%llu p95_us=%llu p99_us=%llu peak_arena_bytes=%zu peak_rss_kb=%ld "
+             "score=%.4f\n",
+             spec->name, schedulerName(scheduler), runs, mean > 0 ? 1e6 / mean : 0, mean,
+             (unsigned long long)micros[0], (unsigned long long)rankMicros(micros, runs, 50),
+             (unsigned long long)rankMicros(micros, runs, 95),
+             (unsigned long long)rankMicros(micros, runs, 99), peakBytes, peakResidentKB(),
+             score);
+    return 1;
+}
+
+static double lineValue(const char *line, const char *key) {
+    size_t keyLength = strlen(key);
+    for (const char *at = strstr(line, key); at; at = strstr(at + 1, key)) {
+        if ((at == line || at[-1] == ' ') && at[keyLength] == '=') {
+            return atof(at + keyLength + 1);
+        }
+    }
+    return -1;
+}
+
+static void lineWord(const char *line, const char *key, char *word, size_t size) {
+    const char *at = strstr(line, key);
+    size_t used = 0;
+    word[0] = '\0';
+    if (!at) return;
+    at += strlen(key);
+    while (*at && *at != ' ' && *at != '\n' && used + 1 < size) word[used++] = *at++;
+    word[used] = '\0';
+}
+
+static void addResult(BenchResults *results, const char *line) {
+    BenchResult *result;
+
+    if (strncmp(line, "bench ", 6) != 0 || results->count >= BENCH_MAX_RESULTS) return;
+    result = &results->items[results->count++];
+    lineWord(line, " case=", result->caseName, sizeof(result->caseName));
+    lineWord(line, " scheduler=", result->scheduler, sizeof(result->scheduler));
+    result->minMicros = lineValue(line, "min_us");
+    result->peakBytes = lineValue(line, "peak_arena_bytes");
+    if (result->peakBytes < 0) result->peakBytes = lineValue(line, "peak_heap_bytes");
+    result->score = lineValue(line, "score");
+}
+
+static int loadResults(const char *path, BenchResults *results) {
+    FILE *file = fopen(path, "r");
+    char line[BENCH_LINE_SIZE];
+
+    results->count = 0;
+    if (!file) {
+        fprintf(stderr, "Error: Cannot read %s\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) addResult(results, line);
+    fclose(file);
+    return 1;
+}
+
+// Growth of current over baseline in percent, for values where more is worse.
+static double growth(double baseline, double current) {
+    return baseline > 0 ? (current - baseline) * 100.0 / baseline : 0;
+}
+
+// Checks current against baseline and prints one verdict per case. Returns
+// the number of regressions.
+static int checkRegressions(const BenchResults *baseline, const BenchResults *current,
+                            double threshold) {
+    int regressions = 0;
+
+    for (int i = 0; i < current->count; i++) {
+        const BenchResult *now = &current->items[i];
+        const BenchResult *before = NULL;
+        char reasons[256] = "";
+        size_t used = 0;
+
+        for (int j = 0; j < baseline->count && !before; j++) {
+            if (strcmp(baseline->items[j].caseName, now->caseName) == 0 &&
+                strcmp(baseline->items[j].scheduler, now->scheduler) == 0) {
+                before = &baseline->items[j];
+            }
+        }
+        if (!before) {
+            printf("check case=%s scheduler=%s new\n", now->caseName, now->scheduler);
+            continue;
+        }
+
+        double latency = growth(before->minMicros, now->minMicros);
+        double memory = growth(before->peakBytes, now->peakBytes);
+        if (latency > threshold && now->minMicros - before->minMicros >= BENCH_NOISE_FLOOR_US) {
+            used += (size_t)snprintf(reasons + used, sizeof(reasons) - used, " min_us+%.1f%%",
+                                     latency);
+        }
+        if (memory > threshold) {
+            used += (size_t)snprintf(reasons + used, sizeof(reasons) - used,
+                                     " peak_bytes+%.1f%%", memory);
+        }
+        if (before->score >= 0 && now->score >= 0 && before->score != now->score) {
+            used += (size_t)snprintf(reasons + used, sizeof(reasons) - used, " score %.4f->%.4f",
+                                     before->score, now->score);
+        }
+        printf("check case=%s scheduler=%s %s%s\n", now->caseName, now->scheduler,
+               used ? "REGRESSION" : "ok", reasons);
+        regressions += used > 0;
+    }
+    printf("check regressions=%d threshold=%.1f%%\n", regressions, threshold);
+    return regressions;
+}
+
+static int parseOptions(int argc, char **argv, BenchOptions *options) {
+    options->runs = BENCH_DEFAULT_RUNS;
+    options->caseName = NULL;
+    options->schedulers = WORKLOAD_DP | WORKLOAD_GREEDY | WORKLOAD_BRUTE_FORCE;
+    options->savePath = NULL;
+    options->baselinePath = NULL;
+    options->comparePath = NULL;
+    options->threshold = BENCH_DEFAULT_THRESHOLD;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            options->runs = atoi(argv[++i]);
+            if (options->runs < 1) {
+                fprintf(stderr, "Error: Runs must be at least 1\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--case") == 0 && i + 1 < argc) {
+            options->caseName = argv[++i];
+            if (!workloadFind(options->caseName)) {
+                fprintf(stderr, "Error: Unknown case %s\n", options->caseName);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--scheduler") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (strcmp(name, "dp") == 0) {
+                options->schedulers = WORKLOAD_DP;
+            } else if (strcmp(name, "greedy") == 0) {
+                options->schedulers = WORKLOAD_GREEDY;
+            } else if (strcmp(name, "brute_force") == 0) {
+                options->schedulers = WORKLOAD_BRUTE_FORCE;
+            } else {
+                fprintf(stderr, "Error: Scheduler must be dp, greedy or brute_force\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            options->savePath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            options->baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc) {
+            options->baselinePath = argv[++i];
+            options->comparePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            options->threshold = atof(argv[++i]);
+            if (options->threshold <= 0) {
+                fprintf(stderr, "Error: Threshold must be a positive percentage\n");
+                return 0;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    static BenchResults baseline;
+    static BenchResults current;
+    BenchOptions options;
+    FILE *save = NULL;
+    uint64_t *micros;
+
+    if (!parseOptions(argc, argv, &options)) return 2;
+    if (options.baselinePath && !loadResults(options.baselinePath, &baseline)) return 2;
+    if (options.comparePath) {
+        if (!loadResults(options.comparePath, &current)) return 2;
+        return checkRegressions(&baseline, &current, options.threshold) ? 1 : 0;
+    }
+
+    micros = malloc((size_t)options.runs * sizeof(uint64_t));
+    if (options.savePath) save = fopen(options.savePath, "w");
+    if (!micros || (options.savePath && !save)) {
+        fprintf(stderr, "Error: Cannot start the benchmark\n");
+        return 2;
+    }
+    for (int c = 0; c < WORKLOAD_SUITE_SIZE; c++) {
+        const WorkloadSpec *spec = &workloadSuite[c];
+        if (options.caseName && strcmp(options.caseName, spec->name) != 0) continue;
+        for (unsigned scheduler = WORKLOAD_DP; scheduler <= WORKLOAD_BRUTE_FORCE; scheduler <<= 1) {
+            char line[BENCH_LINE_SIZE];
+            if (!(options.schedulers & spec->schedulers & scheduler)) continue;
+            if (!benchCase(spec, scheduler, options.runs, micros, line, sizeof(line))) {
+                fprintf(stderr, "Error: case %s failed on %s\n", spec->name,
+                        schedulerName(scheduler));
+                return 2;
+            }
+            fputs(line, stdout);
+            fflush(stdout);
+            if (save) fputs(line, save);
+            addResult(&current, line);
+        }
+    }
+    if (save) fclose(save);
+    free(micros);
+
+    if (!options.baselinePath) return 0;
+    return checkRegressions(&baseline, &current, options.threshold) ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// Load time for a large farm: the JSON request through the shared parser
+// against a binary snapshot (see core/snapshot.h), mapped and loaded with a
+// delta of moisture updates by name. Both paths must give the same fields.
+//
+//   gcc -O2 -o snapshot_bench snapshot_bench.c -lm
+//   ./snapshot_bench [fieldCount] [updates] [iterations] [snapshotPath]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/arena.h"
+#include "../core/farm.h"
+#include "../core/latency.h"
+#include "../core/snapshot.h"
+#include "workload.h"
+
+static char *buildDelta(int fieldCount, int updates, size_t *length) {
+    size_t capacity = 64 + (size_t)updates * 48;
+    char *text = malloc(capacity);
+    uint64_t state = 5;
+    size_t used;
+
+    if (!text) return NULL;
+    used = (size_t)snprintf(text, capacity, "{\"fields\":[");
+    for (int u = 0; u < updates; u++) {
+        used += (size_t)snprintf(text + used, capacity - used,
+                                 "%s{\"name\":\"Field %d\",\"moisture\":%d}", u ? "," : "",
+                                 workloadRange(&state, 1, fieldCount),
+                                 workloadRange(&state, 0, 100));
+    }
+    used += (size_t)snprintf(text + used, capacity - used, "]}");
+    *length = used;
+    return text;
+}
+
+// Fields after the JSON parse with the delta applied by hand, against the
+// snapshot's.
+static int sameFields(const IrrigationData *json, const IrrigationData *snapshot,
+                      const char *delta, size_t deltaLength) {
+    JsonCursor cursor;
+    JsonSlice key;
+    int first = 1, firstElement = 1;
+
+    jsonInit(&cursor, delta, deltaLength);
+    if (!jsonConsume(&cursor, '{') || !jsonNextKey(&cursor, &first, &key) ||
+        !jsonConsume(&cursor, '[')) {
+        return 0;
+    }
+    while (jsonNextElement(&cursor, &firstElement)) {
+        JsonSlice name = {NULL, 0};
+        int firstKey = 1, index = -1, moisture = 0;
+        if (!jsonConsume(&cursor, '{')) return 0;
+        while (jsonNextKey(&cursor, &firstKey, &key)) {
+            if (jsonSliceEquals(key, "name")) {
+                if (!jsonString(&cursor, &name)) return 0;
+                index = atoi(name.ptr + 6) - 1;
+            } else {
+                jsonInt(&cursor, &moisture);
+            }
+        }
+        if (index < 0 || index >= json->fieldCount) return 0;
+        json->fields[index].moisture = moisture;
+    }
+    if (json->fieldCount != snapshot->fieldCount || json->totalWater != snapshot->totalWater) {
+        return 0;
+    }
+    for (int i = 0; i < json->fieldCount; i++) {
+        const Field *a = &json->fields[i];
+        const Field *b = &snapshot->fields[i];
+        if (a->moisture != b->moisture || a->waterNeeded != b->waterNeeded ||
+            a->nameLength != b->nameLength || memcmp(a->name, b->name, (size_t)a->nameLength)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    WorkloadSpec spec = {"snapshot", 23, 1000000, 500, 1.0, MOISTURE_UNIFORM, 40, 0, 0,
+                         WORKLOAD_ALL};
+    int updates = argc > 2 ? atoi(argv[2]) : 1000;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    const char *path = argc > 4 ? argv[4] : "snapshot_bench.snap";
+    size_t length = 0, deltaLength = 0;
+    char *request, *delta;
+    Arena arena, snapshotArena;
+    IrrigationData json, loaded;
+    FarmSnapshot snapshot;
+    uint64_t bestJson = UINT64_MAX, bestOpen = UINT64_MAX, bestLoad = UINT64_MAX;
+
+    if (argc > 1) spec.fieldCount = atoi(argv[1]);
+    request = spec.fieldCount > 0 ? workloadBuild(&spec, &length) : NULL;
+    delta = updates >= 0 ? buildDelta(spec.fieldCount, updates, &deltaLength) : NULL;
+    if (!request || !delta || iterations <= 0) {
+        fprintf(stderr, "usage: snapshot_bench [fieldCount] [updates] [iterations] "
+                        "[snapshotPath]\n");
+        return 1;
+    }
+
+    arenaInit(&arena);
+    arenaInit(&snapshotArena);
+    for (int r = 0; r < iterations; r++) {
+        arenaReset(&arena);
+        uint64_t start = monotonicMicros();
+        if (!parseIrrigationInput(request, length, &json, &arena)) return 1;
+        uint64_t elapsed = monotonicMicros() - start;
+        if (elapsed < bestJson) bestJson = elapsed;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out || !snapshotWrite(out, &json, &snapshotArena) || fclose(out) != 0) {
+        fprintf(stderr, "could not write %s\n", path);
+        return 1;
+    }
+    arenaReset(&snapshotArena);
+
+    for (int r = 0; r < iterations; r++) {
+        arenaReset(&snapshotArena);
+        uint64_t start = monotonicMicros();
+        if (!snapshotOpen(path, &snapshot)) return 1;
+        uint64_t opened = monotonicMicros();
+        if (!parseSnapshotInput(&snapshot, delta, deltaLength, &loaded, &snapshotArena)) return 1;
+        uint64_t end = monotonicMicros();
+        if (opened - start < bestOpen) bestOpen = opened - start;
+        if (end - opened < bestLoad) bestLoad = end - opened;
+        if (r + 1 < iterations) snapshotClose(&snapshot);
+    }
+
+    int same = sameFields(&json, &loaded, delta, deltaLength);
+    uint64_t snapshotMicros = bestOpen + bestLoad > 0 ? bestOpen + bestLoad : 1;
+    printf("fields=%d json_bytes=%zu snapshot_bytes=%zu updates=%d json_ms=%.3f "
+           "snapshot_open_ms=%.3f snapshot_load_ms=%.3f speedup=%.1f same=%d\n",
+           spec.fieldCount, length, snapshot.size, updates, bestJson / 1e3, bestOpen / 1e3,
+           bestLoad / 1e3, (double)bestJson / (double)snapshotMicros, same);
+    snapshotClose(&snapshot);
+    remove(path);
+    arenaRelease(&arena);
+    arenaRelease(&snapshotArena);
+    free(request);
+    free(delta);
+    return same ? 0 : 1;
+}
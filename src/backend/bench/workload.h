@@ -0,0 +1,160 @@
+#ifndef SMARTFARM_WORKLOAD_H
+#define SMARTFARM_WORKLOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+// Seeded synthetic farms for the benchmarks. A workload is a request body
+// like the ones the server sends: the same spec and seed always give the
+// same bytes, on any platform, so results can be compared across versions.
+//
+// Needs are drawn as maxNeed * u^skew: skew 1 is uniform, larger values
+// give many small fields and a few thirsty ones. The budget is a share of
+// the summed need, since a farm rarely has water for every field.
+
+typedef enum {
+    MOISTURE_UNIFORM,      // 0..100
+    MOISTURE_DRY,          // mostly below 40, after a dry spell
+    MOISTURE_WET,          // mostly above 60, after rain
+    MOISTURE_BIMODAL       // irrigated and unirrigated blocks
+} MoistureProfile;
+
+typedef struct {
+    const char *name;
+    uint64_t seed;
+    int fieldCount;
+    int maxNeed;
+    double skew;
+    MoistureProfile moisture;
+    int waterPercent;      // totalWater as a share of the summed need
+    int totalElectricity;  // 0 for no electricity budget
+    int waterDeliveryRate;
+    unsigned schedulers;   // WORKLOAD_* bits the case is sized for
+} WorkloadSpec;
+
+#define WORKLOAD_DP          1u
+#define WORKLOAD_GREEDY      2u
+#define WORKLOAD_BRUTE_FORCE 4u
+#define WORKLOAD_JS          8u
+#define WORKLOAD_ALL         15u
+
+// The standard suite. The JS ports keep full tables and brute force is
+// exponential in the worst case, so they only run the cases sized for them.
+static const WorkloadSpec workloadSuite[] = {
+    {"tiny", 1, 12, 200, 1.0, MOISTURE_UNIFORM, 50, 0, 0, WORKLOAD_ALL},
+    {"small_power", 2, 24, 300, 1.0, MOISTURE_DRY, 40, 120, 25, WORKLOAD_ALL},
+    {"js_medium", 9, 60, 100, 1.0, MOISTURE_UNIFORM, 40, 0, 0, WORKLOAD_ALL},
+    {"medium", 3, 200, 500, 1.0, MOISTURE_UNIFORM, 40, 0, 0,
+     WORKLOAD_DP | WORKLOAD_GREEDY | WORKLOAD_BRUTE_FORCE},
+    {"medium_skewed", 4, 200, 2000, 3.0, MOISTURE_BIMODAL, 30, 0, 0,
+     WORKLOAD_DP | WORKLOAD_GREEDY | WORKLOAD_BRUTE_FORCE},
+    {"large", 5, 2000, 100, 1.0, MOISTURE_UNIFORM, 40, 0, 0,
+     WORKLOAD_DP | WORKLOAD_GREEDY | WORKLOAD_BRUTE_FORCE},
+    {"large_wet", 6, 2000, 100, 1.5, MOISTURE_WET, 60, 0, 0,
+     WORKLOAD_DP | WORKLOAD_GREEDY | WORKLOAD_BRUTE_FORCE},
+    {"large_power", 7, 2000, 100, 1.0, MOISTURE_DRY, 40, 1000, 20,
+     WORKLOAD_DP | WORKLOAD_GREEDY},
+    {"huge", 8, 100000, 300, 2.0, MOISTURE_UNIFORM, 30, 0, 0, WORKLOAD_GREEDY},
+};
+
+#define WORKLOAD_SUITE_SIZE ((int)(sizeof(workloadSuite) / sizeof(workloadSuite[0])))
+
+static inline const WorkloadSpec *workloadFind(const char *name) {
+    for (int i = 0; i < WORKLOAD_SUITE_SIZE; i++) {
+        if (strcmp(workloadSuite[i].name, name) == 0) return &workloadSuite[i];
+    }
+    return NULL;
+}
+
+static inline int parseMoistureProfile(const char *text, MoistureProfile *profile) {
+    static const char *const names[] = {"uniform", "dry", "wet", "bimodal"};
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(text, names[i]) == 0) {
+            *profile = (MoistureProfile)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// splitmix64, so the stream does not depend on the C library's rand()
+static inline uint64_t workloadNext(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static inline double workloadUnit(uint64_t *state) {
+    return (double)(workloadNext(state) >> 11) / 9007199254740992.0;
+}
+
+static inline int workloadRange(uint64_t *state, int low, int high) {
+    return low + (int)(workloadNext(state) % (uint64_t)(high - low + 1));
+}
+
+static inline int workloadMoisture(uint64_t *state, MoistureProfile profile) {
+    switch (profile) {
+    case MOISTURE_DRY:
+        if (workloadRange(state, 0, 9) < 8) return workloadRange(state, 0, 40);
+        return workloadRange(state, 0, 100);
+    case MOISTURE_WET:
+        if (workloadRange(state, 0, 9) < 8) return workloadRange(state, 60, 100);
+        return workloadRange(state, 0, 100);
+    case MOISTURE_BIMODAL:
+        if (workloadRange(state, 0, 1)) return workloadRange(state, 5, 25);
+        return workloadRange(state, 70, 95);
+    default:
+        return workloadRange(state, 0, 100);
+    }
+}
+
+// Builds the request text; free() it when done. Returns NULL if out of
+// memory or the spec is empty.
+static inline char *workloadBuild(const WorkloadSpec *spec, size_t *length) {
+    size_t capacity = 256 + (size_t)spec->fieldCount * 80;
+    char *text;
+    int *needs;
+    int64_t totalNeed = 0;
+    uint64_t state = spec->seed;
+    size_t used;
+
+    if (spec->fieldCount <= 0 || spec->maxNeed <= 0) return NULL;
+    text = malloc(capacity);
+    needs = malloc((size_t)spec->fieldCount * sizeof(int));
+    if (!text || !needs) {
+        free(text);
+        free(needs);
+        return NULL;
+    }
+    for (int i = 0; i < spec->fieldCount; i++) {
+        needs[i] = 1 + (int)((spec->maxNeed - 1) * pow(workloadUnit(&state), spec->skew));
+        totalNeed += needs[i];
+    }
+    int64_t totalWater = totalNeed * spec->waterPercent / 100;
+    if (totalWater < 1) totalWater = 1;
+    if (totalWater > INT32_MAX) totalWater = INT32_MAX;
+
+    used = (size_t)snprintf(text, capacity,
+                            "{\"technique\":\"dynamic\",\"totalWater\":%lld,"
+                            "\"totalElectricity\":%d,\"waterDeliveryRate\":%d,"
+                            "\"fieldCount\":%d,\"fields\":[",
+                            (long long)totalWater, spec->totalElectricity,
+                            spec->waterDeliveryRate, spec->fieldCount);
+    for (int i = 0; i < spec->fieldCount; i++) {
+        used += (size_t)snprintf(text + used, capacity - used,
+                                 "%s{\"name\":\"Field %d\",\"moisture\":%d,\"waterNeeded\":%d}",
+                                 i ? "," : "", i + 1, workloadMoisture(&state, spec->moisture),
+                                 needs[i]);
+    }
+    used += (size_t)snprintf(text + used, capacity - used, "]}");
+    free(needs);
+    *length = used;
+    return text;
+}
+
+#endif
@@ -0,0 +1,13 @@
+{
+  "targets": [
+    {
+      "target_name": "smartfarm_scheduler",
+      "sources": ["native/scheduler_addon.c"],
+      "cflags_c": ["-std=gnu11", "-O2", "-pthread"],
+      "ldflags": ["-pthread"],
+      "xcode_settings": {
+        "OTHER_CFLAGS": ["-std=gnu11", "-O2"]
+      }
+    }
+  ]
+}
@@ -6,214 +6,107 @@
 #include <fcntl.h>
 #endif
 
-#define MAX_FIELDS 10
-#define MAX_NAME_LENGTH 100
-#define MAX_INPUT_SIZE 8192
+#include "core/arena.h"
+#include "core/emit.h"
+#include "core/farm.h"
+#include "core/brute_force.h"
+#include "core/latency.h"
+#include "core/serve.h"
 
+// Exact reference scheduler: branch-and-bound search for the allocation
+// that maximizes the DP objective (see core/brute_force.h).
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    int moisture;
-    int waterNeeded;
-    int allocated;
-    int scheduled;
-    int originalIndex;
-} Field;
+    BruteForceOptions search;
+    int reportStats;
+    ServeOptions serve;
+} SchedulerOptions;
 
-typedef struct {
-    Field fields[MAX_FIELDS];
-    int fieldCount;
-    int totalWater;
-    int totalWaterUsed;
-    int remainingWater;
-} IrrigationData;
-
-char* findJsonValue(const char* json, const char* key) {
-    char searchKey[256];
-    snprintf(searchKey, sizeof(searchKey), "\"%s\":", key);
-    char* pos = strstr(json, searchKey);
-    if (!pos) return NULL;
-    pos += strlen(searchKey);
-    while (*pos == ' ' || *pos == '\t') pos++;
-    return pos;
-}
-
-int extractJsonNumber(const char* json, const char* key) {
-    char* pos = findJsonValue(json, key);
-    if (!pos) return 0;
-    return atoi(pos);
+int generateOutput(FILE *out, const IrrigationData *data, OutputFormat format) {
+    if (!data) {
+        fprintf(out, "{\"error\":\"Invalid data\"}\n");
+        return 0;
+    }
+    return emitSchedule(out, data, NULL, "BranchAndBound", 0, format);
 }
 
-char* extractJsonString(const char* json, const char* key, char* buffer, int bufferSize) {
-    char* pos = findJsonValue(json, key);
-    if (!pos || *pos != '"') return NULL;
-    pos++;
-    int i = 0;
-    while (i < bufferSize - 1 && *pos != '"' && *pos != '\0') {
-        buffer[i++] = *pos++;
-    }
-    buffer[i] = '\0';
-    return buffer;
+// Gap between the proven upper bound and the score, relative to the bound.
+static double relativeGap(Score bound, Score score) {
+    return bound > 0 ? (double)(bound - score) / (double)bound : 0.0;
 }
 
-int compareFields(const void *a, const void *b) {
-    const Field *fieldA = (const Field *)a;
-    const Field *fieldB = (const Field *)b;
-    if (fieldA->moisture != fieldB->moisture)
-        return fieldA->moisture - fieldB->moisture;
-    return fieldB->waterNeeded - fieldA->waterNeeded;
+static void reportStats(const IrrigationData *data, const BruteForceStats *stats, double wallMs) {
+    fprintf(stderr,
+            "bnb_stats fields=%d water=%d threads=%d tasks=%d nodes=%lld seed_score=%lld "
+            "best_score=%lld root_bound=%lld root_gap=%.6f gap=%.6f exact=%d wall_ms=%.3f\n",
+            data->fieldCount, data->totalWater, stats->threadsUsed, stats->tasks,
+            (long long)stats->nodes, (long long)stats->seedScore, (long long)stats->bestScore,
+            (long long)stats->rootBound, relativeGap(stats->rootBound, stats->bestScore),
+            relativeGap(stats->upperBound, stats->bestScore), stats->exact, wallMs);
 }
 
-int parseInput(const char *jsonString, IrrigationData *data) {
-    if (!jsonString || !data) return 0;
-    memset(data, 0, sizeof(IrrigationData));
-    data->totalWater = extractJsonNumber(jsonString, "totalWater");
-    if (data->totalWater <= 0) {
-        fprintf(stderr, "Error: Invalid total water amount\n");
-        return 0;
-    }
-    data->fieldCount = extractJsonNumber(jsonString, "fieldCount");
-    if (data->fieldCount <= 0 || data->fieldCount > MAX_FIELDS) {
-        fprintf(stderr, "Error: Invalid field count: %d\n", data->fieldCount);
+int handleRequest(const char *input, size_t length, FILE *out, Arena *arena, void *context) {
+    const SchedulerOptions *options = context;
+    IrrigationData data;
+    BruteForceStats stats;
+    if (!parseServedInput(input, length, &data, arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
         return 0;
     }
-    char* fieldsStart = strstr(jsonString, "\"fields\":");
-    if (!fieldsStart) {
-        fprintf(stderr, "Error: Fields array not found\n");
+    uint64_t start = monotonicMicros();
+    if (!bruteForceSchedule(&data, &options->search, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for search state\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
         return 0;
     }
-    fieldsStart = strchr(fieldsStart, '[');
-    if (!fieldsStart) {
-        fprintf(stderr, "Error: Fields array start not found\n");
+    double wallMs = (monotonicMicros() - start) / 1000.0;
+    if (!generateOutput(out, &data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
         return 0;
     }
-    char* fieldPos = fieldsStart + 1;
-    int fieldIndex = 0;
-    while (fieldIndex < data->fieldCount && fieldPos) {
-        fieldPos = strchr(fieldPos, '{');
-        if (!fieldPos) break;
-        char* fieldEnd = strchr(fieldPos, '}');
-        if (!fieldEnd) break;
-        int fieldLen = fieldEnd - fieldPos + 1;
-        char fieldStr[1024];
-        if (fieldLen < sizeof(fieldStr)) {
-            strncpy(fieldStr, fieldPos, fieldLen);
-            fieldStr[fieldLen] = '\0';
-            char nameBuffer[MAX_NAME_LENGTH];
-            if (extractJsonString(fieldStr, "name", nameBuffer, sizeof(nameBuffer))) {
-                strncpy(data->fields[fieldIndex].name, nameBuffer, MAX_NAME_LENGTH - 1);
-                data->fields[fieldIndex].name[MAX_NAME_LENGTH - 1] = '\0';
-                data->fields[fieldIndex].originalIndex = fieldIndex;
-                data->fields[fieldIndex].moisture = extractJsonNumber(fieldStr, "moisture");
-                data->fields[fieldIndex].waterNeeded = extractJsonNumber(fieldStr, "waterNeeded");
-                if (data->fields[fieldIndex].moisture < 0 || data->fields[fieldIndex].moisture > 100) {
-                    fprintf(stderr, "Error: Invalid moisture level for field %s: %d\n", 
-                            data->fields[fieldIndex].name, data->fields[fieldIndex].moisture);
-                    return 0;
-                }
-                if (data->fields[fieldIndex].waterNeeded < 0) {
-                    fprintf(stderr, "Error: Invalid water needed for field %s: %d\n", 
-                            data->fields[fieldIndex].name, data->fields[fieldIndex].waterNeeded);
-                    return 0;
-                }
-                fieldIndex++;
-            }
-        }
-        fieldPos = fieldEnd + 1;
-    }
-    data->fieldCount = fieldIndex;
-    return fieldIndex > 0;
+    if (options->reportStats) reportStats(&data, &stats, wallMs);
+    return 1;
 }
 
-void generateOutput(const IrrigationData *data) {
-    if (!data) {
-        printf("{\"error\":\"Invalid data\"}\n");
-        return;
-    }
-    printf("{\n");
-    printf("  \"algorithm\": \"GreedyNoTime\",\n");
-    printf("  \"scheduled\": [\n");
-    int scheduledCount = 0;
-    for (int i = 0; i < data->fieldCount; i++) {
-        if (data->fields[i].scheduled) {
-            if (scheduledCount > 0) printf(",\n");
-            printf("    {\n");
-            printf("      \"name\": \"%s\",\n", data->fields[i].name);
-            printf("      \"moisture\": %d,\n", data->fields[i].moisture);
-            printf("      \"need\": %d,\n", data->fields[i].waterNeeded);
-            printf("      \"allocated\": %d\n", data->fields[i].allocated);
-            printf("    }");
-            scheduledCount++;
+static int parseOptions(int argc, char **argv, SchedulerOptions *options) {
+    bruteForceOptionsInit(&options->search);
+    options->reportStats = 0;
+    serveOptionsInit(&options->serve);
+    for (int i = 1; i < argc; i++) {
+        if (parseServeOption(argc, argv, &i, &options->serve)) {
+            continue;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options->search.threads = atoi(argv[++i]);
+            if (options->search.threads < 1 || options->search.threads > BRUTE_FORCE_MAX_THREADS) {
+                fprintf(stderr, "Error: Thread count must be between 1 and %d\n",
+                        BRUTE_FORCE_MAX_THREADS);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--node-limit") == 0 && i + 1 < argc) {
+            options->search.nodeLimit = atoll(argv[++i]);
+            if (options->search.nodeLimit < 0) {
+                fprintf(stderr, "Error: Node limit must be 0 (unlimited) or positive\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options->reportStats = 1;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
         }
     }
-    printf("\n  ],\n");
-    printf("  \"totalWaterUsed\": %d,\n", data->totalWaterUsed);
-    printf("  \"remainingWater\": %d\n", data->remainingWater);
-    printf("}\n");
+    return 1;
 }
 
-int main() {
-    char input[MAX_INPUT_SIZE] = {0};
+int main(int argc, char **argv) {
 #ifdef _WIN32
     _setmode(_fileno(stdin), _O_BINARY);
     _setmode(_fileno(stdout), _O_BINARY);
 #endif
-    size_t totalRead = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), stdin) && totalRead < sizeof(input) - 1) {
-        size_t bufferLen = strlen(buffer);
-        if (totalRead + bufferLen < sizeof(input)) {
-            strcat(input + totalRead, buffer);
-            totalRead += bufferLen;
-        } else break;
-    }
-    if (totalRead == 0) {
-        fprintf(stderr, "Error: No input received\n");
-        printf("{\"error\":\"No input received\"}\n");
-        return 1;
-    }
-    IrrigationData data;
-    if (!parseInput(input, &data)) {
-        fprintf(stderr, "Error: Failed to parse input JSON\n");
-        printf("{\"error\":\"Failed to parse input JSON\"}\n");
+    SchedulerOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printf("{\"error\":\"Invalid command line options\"}\n");
         return 1;
     }
-    // Sort by priority: lowest moisture, highest water needed
-    qsort(data.fields, data.fieldCount, sizeof(Field), compareFields);
-    data.totalWaterUsed = 0;
-    data.remainingWater = data.totalWater;
-    for (int i = 0; i < data.fieldCount; i++) {
-        data.fields[i].scheduled = 0;
-        data.fields[i].allocated = 0;
-    }
-    for (int i = 0; i < data.fieldCount; i++) {
-        if (data.remainingWater >= data.fields[i].waterNeeded) {
-            data.fields[i].allocated = data.fields[i].waterNeeded;
-            data.fields[i].scheduled = 1;
-            data.remainingWater -= data.fields[i].waterNeeded;
-            data.totalWaterUsed += data.fields[i].waterNeeded;
-        } else if (data.remainingWater > 0) {
-            int minAllocation = data.fields[i].waterNeeded / 10;
-            if (data.remainingWater >= minAllocation) {
-                data.fields[i].allocated = data.remainingWater;
-                data.fields[i].scheduled = 1;
-                data.totalWaterUsed += data.remainingWater;
-                data.remainingWater = 0;
-            }
-            break;
-        } else {
-            break;
-        }
-    }
-    // Restore field order if needed
-    for (int i = 0; i < data.fieldCount; i++) {
-        for (int j = i + 1; j < data.fieldCount; j++) {
-            if (data.fields[j].originalIndex < data.fields[i].originalIndex) {
-                Field temp = data.fields[i];
-                data.fields[i] = data.fields[j];
-                data.fields[j] = temp;
-            }
-        }
-    }
-    generateOutput(&data);
-    return 0;
+    return runScheduler(&options.serve, handleRequest, &options);
 }
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "core/algorithms.h"
+#include "core/arena.h"
+#include "core/emit.h"
+#include "core/farm.h"
+#include "core/serve.h"
+#include "core/thread.h"
+
+// Runs several schedulers on one request: the input is parsed and
+// prioritized once, each algorithm gets its own copy of the fields and the
+// shared priority order, and the schedules come back side by side with
+// their objective and wall time.
+
+typedef struct {
+    AlgorithmOptions algorithms;
+    const SchedulerAlgorithm *selected[SCHEDULER_ALGORITHM_COUNT];
+    int selectedCount;
+    int parallel;
+    ServeOptions serve;
+} CompareOptions;
+
+typedef struct {
+    const SchedulerAlgorithm *algorithm;
+    const AlgorithmOptions *options;
+    const int *order;
+    IrrigationData data;
+    Arena arena;
+    int ok;
+    double wallMs;
+} AlgorithmRun;
+
+static ThreadResult THREAD_CALL runAlgorithm(void *arg) {
+    AlgorithmRun *run = arg;
+    uint64_t start = monotonicMicros();
+
+    run->ok = run->algorithm->schedule(&run->data, run->order, &run->arena, run->options);
+    run->wallMs = (monotonicMicros() - start) / 1000.0;
+    return 0;
+}
+
+static int prepareRun(AlgorithmRun *run, const SchedulerAlgorithm *algorithm,
+                      const AlgorithmOptions *options, const IrrigationData *data,
+                      const int *order) {
+    memset(run, 0, sizeof(*run));
+    run->algorithm = algorithm;
+    run->options = options;
+    run->order = order;
+    run->data = *data;
+    arenaInit(&run->arena);
+    run->data.fields = arenaAlloc(&run->arena, (size_t)data->fieldCount * sizeof(Field));
+    if (!run->data.fields) return 0;
+    memcpy(run->data.fields, data->fields, (size_t)data->fieldCount * sizeof(Field));
+    return 1;
+}
+
+static void printSummary(const IrrigationData *data, const AlgorithmRun *runs, int runCount,
+                         double sharedMs) {
+    fprintf(stderr, "compare fields=%d water=%d parse_sort_ms=%.3f\n",
+            data->fieldCount, data->totalWater, sharedMs);
+    fprintf(stderr, "%-20s %14s %11s %10s %10s\n",
+            "algorithm", "objective", "water_used", "scheduled", "wall_ms");
+    for (int r = 0; r < runCount; r++) {
+        const AlgorithmRun *run = &runs[r];
+        int scheduled = 0;
+        if (!run->ok) {
+            fprintf(stderr, "%-20s %14s\n", run->algorithm->name, "out of memory");
+            continue;
+        }
+        for (int i = 0; i < run->data.fieldCount; i++) {
+            scheduled += run->data.fields[i].scheduled;
+        }
+        fprintf(stderr, "%-20s %14.4f %11d %10d %10.3f\n", run->algorithm->name,
+                scheduleObjective(&run->data), run->data.totalWaterUsed, scheduled, run->wallMs);
+    }
+}
+
+static void emitReport(OutputBuffer *buffer, const AlgorithmRun *runs, int runCount, int compact) {
+    const char *newline = compact ? "" : "\n";
+
+    outputText(buffer, "[");
+    outputText(buffer, newline);
+    for (int r = 0; r < runCount; r++) {
+        const AlgorithmRun *run = &runs[r];
+        if (r > 0) {
+            outputText(buffer, ",");
+            outputText(buffer, newline);
+        }
+        if (!run->ok) {
+            outputText(buffer, "{\"algorithm\":\"");
+            outputText(buffer, run->algorithm->name);
+            outputText(buffer, "\",\"error\":\"Out of memory\"}");
+            continue;
+        }
+        ScheduleMetrics metrics;
+        metrics.objective = scheduleObjective(&run->data);
+        metrics.wallMs = run->wallMs;
+        metrics.optimal = -1;
+        // Every schedule is listed in input order, greedy's included
+        emitScheduleObject(buffer, &run->data, NULL, run->algorithm->name,
+                           run->algorithm->honorsTime && run->data.useTimeConstraints,
+                           compact, &metrics);
+    }
+    outputText(buffer, newline);
+    outputText(buffer, "]\n");
+}
+
+int handleRequest(const char *input, size_t length, FILE *out, Arena *arena, void *context) {
+    const CompareOptions *options = context;
+    AlgorithmRun runs[SCHEDULER_ALGORITHM_COUNT];
+    ThreadHandle threads[SCHEDULER_ALGORITHM_COUNT];
+    int threaded[SCHEDULER_ALGORITHM_COUNT] = {0};
+    IrrigationData data;
+    OutputBuffer buffer;
+    int prepared = 0;
+    int ok = 1;
+
+    uint64_t start = monotonicMicros();
+    if (!parseServedInput(input, length, &data, arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+
+    // Prioritize once for every algorithm
+    const int *order = prioritizeFields(&data, arena);
+    if (!order) {
+        fprintf(stderr, "Error: Out of memory prioritizing fields\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    double sharedMs = (monotonicMicros() - start) / 1000.0;
+
+    for (; prepared < options->selectedCount; prepared++) {
+        if (!prepareRun(&runs[prepared], options->selected[prepared], &options->algorithms,
+                        &data, order)) {
+            arenaRelease(&runs[prepared].arena);
+            ok = 0;
+            break;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Out of memory copying fields\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        for (int r = 0; r < prepared; r++) arenaRelease(&runs[r].arena);
+        return 0;
+    }
+
+    for (int r = 0; r < prepared; r++) {
+        if (options->parallel && r + 1 < prepared) {
+            threaded[r] = threadCreate(&threads[r], runAlgorithm, &runs[r]);
+        }
+        if (!threaded[r]) runAlgorithm(&runs[r]);
+    }
+    for (int r = 0; r < prepared; r++) {
+        if (threaded[r]) threadJoin(threads[r]);
+        if (!runs[r].ok) ok = 0;
+    }
+
+    OutputFormat format = serveOutputFormat(&options->serve);
+    outputInit(&buffer);
+    emitReport(&buffer, runs, prepared, format == OUTPUT_COMPACT);
+    if (!outputFlush(&buffer, out)) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        ok = 0;
+    }
+    outputFree(&buffer);
+
+    if (options->serve.mode == SERVE_ONCE) {
+        printSummary(&data, runs, prepared, sharedMs);
+    }
+    for (int r = 0; r < prepared; r++) arenaRelease(&runs[r].arena);
+    return ok;
+}
+
+// Parses a comma-separated list of registry keys.
+static int parseAlgorithmList(const char *list, CompareOptions *options) {
+    options->selectedCount = 0;
+    while (*list) {
+        const char *comma = strchr(list, ',');
+        size_t length = comma ? (size_t)(comma - list) : strlen(list);
+        const SchedulerAlgorithm *algorithm = findAlgorithm(list, length);
+
+        if (!algorithm) {
+            fprintf(stderr, "Error: Unknown algorithm: %.*s\n", (int)length, list);
+            return 0;
+        }
+        for (int i = 0; i < options->selectedCount; i++) {
+            if (options->selected[i] == algorithm) algorithm = NULL;
+        }
+        if (algorithm) options->selected[options->selectedCount++] = algorithm;
+        list += length + (comma ? 1 : 0);
+    }
+    return options->selectedCount > 0;
+}
+
+static int parseOptions(int argc, char **argv, CompareOptions *options) {
+    algorithmOptionsInit(&options->algorithms);
+    serveOptionsInit(&options->serve);
+    options->parallel = 0;
+    options->selectedCount = SCHEDULER_ALGORITHM_COUNT;
+    for (int i = 0; i < SCHEDULER_ALGORITHM_COUNT; i++) {
+        options->selected[i] = &schedulerAlgorithms[i];
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (parseServeOption(argc, argv, &i, &options->serve)) {
+            continue;
+        } else if (strcmp(argv[i], "--algorithms") == 0 && i + 1 < argc) {
+            if (!parseAlgorithmList(argv[++i], options)) return 0;
+        } else if (strcmp(argv[i], "--parallel") == 0) {
+            options->parallel = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            int threads = atoi(argv[++i]);
+            options->algorithms.dp.threads = threads;
+            if (threads < 1 || threads > MAX_THREADS) {
+                fprintf(stderr, "Error: Thread count must be between 1 and %d\n", MAX_THREADS);
+                return 0;
+            }
+            options->algorithms.bruteForce.threads = options->algorithms.dp.threads;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
+        }
+    }
+
+    if (options->serve.format == OUTPUT_BINARY) {
+        fprintf(stderr, "Error: Binary output is not available for comparison reports\n");
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    CompareOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printf("{\"error\":\"Invalid command line options\"}\n");
+        return 1;
+    }
+
+    return runScheduler(&options.serve, handleRequest, &options);
+}
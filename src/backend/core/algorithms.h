@@ -0,0 +1,101 @@
+#ifndef SMARTFARM_ALGORITHMS_H
+#define SMARTFARM_ALGORITHMS_H
+
+#include <string.h>
+
+#include "arena.h"
+#include "brute_force.h"
+#include "dp.h"
+#include "farm.h"
+#include "greedy.h"
+#include "power.h"
+
+// Registry of the scheduling algorithms for tools that run several of them
+// on one request. Every entry takes the priority order from
+// prioritizeFields and leaves the fields where they are, so the caller
+// prioritizes once and hands each algorithm its own copy of the fields.
+
+typedef struct {
+    DPOptions dp;
+    BruteForceOptions bruteForce;
+    PowerOptions power;
+} AlgorithmOptions;
+
+// Returns 0 if the algorithm ran out of memory.
+typedef int (*OrderedScheduleFn)(IrrigationData *data, const int *order, Arena *arena,
+                                 const AlgorithmOptions *options);
+
+typedef struct {
+    const char *key;            // command-line and API name
+    const char *name;           // "algorithm" value in the output
+    OrderedScheduleFn schedule;
+    int honorsTime;             // reports time and electricity when constrained
+} SchedulerAlgorithm;
+
+static inline int runGreedyOrdered(IrrigationData *data, const int *order, Arena *arena,
+                                   const AlgorithmOptions *options) {
+    (void)arena;
+    (void)options;
+    greedyApplyDefaults(data);
+    greedyScheduleOrdered(data, order);
+    return 1;
+}
+
+static inline int runDPOrdered(IrrigationData *data, const int *order, Arena *arena,
+                               const AlgorithmOptions *options) {
+    DPStats stats;
+    return dpScheduleOrdered(data, order, &options->dp, arena, &stats);
+}
+
+static inline int runBruteForceOrdered(IrrigationData *data, const int *order, Arena *arena,
+                                       const AlgorithmOptions *options) {
+    BruteForceStats stats;
+    return bruteForceScheduleOrdered(data, order, &options->bruteForce, arena, &stats);
+}
+
+static inline int runPowerOrdered(IrrigationData *data, const int *order, Arena *arena,
+                                  const AlgorithmOptions *options) {
+    PowerStats stats;
+    return powerScheduleOrdered(data, order, &options->power, arena, &stats);
+}
+
+static const SchedulerAlgorithm schedulerAlgorithms[] = {
+    {"greedy", "Greedy", runGreedyOrdered, 1},
+    {"dp", "DynamicProgramming", runDPOrdered, 0},
+    {"bruteForce", "BranchAndBound", runBruteForceOrdered, 0},
+    {"power", "PowerConstrainedDP", runPowerOrdered, 1},
+};
+
+#define SCHEDULER_ALGORITHM_COUNT \
+    ((int)(sizeof(schedulerAlgorithms) / sizeof(schedulerAlgorithms[0])))
+
+static inline const SchedulerAlgorithm *findAlgorithm(const char *key, size_t length) {
+    for (int i = 0; i < SCHEDULER_ALGORITHM_COUNT; i++) {
+        if (strlen(schedulerAlgorithms[i].key) == length &&
+            memcmp(schedulerAlgorithms[i].key, key, length) == 0) {
+            return &schedulerAlgorithms[i];
+        }
+    }
+    return NULL;
+}
+
+static inline void algorithmOptionsInit(AlgorithmOptions *options) {
+    dpOptionsInit(&options->dp);
+    bruteForceOptionsInit(&options->bruteForce);
+    powerOptionsInit(&options->power);
+}
+
+// The DP's objective: the sum of (100 - moisture) * allocated / waterNeeded
+// over all fields. Used to compare every algorithm's schedule on one scale.
+static inline double scheduleObjective(const IrrigationData *data) {
+    double objective = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (field->scheduled && field->waterNeeded > 0) {
+            objective += (100.0 - field->moisture) * field->allocated / field->waterNeeded;
+        }
+    }
+    return objective;
+}
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef SMARTFARM_ANYTIME_H
+#define SMARTFARM_ANYTIME_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "approx.h"
+#include "arena.h"
+#include "dp.h"
+#include "emit.h"
+#include "farm.h"
+#include "latency.h"
+#include "score.h"
+
+// Deadline-bounded DP for requests that carry a "deadlineMs". A greedy
+// fill in order of score per unit of water gives a schedule at once. It
+// matches the fractional bound (see approx.h), and so is optimal, unless
+// the water left for the partly filled field is under that field's
+// minimum. Refinement rounds then run the exact DP in a band of budgets
+// around the best schedule's running totals, which can only improve it,
+// with the band growing APPROX_QUANTUM_STEP-fold each round. The full lean
+// DP is the last round: once the band would cover a quarter of the budget,
+// or sooner, if it fits, after a round that found nothing better. The band
+// rounds then cost at most a third more than the full DP alone.
+//
+// The result is proven optimal when it meets the bound or the full DP
+// ran. A round cannot be stopped once it starts, so it only starts when
+// its cells, at the throughput the earlier rounds measured, fit before the
+// deadline with a quarter to spare.
+
+#define ANYTIME_CELLS_PER_MICRO 50.0    // until a round has been timed
+#define ANYTIME_MIN_BAND 16
+
+typedef struct {
+    int deadlineMs;
+    int rounds;             // band rounds run
+    int band;               // band of the last round
+    int exact;              // 1 if the full DP ran
+    int optimal;            // 1 if the full DP ran or the bound was met
+    int cutShort;           // 1 if the deadline stopped the rounds
+    Score greedyScore;
+    Score bestScore;
+    Score upperBound;       // fractional fill: no schedule scores more
+    double cellsPerMicro;   // throughput of the last round
+    uint64_t greedyMicros;
+    uint64_t elapsedMicros;
+    size_t peakTableBytes;
+} AnytimeStats;
+
+// Score of the schedule in the fields.
+static inline Score anytimeScore(const IrrigationData *data) {
+    Score score = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (field->scheduled && field->waterNeeded > 0) {
+            score += fieldRate(field) * field->allocated;
+        }
+    }
+    return score;
+}
+
+static inline double anytimeObjective(Score score) {
+    return (double)score / (double)(1ll << SCORE_SHIFT);
+}
+
+// Fills the fields in rate order, each with all the water left up to its
+// need, skipping any the rest cannot give its minimum. Writes the schedule
+// into the fields and its score and the fractional fill's into stats.
+// Returns 0 if out of memory.
+static int anytimeGreedy(IrrigationData *data, Arena *arena, AnytimeStats *stats) {
+    ApproxItem *items = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(ApproxItem));
+    int64_t room = data->totalWater, fill = data->totalWater;
+    int count = 0;
+
+    if (!items) return 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        Field *field = &data->fields[i];
+        field->allocated = 0;
+        field->scheduled = 0;
+        if (field->waterNeeded <= 0 || field->moisture >= 100) continue;
+        items[count].field = i;
+        items[count].rate = fieldRate(field);
+        count++;
+    }
+    qsort(items, count, sizeof(ApproxItem), compareApproxItems);
+
+    for (int k = 0; k < count && room > 0; k++) {
+        Field *field = &data->fields[items[k].field];
+        int need = field->waterNeeded;
+        int take = need < fill ? need : (int)fill;
+        stats->upperBound += items[k].rate * take;
+        fill -= take;
+
+        take = need < room ? need : (int)room;
+        if (take < (need + 9) / 10) continue;
+        field->allocated = take;
+        field->scheduled = 1;
+        stats->greedyScore += items[k].rate * take;
+        room -= take;
+    }
+    finishAllocation(data, (int)(data->totalWater - room));
+    stats->bestScore = stats->greedyScore;
+    return 1;
+}
+
+// True if a round of the given cells, at the measured throughput, ends
+// before the deadline with a quarter of its time to spare.
+static int anytimeFits(int64_t cells, double cellsPerMicro, uint64_t deadline) {
+    double micros = (double)cells / cellsPerMicro * 1.25;
+    uint64_t now = monotonicMicros();
+    return now < deadline && micros <= (double)(deadline - now);
+}
+
+// Schedules with the fields in the given priority order (from
+// prioritizeFields) and the best schedule found by deadline, a
+// monotonicMicros() time, in the fields. Running out of memory in a
+// refinement round keeps the schedule found so far. Returns 0 only if the
+// greedy pass itself runs out of memory.
+static inline int anytimeScheduleOrdered(IrrigationData *data, const int *order,
+                                         const DPOptions *options, uint64_t deadline,
+                                         Arena *arena, AnytimeStats *stats) {
+    uint64_t start = monotonicMicros();
+    int *allocated = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    DPOptions lean = *options;
+    int band = ANYTIME_MIN_BAND;
+    int stale = 0;              // the last band round found nothing better
+
+    memset(stats, 0, sizeof(*stats));
+    stats->deadlineMs = data->deadlineMs;
+    stats->cellsPerMicro = ANYTIME_CELLS_PER_MICRO;
+    if (!allocated || !anytimeGreedy(data, arena, stats)) return 0;
+    stats->greedyMicros = monotonicMicros() - start;
+    stats->optimal = stats->bestScore >= stats->upperBound;
+
+    // The band first covers moving one field's minimum between fields
+    for (int i = 0; i < data->fieldCount; i++) {
+        int minWater = (data->fields[i].waterNeeded + 9) / 10;
+        if (minWater > band) band = minWater;
+    }
+    lean.memoryMode = DP_MEMORY_LEAN;
+
+    while (!stats->optimal) {
+        int64_t fullCells = (int64_t)data->fieldCount * (data->totalWater + 1);
+        int full = (int64_t)(2 * band + 1) * APPROX_QUANTUM_STEP > data->totalWater ||
+                   (stale && anytimeFits(fullCells, stats->cellsPerMicro, deadline));
+        int64_t cells = full ? fullCells : (int64_t)data->fieldCount * (2 * band + 1);
+        if (!anytimeFits(cells, stats->cellsPerMicro, deadline)) {
+            stats->cutShort = 1;
+            break;
+        }
+
+        for (int k = 0; k < data->fieldCount; k++) {
+            allocated[k] = data->fields[order[k]].allocated;
+        }
+        uint64_t roundStart = monotonicMicros();
+        if (full) {
+            DPStats dpStats;
+            for (int i = 0; i < data->fieldCount; i++) {
+                data->fields[i].allocated = 0;
+                data->fields[i].scheduled = 0;
+            }
+            if (!dpScheduleOrdered(data, order, &lean, arena, &dpStats)) {
+                int64_t used = 0;
+                for (int k = 0; k < data->fieldCount; k++) {
+                    Field *field = &data->fields[order[k]];
+                    field->allocated = allocated[k];
+                    field->scheduled = allocated[k] > 0;
+                    used += allocated[k];
+                }
+                finishAllocation(data, (int)used);
+                break;
+            }
+            stats->bestScore = dpStats.bestScore;
+            stats->exact = 1;
+            stats->optimal = 1;
+            if (dpStats.peakTableBytes > stats->peakTableBytes) {
+                stats->peakTableBytes = dpStats.peakTableBytes;
+            }
+        } else {
+            Score score = approxBandDP(data, order, allocated, band, arena,
+                                       &stats->peakTableBytes);
+            if (score < 0) break;
+            stats->rounds++;
+            stats->band = band;
+            stale = score <= stats->bestScore;
+            stats->bestScore = score;
+            stats->optimal = score >= stats->upperBound;
+            band *= APPROX_QUANTUM_STEP;
+        }
+        uint64_t roundMicros = monotonicMicros() - roundStart;
+        stats->cellsPerMicro = (double)cells / (double)(roundMicros > 0 ? roundMicros : 1);
+    }
+    stats->elapsedMicros = monotonicMicros() - start;
+    return 1;
+}
+
+// Prioritizes and schedules; fields stay in input order. Returns 0 if
+// memory runs out before there is any schedule.
+static inline int anytimeSchedule(IrrigationData *data, const DPOptions *options,
+                                  uint64_t deadline, Arena *arena, AnytimeStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return anytimeScheduleOrdered(data, order, options, deadline, arena, stats);
+}
+
+// The schedule with its objective, wall time since the request arrived
+// and the "optimal" flag. The binary layout has no room for them and
+// carries the schedule alone.
+static inline int emitAnytime(FILE *out, const IrrigationData *data, const AnytimeStats *stats,
+                              const char *algorithm, double wallMs, OutputFormat format) {
+    OutputBuffer buffer;
+    ScheduleMetrics metrics;
+    int ok;
+
+    if (format == OUTPUT_BINARY) return emitSchedule(out, data, NULL, algorithm, 0, format);
+
+    uint64_t start = phaseBegin();
+    metrics.objective = anytimeObjective(stats->bestScore);
+    metrics.wallMs = wallMs;
+    metrics.optimal = stats->optimal;
+    outputInit(&buffer);
+    emitScheduleObject(&buffer, data, NULL, algorithm, 0, format == OUTPUT_COMPACT, &metrics);
+    outputText(&buffer, "\n");
+    ok = outputFlush(&buffer, out);
+    outputFree(&buffer);
+    phaseEnd(PHASE_OUTPUT, start);
+    return ok;
+}
+
+#endif
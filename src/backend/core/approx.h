@@ -0,0 +1,325 @@
+#ifndef SMARTFARM_APPROX_H
+#define SMARTFARM_APPROX_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "farm.h"
+#include "score.h"
+
+// Coarse-to-fine DP with a certified error bound. The water axis is first
+// solved in cells of q units: every need is rounded up to whole cells, so
+// the coarse schedule, scaled back, fits the real budget. The exact DP then
+// runs only inside a band of budgets around that schedule's running total,
+// which lets it shift water between fields and spend what the rounding
+// left unused. Time and table memory go from fieldCount * totalWater to
+// fieldCount * (totalWater / q + band).
+//
+// The fractional fill by rate (every field topped up in order of score per
+// unit of water, ignoring minimums) bounds the optimum from above. A
+// schedule within epsilon of it is returned; otherwise the quantum shrinks
+// and the rounds repeat, ending with the full DP at q = 1. The result is
+// always within epsilon of the optimum.
+
+#define APPROX_QUANTUM_STEP 4
+
+typedef struct {
+    double epsilon;
+    int quantum;           // water units per coarse cell in the last round
+    int coarseWater;       // coarse budget, in cells
+    int band;              // budgets kept either side of the coarse schedule
+    int rounds;
+    int fullFallback;      // 1 if the rounds ended with the full DP
+    Score coarseScore;     // the last coarse schedule at full resolution
+    Score bestScore;
+    Score upperBound;      // fractional fill: no schedule scores more
+    size_t peakTableBytes;
+} ApproxStats;
+
+typedef struct {
+    int field;
+    Score rate;
+} ApproxItem;
+
+static int compareApproxItems(const void *a, const void *b) {
+    const ApproxItem *itemA = a;
+    const ApproxItem *itemB = b;
+    if (itemA->rate != itemB->rate) return itemA->rate > itemB->rate ? -1 : 1;
+    return itemA->field - itemB->field;
+}
+
+// Fractional fill of the budget in rate order; filledFields counts the
+// fields it waters. Returns -1 if out of memory.
+static Score approxUpperBound(const IrrigationData *data, Arena *arena, int *filledFields) {
+    ApproxItem *items = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(ApproxItem));
+    int64_t room = data->totalWater;
+    Score bound = 0;
+    int count = 0;
+
+    if (!items) return -1;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (field->waterNeeded <= 0 || field->moisture >= 100) continue;
+        items[count].field = i;
+        items[count].rate = fieldRate(field);
+        count++;
+    }
+    qsort(items, count, sizeof(ApproxItem), compareApproxItems);
+    *filledFields = 0;
+    for (int k = 0; k < count && room > 0; k++) {
+        int need = data->fields[items[k].field].waterNeeded;
+        int take = need < room ? need : (int)room;
+        bound += items[k].rate * take;
+        room -= take;
+        (*filledFields)++;
+    }
+    return bound;
+}
+
+// Solves the request at quantum q and writes the scaled-back schedule into
+// allocated[], indexed by priority position. A field of need N becomes one
+// of need ceil(N / q); its minimum, ceil(N / 10) rounded up to cells, is
+// the coarse field's own minimum, so every scaled-back allocation is valid.
+static int approxCoarse(const IrrigationData *data, const int *order, int quantum,
+                        const DPOptions *options, Arena *arena, int *allocated,
+                        size_t *peakBytes) {
+    IrrigationData coarse = *data;
+    DPStats stats;
+
+    coarse.fields = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(Field));
+    if (!coarse.fields) return 0;
+    memcpy(coarse.fields, data->fields, (size_t)data->fieldCount * sizeof(Field));
+    coarse.totalWater = data->totalWater / quantum;
+    for (int i = 0; i < coarse.fieldCount; i++) {
+        Field *field = &coarse.fields[i];
+        field->waterNeeded = (int)(((int64_t)field->waterNeeded + quantum - 1) / quantum);
+        field->allocated = 0;
+        field->scheduled = 0;
+    }
+    if (!dpScheduleOrdered(&coarse, order, options, arena, &stats)) return 0;
+    if (stats.peakTableBytes > *peakBytes) *peakBytes = stats.peakTableBytes;
+
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &coarse.fields[order[k]];
+        int64_t water = (int64_t)field->allocated * quantum;
+        int need = data->fields[order[k]].waterNeeded;
+        allocated[k] = field->scheduled ? (water < need ? (int)water : need) : 0;
+    }
+    return 1;
+}
+
+// Budgets [low, high] a banded row keeps.
+typedef struct {
+    int low;
+    int high;
+} ApproxBand;
+
+// Row update over a band: the deque kernel with j limited to the previous
+// row's band.
+static void approxBandRow(const Score *prev, ApproxBand from, Score *cur, ApproxBand to,
+                          int *window, int windowMask, const Field *field, ChoiceLog *log,
+                          int row) {
+    int minWater = (field->waterNeeded + 9) / 10;
+    Score rate = field->waterNeeded > 0 ? fieldRate(field) : 0;
+    int head = 0, tail = 0;
+    int next = to.low - field->waterNeeded > from.low ? to.low - field->waterNeeded : from.low;
+
+    for (int w = to.low; w <= to.high; w++) {
+        cur[w - to.low] = w >= from.low && w <= from.high ? prev[w - from.low]
+                                                          : SCORE_UNREACHABLE;
+        if (field->waterNeeded <= 0) continue;
+
+        for (; next <= from.high && next <= w - minWater; next++) {
+            if (prev[next - from.low] < 0) continue;
+            Score key = prev[next - from.low] - rate * next;
+            while (tail > head) {
+                int back = window[(tail - 1) & windowMask];
+                if (prev[back - from.low] - rate * back > key) break;
+                tail--;
+            }
+            window[tail++ & windowMask] = next;
+        }
+        while (tail > head && window[head & windowMask] < w - field->waterNeeded) head++;
+        if (tail == head) continue;
+
+        int source = window[head & windowMask];
+        Score candidate = prev[source - from.low] + rate * (w - source);
+        if (candidate > cur[w - to.low]) {
+            cur[w - to.low] = candidate;
+            choiceLogPut(log, row, w - to.low, (uint64_t)(w - source - minWater) + 1);
+        }
+    }
+}
+
+// Exact DP over the budgets within band of the reference schedule's
+// running total after each row (allocated[], by priority position), so the
+// reference itself is always a candidate. Writes the best schedule into
+// the fields and returns its score, or -1 if out of memory.
+static Score approxBandDP(IrrigationData *data, const int *order, const int *allocated,
+                          int band, Arena *arena, size_t *peakBytes) {
+    int fieldCount = data->fieldCount;
+    ApproxBand *bands = arenaAlloc(arena, ((size_t)fieldCount + 1) * sizeof(ApproxBand));
+    ChoiceLog log;
+    int64_t total = 0;
+    int width = 1;
+
+    if (!bands) return -1;
+    bands[0].low = 0;
+    bands[0].high = 0;
+    for (int k = 0; k < fieldCount; k++) {
+        total += allocated[k];
+        bands[k + 1].low = total - band > 0 ? (int)(total - band) : 0;
+        bands[k + 1].high = total + band < data->totalWater ? (int)(total + band)
+                                                            : data->totalWater;
+        if (bands[k + 1].high - bands[k + 1].low + 1 > width) {
+            width = bands[k + 1].high - bands[k + 1].low + 1;
+        }
+    }
+
+    // Choice log rows cover only their band
+    log.rowOffset = arenaAlloc(arena, ((size_t)fieldCount + 1) * sizeof(size_t));
+    log.rowBits = arenaAlloc(arena, (size_t)fieldCount + 1);
+    if (!log.rowOffset || !log.rowBits) return -1;
+    log.totalWords = 0;
+    for (int k = 0; k < fieldCount; k++) {
+        log.rowBits[k] = (unsigned char)choiceBitsFor(&data->fields[order[k]]);
+        log.rowOffset[k] = log.totalWords;
+        log.totalWords += choiceRowWords(log.rowBits[k], bands[k + 1].high - bands[k + 1].low);
+    }
+    log.words = arenaAllocAligned(arena, (log.totalWords + 1) * sizeof(uint64_t), CACHE_LINE);
+
+    int windowSlots = 1;
+    while (windowSlots < width + 1) windowSlots <<= 1;
+    Score *prev = arenaAlloc(arena, (size_t)width * sizeof(Score));
+    Score *cur = arenaAlloc(arena, (size_t)width * sizeof(Score));
+    int *window = arenaAlloc(arena, (size_t)windowSlots * sizeof(int));
+    if (!log.words || !prev || !cur || !window) return -1;
+    memset(log.words, 0, log.totalWords * sizeof(uint64_t));
+    size_t bytes = log.totalWords * sizeof(uint64_t) + (size_t)fieldCount * (sizeof(size_t) + 1) +
+                   (size_t)width * 2 * sizeof(Score) + (size_t)windowSlots * sizeof(int);
+    if (bytes > *peakBytes) *peakBytes = bytes;
+
+    prev[0] = 0;
+    for (int k = 0; k < fieldCount; k++) {
+        approxBandRow(prev, bands[k], cur, bands[k + 1], window, windowSlots - 1,
+                      &data->fields[order[k]], &log, k);
+        Score *swap = prev;
+        prev = cur;
+        cur = swap;
+    }
+
+    const ApproxBand *last = &bands[fieldCount];
+    int best_w = last->low;
+    Score best_value = SCORE_UNREACHABLE;
+    for (int w = last->low; w <= last->high; w++) {
+        if (prev[w - last->low] > best_value) {
+            best_value = prev[w - last->low];
+            best_w = w;
+        }
+    }
+
+    for (int i = 0; i < fieldCount; i++) {
+        data->fields[i].allocated = 0;
+        data->fields[i].scheduled = 0;
+    }
+    int current_w = best_w;
+    for (int k = fieldCount - 1; k >= 0; k--) {
+        uint64_t code = choiceLogGet(&log, k, current_w - bands[k + 1].low);
+        if (code) {
+            Field *field = &data->fields[order[k]];
+            int x = (field->waterNeeded + 9) / 10 + (int)code - 1;
+            field->allocated = x;
+            field->scheduled = 1;
+            current_w -= x;
+        }
+    }
+    finishAllocation(data, best_w);
+    return best_value;
+}
+
+// Schedules within epsilon of the optimum, with the fields in the given
+// priority order (from prioritizeFields); the fields stay where they are.
+// Returns 0 when the tables do not fit in memory.
+static inline int approxScheduleOrdered(IrrigationData *data, const int *order,
+                                        const DPOptions *options, double epsilon,
+                                        Arena *arena, ApproxStats *stats) {
+    int *allocated = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    int filledFields = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->epsilon = epsilon;
+    stats->upperBound = approxUpperBound(data, arena, &filledFields);
+    if (!allocated || stats->upperBound < 0) return 0;
+    Score target = stats->upperBound - (Score)(epsilon * (double)stats->upperBound);
+
+    // Rounding leaves under q units, q / 2 on average, unused per watered
+    // field and at the end of the budget; the first quantum makes that
+    // about an epsilon share of it. The check against the bound, not this
+    // estimate, decides whether a round is good enough.
+    int64_t quantum = (int64_t)(2 * epsilon * data->totalWater / (filledFields + 1));
+    while (quantum > 1) {
+        stats->rounds++;
+        stats->quantum = (int)quantum;
+        stats->coarseWater = data->totalWater / (int)quantum;
+        if (!approxCoarse(data, order, (int)quantum, options, arena, allocated,
+                          &stats->peakTableBytes)) {
+            return 0;
+        }
+
+        int64_t used = 0;
+        stats->coarseScore = 0;
+        for (int k = 0; k < data->fieldCount; k++) {
+            Field *field = &data->fields[order[k]];
+            field->allocated = allocated[k];
+            field->scheduled = allocated[k] > 0;
+            if (allocated[k]) stats->coarseScore += fieldRate(field) * allocated[k];
+            used += allocated[k];
+        }
+        if (stats->coarseScore >= target) {
+            stats->bestScore = stats->coarseScore;
+            finishAllocation(data, (int)used);
+            return 1;
+        }
+
+        // Wide enough to spend everything the rounding left unused
+        int64_t band = data->totalWater - used > quantum ? data->totalWater - used : quantum;
+        if (2 * band >= data->totalWater) break;
+        stats->band = (int)band;
+        stats->bestScore = approxBandDP(data, order, allocated, (int)band, arena,
+                                        &stats->peakTableBytes);
+        if (stats->bestScore < 0) return 0;
+        if (stats->bestScore >= target) return 1;
+        quantum /= APPROX_QUANTUM_STEP;
+    }
+
+    DPStats dpStats;
+    stats->rounds++;
+    stats->quantum = 1;
+    stats->coarseWater = data->totalWater;
+    stats->band = 0;
+    stats->fullFallback = 1;
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].allocated = 0;
+        data->fields[i].scheduled = 0;
+    }
+    if (!dpScheduleOrdered(data, order, options, arena, &dpStats)) return 0;
+    stats->bestScore = dpStats.bestScore;
+    if (dpStats.peakTableBytes > stats->peakTableBytes) {
+        stats->peakTableBytes = dpStats.peakTableBytes;
+    }
+    return 1;
+}
+
+// Prioritizes and schedules; fields stay in input order. Returns 0 if
+// memory runs out.
+static inline int approxSchedule(IrrigationData *data, const DPOptions *options, double epsilon,
+                                 Arena *arena, ApproxStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return approxScheduleOrdered(data, order, options, epsilon, arena, stats);
+}
+
+#endif
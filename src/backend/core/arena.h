@@ -0,0 +1,146 @@
+#ifndef SMARTFARM_ARENA_H
+#define SMARTFARM_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARENA_MIN_BLOCK (64 * 1024)
+#define ARENA_ALIGN 16
+#define ARENA_READ_CHUNK 4096
+
+// Bump allocator over a list of blocks that double in size. Everything a
+// scheduler run needs (input text, field records) comes from one arena and
+// is released with a single arenaRelease.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t reservedBytes;
+    size_t usedBytes;           // handed out since the last reset
+} Arena;
+
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static inline unsigned char *arenaBlockData(ArenaBlock *block) {
+    return (unsigned char *)block + ARENA_HEADER_SIZE;
+}
+
+static inline void arenaInit(Arena *arena) {
+    arena->head = NULL;
+    arena->reservedBytes = 0;
+    arena->usedBytes = 0;
+}
+
+static inline void *arenaAlloc(Arena *arena, size_t size) {
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *block = arena->head;
+
+    if (!block || block->size - block->used < aligned) {
+        size_t blockSize = block ? block->size * 2 : ARENA_MIN_BLOCK;
+        if (blockSize < aligned) blockSize = aligned;
+
+        ArenaBlock *fresh = malloc(ARENA_HEADER_SIZE + blockSize);
+        if (!fresh) return NULL;
+        fresh->next = block;
+        fresh->size = blockSize;
+        fresh->used = 0;
+        arena->head = fresh;
+        arena->reservedBytes += blockSize;
+        block = fresh;
+    }
+
+    void *ptr = arenaBlockData(block) + block->used;
+    block->used += aligned;
+    arena->usedBytes += aligned;
+    return ptr;
+}
+
+// Resizes the most recent allocation in place when it is still at the top
+// of the current block; otherwise copies it into fresh space.
+static inline void *arenaGrow(Arena *arena, void *ptr, size_t oldSize, size_t newSize) {
+    ArenaBlock *block = arena->head;
+    size_t oldAligned = (oldSize + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    size_t newAligned = (newSize + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (ptr && block && (unsigned char *)ptr + oldAligned == arenaBlockData(block) + block->used &&
+        block->used - oldAligned + newAligned <= block->size) {
+        block->used = block->used - oldAligned + newAligned;
+        arena->usedBytes = arena->usedBytes - oldAligned + newAligned;
+        return ptr;
+    }
+
+    void *fresh = arenaAlloc(arena, newSize);
+    if (fresh && ptr) memcpy(fresh, ptr, oldSize < newSize ? oldSize : newSize);
+    return fresh;
+}
+
+// Over-allocates and rounds up so the result honours a larger alignment
+// (a power of two) than ARENA_ALIGN.
+static inline void *arenaAllocAligned(Arena *arena, size_t size, size_t alignment) {
+    unsigned char *raw = arenaAlloc(arena, size + alignment);
+    if (!raw) return NULL;
+    return (void *)(((uintptr_t)raw + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+// Drops every allocation but keeps the largest block for the next request,
+// so a long-running worker settles into a steady-state footprint.
+static inline void arenaReset(Arena *arena) {
+    ArenaBlock *keep = arena->head;
+    ArenaBlock *block = keep ? keep->next : NULL;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+        arena->reservedBytes = keep->size;
+    }
+    arena->usedBytes = 0;
+}
+
+static inline void arenaRelease(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->reservedBytes = 0;
+    arena->usedBytes = 0;
+}
+
+// Reads the whole stream into one NUL-terminated arena buffer, doubling the
+// buffer as needed so the read is linear in the input size.
+static inline char *arenaReadStream(Arena *arena, FILE *stream, size_t *length) {
+    size_t capacity = ARENA_READ_CHUNK;
+    size_t used = 0;
+    char *buffer = arenaAlloc(arena, capacity);
+    if (!buffer) return NULL;
+
+    for (;;) {
+        if (used + 1 == capacity) {
+            char *grown = arenaGrow(arena, buffer, capacity, capacity * 2);
+            if (!grown) return NULL;
+            buffer = grown;
+            capacity *= 2;
+        }
+        size_t got = fread(buffer + used, 1, capacity - used - 1, stream);
+        if (got == 0) break;
+        used += got;
+    }
+
+    buffer[used] = '\0';
+    if (length) *length = used;
+    return buffer;
+}
+
+#endif
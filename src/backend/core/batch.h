@@ -0,0 +1,384 @@
+#ifndef SMARTFARM_BATCH_H
+#define SMARTFARM_BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "json.h"
+#include "latency.h"
+#include "profile.h"
+#include "thread.h"
+
+#define MAX_BATCH_WORKERS 256
+
+// Handles one request held in input[0..length) (NUL-terminated) and writes
+// exactly one response line to out. All scratch memory comes from arena,
+// which the caller resets between requests. Returns 0 for an error
+// response.
+typedef int (*RequestHandler)(const char *input, size_t length, FILE *out,
+                              Arena *arena, void *context);
+
+// One problem of a batch: its JSON text and, once a worker has run it, the
+// captured response line and solve time.
+typedef struct {
+    const char *input;
+    size_t length;
+    char *output;
+    size_t outputLength;
+    uint64_t micros;
+    int ok;
+    int done;
+} BatchJob;
+
+// Per-worker deque of job indices in ascending order. The owner takes from
+// the front, so the pool moves through the batch roughly in input order and
+// results can stream out early. An idle worker steals from the back of
+// another deque, i.e. the work that deque's owner would have reached last.
+typedef struct {
+    PoolMutex lock;
+    int *items;
+    int head;
+    int tail;
+} BatchDeque;
+
+typedef struct {
+    BatchJob *jobs;
+    int jobCount;
+    BatchDeque *deques;
+    int workerCount;
+    RequestHandler handler;
+    void *context;
+    PoolMutex doneLock;
+    PoolCond doneCond;
+    int waitingFor;
+} Batch;
+
+typedef struct {
+    Batch *batch;
+    int worker;
+    uint64_t steals;
+    LatencyCounters counters;
+} BatchWorker;
+
+// Collects one handler response in memory. Windows has no open_memstream,
+// so there the response goes through a temporary file.
+typedef struct {
+    FILE *stream;
+    char *buffer;
+    size_t length;
+} Capture;
+
+static inline int captureBegin(Capture *capture) {
+    capture->buffer = NULL;
+    capture->length = 0;
+#ifdef _WIN32
+    capture->stream = tmpfile();
+#else
+    capture->stream = open_memstream(&capture->buffer, &capture->length);
+#endif
+    return capture->stream != NULL;
+}
+
+// Returns the malloc'd response, or NULL if it could not be collected.
+static inline char *captureEnd(Capture *capture, size_t *length) {
+#ifdef _WIN32
+    long size;
+    fflush(capture->stream);
+    size = ftell(capture->stream);
+    if (size >= 0 && (capture->buffer = malloc((size_t)size + 1)) != NULL) {
+        rewind(capture->stream);
+        capture->length = fread(capture->buffer, 1, (size_t)size, capture->stream);
+    }
+    fclose(capture->stream);
+#else
+    if (fclose(capture->stream) != 0) {
+        free(capture->buffer);
+        capture->buffer = NULL;
+    }
+#endif
+    *length = capture->length;
+    return capture->buffer;
+}
+
+static inline int batchAddJob(BatchJob **jobs, int *count, size_t *capacity, Arena *arena,
+                              const char *input, size_t length) {
+    if ((size_t)*count == *capacity) {
+        BatchJob *grown = arenaGrow(arena, *jobs, *capacity * sizeof(BatchJob),
+                                    *capacity * 2 * sizeof(BatchJob));
+        if (!grown) return 0;
+        *jobs = grown;
+        *capacity *= 2;
+    }
+    memset(&(*jobs)[*count], 0, sizeof(BatchJob));
+    (*jobs)[*count].input = input;
+    (*jobs)[*count].length = length;
+    (*count)++;
+    return 1;
+}
+
+// Splits batch input into problems: either one JSON array of request
+// objects or newline-delimited JSON, one request per line. Each problem is
+// NUL-terminated in place once all of them have been found.
+static inline int batchSplit(char *text, size_t length, Arena *arena, BatchJob **jobs,
+                             int *count) {
+    size_t capacity = 64;
+    JsonCursor json;
+
+    *count = 0;
+    *jobs = arenaAlloc(arena, capacity * sizeof(BatchJob));
+    if (!*jobs) return 0;
+
+    jsonInit(&json, text, length);
+    if (jsonPeek(&json) == '[') {
+        int first = 1;
+        json.cur++;
+        while (jsonNextElement(&json, &first)) {
+            const char *start;
+            jsonSkipSpace(&json);
+            start = json.cur;
+            if (!jsonSkipValue(&json) ||
+                !batchAddJob(jobs, count, &capacity, arena, start, (size_t)(json.cur - start))) {
+                break;
+            }
+        }
+        if (json.error) {
+            fprintf(stderr, "Error: Malformed batch JSON near offset %ld\n", jsonOffset(&json));
+            return 0;
+        }
+    } else {
+        char *line = text;
+        char *end = text + length;
+        while (line < end) {
+            char *next = memchr(line, '\n', (size_t)(end - line));
+            char *stop = next ? next : end;
+            while (stop > line && (stop[-1] == '\r' || stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+            if (stop > line && !batchAddJob(jobs, count, &capacity, arena, line,
+                                            (size_t)(stop - line))) {
+                return 0;
+            }
+            line = next ? next + 1 : end;
+        }
+    }
+
+    for (int i = 0; i < *count; i++) {
+        ((char *)(*jobs)[i].input)[(*jobs)[i].length] = '\0';
+    }
+    return 1;
+}
+
+static inline int batchCompareMicros(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+// Nearest-rank percentile of sorted solve times: the smallest time at
+// least that share of the jobs took no longer than.
+static inline uint64_t batchRank(const uint64_t *sorted, int count, int percentile) {
+    return sorted[((size_t)count * percentile + 99) / 100 - 1];
+}
+
+// Exact p50 and p99 of the jobs' solve times; the histogram's bucket
+// edges can be off by up to 2x. Falls back to them without the memory to
+// sort.
+static inline void batchPercentiles(const Batch *batch, const LatencyCounters *totals,
+                                    Arena *arena, uint64_t *p50, uint64_t *p99) {
+    uint64_t *micros = arenaAlloc(arena, (size_t)batch->jobCount * sizeof(uint64_t));
+
+    if (!micros) {
+        *p50 = latencyPercentile(totals, 50);
+        *p99 = latencyPercentile(totals, 99);
+        return;
+    }
+    for (int i = 0; i < batch->jobCount; i++) micros[i] = batch->jobs[i].micros;
+    qsort(micros, (size_t)batch->jobCount, sizeof(uint64_t), batchCompareMicros);
+    *p50 = batchRank(micros, batch->jobCount, 50);
+    *p99 = batchRank(micros, batch->jobCount, 99);
+}
+
+static inline int batchTake(BatchWorker *self) {
+    Batch *batch = self->batch;
+    BatchDeque *own = &batch->deques[self->worker];
+    int index = -1;
+
+    poolLock(&own->lock);
+    if (own->head < own->tail) index = own->items[own->head++];
+    poolUnlock(&own->lock);
+    if (index >= 0) return index;
+
+    for (int k = 1; k < batch->workerCount && index < 0; k++) {
+        BatchDeque *victim = &batch->deques[(self->worker + k) % batch->workerCount];
+        poolLock(&victim->lock);
+        if (victim->head < victim->tail) index = victim->items[--victim->tail];
+        poolUnlock(&victim->lock);
+    }
+    if (index >= 0) self->steals++;
+    return index;
+}
+
+static ThreadResult THREAD_CALL batchWorkerMain(void *arg) {
+    BatchWorker *self = arg;
+    Batch *batch = self->batch;
+    Arena arena;
+    int index;
+
+    arenaInit(&arena);
+    while ((index = batchTake(self)) >= 0) {
+        BatchJob *job = &batch->jobs[index];
+        Capture capture;
+        PhaseProfile profile;
+        uint64_t start = monotonicMicros();
+
+        profileBegin(&profile, &arena);
+        if (captureBegin(&capture)) {
+            job->ok = batch->handler(job->input, job->length, capture.stream, &arena,
+                                     batch->context);
+            job->output = captureEnd(&capture, &job->outputLength);
+        }
+        profileEnd(job->ok);
+        job->micros = monotonicMicros() - start;
+        latencyRecord(&self->counters, job->micros, job->ok);
+        arenaReset(&arena);
+
+        poolLock(&batch->doneLock);
+        job->done = 1;
+        if (index == batch->waitingFor) poolSignal(&batch->doneCond);
+        poolUnlock(&batch->doneLock);
+    }
+    arenaRelease(&arena);
+    return 0;
+}
+
+// Runs every problem in the batch file (or stdin for "-") on a pool of
+// workers and streams one response line per problem to out, in input
+// order. A summary line with throughput and solve-time percentiles goes to
+// stderr. Returns 0 if the batch could not be run or any problem failed.
+static inline int runBatch(const char *path, int workers, RequestHandler handler, void *context,
+                           FILE *out) {
+    Arena arena;
+    Batch batch;
+    BatchWorker states[MAX_BATCH_WORKERS];
+    ThreadHandle threads[MAX_BATCH_WORKERS];
+    LatencyCounters totals;
+    uint64_t steals = 0, p50, p99;
+    size_t length = 0;
+    int started = 0;
+
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open batch file %s\n", path);
+        fprintf(out, "{\"error\":\"Cannot open batch file\"}\n");
+        return 0;
+    }
+
+    arenaInit(&arena);
+    memset(&batch, 0, sizeof(batch));
+    char *text = arenaReadStream(&arena, in, &length);
+    if (in != stdin) fclose(in);
+    if (!text || !batchSplit(text, length, &arena, &batch.jobs, &batch.jobCount)) {
+        fprintf(stderr, "Error: Failed to read batch input\n");
+        fprintf(out, "{\"error\":\"Failed to read batch input\"}\n");
+        arenaRelease(&arena);
+        return 0;
+    }
+    if (batch.jobCount == 0) {
+        fprintf(stderr, "Error: No input received\n");
+        fprintf(out, "{\"error\":\"No input received\"}\n");
+        arenaRelease(&arena);
+        return 0;
+    }
+
+    if (workers <= 0) workers = onlineCpuCount();
+    if (workers > MAX_BATCH_WORKERS) workers = MAX_BATCH_WORKERS;
+    if (workers > batch.jobCount) workers = batch.jobCount;
+    batch.workerCount = workers;
+    batch.handler = handler;
+    batch.context = context;
+    batch.waitingFor = -1;
+
+    // Deal jobs round-robin so every deque starts with a mix of early and
+    // late problems.
+    size_t perWorker = (size_t)(batch.jobCount + workers - 1) / workers;
+    batch.deques = arenaAlloc(&arena, (size_t)workers * sizeof(BatchDeque));
+    int *items = arenaAlloc(&arena, (size_t)workers * perWorker * sizeof(int));
+    if (!batch.deques || !items) {
+        fprintf(stderr, "Error: Out of memory for batch queues\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        arenaRelease(&arena);
+        return 0;
+    }
+    for (int w = 0; w < workers; w++) {
+        BatchDeque *deque = &batch.deques[w];
+        poolMutexInit(&deque->lock);
+        deque->items = items + (size_t)w * perWorker;
+        deque->head = 0;
+        deque->tail = 0;
+    }
+    for (int i = 0; i < batch.jobCount; i++) {
+        BatchDeque *deque = &batch.deques[i % workers];
+        deque->items[deque->tail++] = i;
+    }
+    poolMutexInit(&batch.doneLock);
+    poolCondInit(&batch.doneCond);
+
+    uint64_t startMicros = monotonicMicros();
+    for (int w = 0; w < workers; w++) {
+        memset(&states[w], 0, sizeof(states[w]));
+        states[w].batch = &batch;
+        states[w].worker = w;
+    }
+    for (int w = 0; w < workers; w++) {
+        if (!threadCreate(&threads[w], batchWorkerMain, &states[w])) break;
+        started++;
+    }
+    // Workers that failed to start leave their deques to be stolen; with no
+    // threads at all, run everything here before writing.
+    if (started == 0) batchWorkerMain(&states[0]);
+
+    for (int i = 0; i < batch.jobCount; i++) {
+        BatchJob *job = &batch.jobs[i];
+        poolLock(&batch.doneLock);
+        batch.waitingFor = i;
+        while (!job->done) poolWait(&batch.doneCond, &batch.doneLock);
+        poolUnlock(&batch.doneLock);
+
+        if (job->output) {
+            fwrite(job->output, 1, job->outputLength, out);
+        } else {
+            fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        }
+        fflush(out);
+        free(job->output);
+        job->output = NULL;
+    }
+    uint64_t wallMicros = monotonicMicros() - startMicros;
+
+    for (int w = 0; w < started; w++) threadJoin(threads[w]);
+    memset(&totals, 0, sizeof(totals));
+    for (int w = 0; w < workers; w++) {
+        latencyMerge(&totals, &states[w].counters);
+        steals += states[w].steals;
+        poolMutexDestroy(&batch.deques[w].lock);
+    }
+    poolCondDestroy(&batch.doneCond);
+    poolMutexDestroy(&batch.doneLock);
+    batchPercentiles(&batch, &totals, &arena, &p50, &p99);
+
+    fprintf(stderr,
+            "batch_stats problems=%d errors=%llu workers=%d steals=%llu wall_ms=%.1f "
+            "throughput_per_s=%.1f mean_us=%llu p50_us=%llu p99_us=%llu max_us=%llu\n",
+            batch.jobCount, (unsigned long long)totals.errors, started ? started : 1,
+            (unsigned long long)steals, wallMicros / 1000.0,
+            wallMicros ? batch.jobCount * 1e6 / wallMicros : 0.0,
+            (unsigned long long)(totals.totalMicros / totals.requests),
+            (unsigned long long)p50, (unsigned long long)p99,
+            (unsigned long long)totals.maxMicros);
+
+    arenaRelease(&arena);
+    return totals.errors == 0;
+}
+
+#endif
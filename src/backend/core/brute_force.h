@@ -0,0 +1,514 @@
+#ifndef SMARTFARM_BRUTE_FORCE_H
+#define SMARTFARM_BRUTE_FORCE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "farm.h"
+#include "profile.h"
+#include "score.h"
+#include "thread.h"
+
+// Exact scheduler: branch-and-bound over which fields get water at all.
+// Maximizes the same objective as the DP (summed (100 - moisture) *
+// allocated / waterNeeded, each field getting nothing or between a tenth of
+// its need and its full need) and reports the same fixed-point score.
+//
+// Once the set of watered fields is fixed, the best allocation is simple:
+// every field gets its minimum and the water left over tops fields up in
+// rate order. So the search only branches on/off per field, in rate order,
+// and bounds each node with the fractional relaxation of the fields not yet
+// decided. The tree is split into a fixed set of subtrees that worker
+// threads claim in order, sharing the best score found so far.
+
+#define BRUTE_FORCE_MAX_THREADS 256
+// Subtrees are the on/off patterns of the first SPLIT_DEPTH fields. The
+// split does not depend on the thread count, so neither does the result.
+#define BRUTE_FORCE_SPLIT_DEPTH 10
+#define BRUTE_FORCE_DEFAULT_NODE_LIMIT 100000000LL
+// Workers add to the shared node count, and check the limit, this often.
+#define BRUTE_FORCE_NODE_BATCH 4096
+
+typedef struct {
+    int threads;          // 0 for one per online CPU
+    int64_t nodeLimit;    // 0 for no limit
+} BruteForceOptions;
+
+typedef struct {
+    int threadsUsed;
+    int tasks;
+    int64_t nodes;
+    Score seedScore;      // priority-order greedy fill the search starts from
+    Score bestScore;
+    Score rootBound;      // fractional relaxation of the whole problem
+    Score upperBound;     // proven bound on the optimum; bestScore when exact
+    int exact;            // 0 if the node limit stopped the search short of a proof
+} BruteForceStats;
+
+typedef struct {
+    int field;
+    int rank;             // position in priority order, for ties
+    int minWater;
+    int extra;            // waterNeeded - minWater
+    Score rate;
+} BnbItem;
+
+// Search state after deciding items [0, depth). Fields switched on hold
+// their minimum; their extras are all of higher rate than any undecided
+// item. The states along the current path are kept, so path[j] is the
+// state before item j was decided.
+typedef struct {
+    int64_t committed;    // minimum water of the fields switched on
+    int64_t extras;       // water those fields could take above the minimum
+    Score minValue;
+    Score extrasValue;
+} BnbState;
+
+typedef struct {
+    int depth;
+    uint32_t decisions;   // bit k set: item k switched on
+} BnbTask;
+
+typedef struct {
+    const BnbItem *items;
+    int itemCount;
+    int64_t water;
+    int64_t *prefixNeed;  // prefixNeed[k]: summed waterNeeded of items [0, k)
+    Score *prefixValue;   // prefixValue[k]: summed rate * waterNeeded of items [0, k)
+    BnbTask *tasks;
+    int taskCount;
+    unsigned char *taskDone;
+    int64_t nodeLimit;
+    int64_t nodeBatch;
+    volatile int64_t nextTask;
+    volatile int64_t sharedBest;
+    volatile int64_t sharedNodes;
+    volatile int64_t stopped;
+} BnbSearch;
+
+typedef struct {
+    BnbSearch *search;
+    BnbState *states;
+    unsigned char *phase;
+    unsigned char *on;
+    unsigned char *bestOn;
+    Score best;
+    int bestTask;
+    int64_t nodes;        // not yet added to the shared count
+    int stopped;
+} BnbWorker;
+
+static inline void bruteForceOptionsInit(BruteForceOptions *options) {
+    options->threads = 0;
+    options->nodeLimit = BRUTE_FORCE_DEFAULT_NODE_LIMIT;
+}
+
+static int compareBnbItems(const void *a, const void *b) {
+    const BnbItem *itemA = a;
+    const BnbItem *itemB = b;
+    if (itemA->rate != itemB->rate) return itemA->rate > itemB->rate ? -1 : 1;
+    return itemA->rank - itemB->rank;
+}
+
+static inline void bnbSwitchOn(BnbState *state, const BnbItem *item) {
+    state->committed += item->minWater;
+    state->extras += item->extra;
+    state->minValue += item->rate * item->minWater;
+    state->extrasValue += item->rate * item->extra;
+}
+
+// Identical fields are interchangeable, so only the patterns that switch
+// the earlier of two identical items on first are searched.
+static inline int bnbCanSwitchOn(const BnbSearch *search, const unsigned char *on,
+                                 const BnbState *state, int k) {
+    const BnbItem *item = &search->items[k];
+    if (item->minWater > search->water - state->committed) return 0;
+    if (k > 0 && !on[k - 1] && search->items[k - 1].rate == item->rate &&
+        search->items[k - 1].minWater == item->minWater &&
+        search->items[k - 1].extra == item->extra) {
+        return 0;
+    }
+    return 1;
+}
+
+// Fractional fill of items [k, itemCount) with the given water.
+static inline Score bnbTailBound(const BnbSearch *search, int k, int64_t water) {
+    int64_t base = search->prefixNeed[k];
+    int low = k;
+    int high = search->itemCount;
+
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (search->prefixNeed[mid] - base <= water) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    Score value = search->prefixValue[low] - search->prefixValue[k];
+    if (low < search->itemCount) {
+        value += search->items[low].rate * (water - (search->prefixNeed[low] - base));
+    }
+    return value;
+}
+
+// Value of the extras of the on items among [0, k) with room water to
+// spread over them in rate order. The cumulative extras along the path are
+// nondecreasing, so the item where the room runs out is a binary search.
+static inline Score bnbFillExtras(const BnbSearch *search, const BnbState *path, int k,
+                                  int64_t room) {
+    int low = 0;
+    int high = k - 1;
+
+    if (path[k].extras <= room) return path[k].extrasValue;
+    // Smallest j with path[j + 1].extras > room; item j is on
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (path[mid + 1].extras > room) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return path[low].extrasValue + search->items[low].rate * (room - path[low].extras);
+}
+
+// Upper bound for the node path[k], exact when the node cannot be improved
+// by switching on any further item. *complete says which of those cases
+// applies: 1 = the on items alone (their extras fill the room), 2 = every
+// remaining item switched on in full.
+static inline Score bnbNodeBound(const BnbSearch *search, const BnbState *path, int k,
+                                 int *complete) {
+    const BnbState *state = &path[k];
+    int64_t room = search->water - state->committed;
+    *complete = 0;
+    if (state->extras >= room) {
+        // Any further item would only displace higher-rate extras
+        *complete = 1;
+        return state->minValue + bnbFillExtras(search, path, k, room);
+    }
+    int64_t left = room - state->extras;
+    if (search->prefixNeed[search->itemCount] - search->prefixNeed[k] <= left) {
+        *complete = 2;
+    }
+    return state->minValue + state->extrasValue + bnbTailBound(search, k, left);
+}
+
+// Keeps a complete solution if it beats this worker's best. Items [0, k)
+// follow on; the rest are on when tailOn is set.
+static inline void bnbRecord(BnbWorker *worker, int task, int k, int tailOn, Score value) {
+    BnbSearch *search = worker->search;
+    if (value <= worker->best) return;
+
+    worker->best = value;
+    worker->bestTask = task;
+    memcpy(worker->bestOn, worker->on, (size_t)k);
+    memset(worker->bestOn + k, tailOn, (size_t)(search->itemCount - k));
+    atomicMax64(&search->sharedBest, value);
+}
+
+static inline void bnbCountNodes(BnbWorker *worker) {
+    BnbSearch *search = worker->search;
+    int64_t total = atomicAdd64(&search->sharedNodes, worker->nodes);
+    worker->nodes = 0;
+    if (search->nodeLimit > 0 && total >= search->nodeLimit) {
+        atomicMax64(&search->stopped, 1);
+    }
+    worker->stopped = atomicLoad64(&search->stopped) != 0;
+}
+
+// Returns 1 if the node at depth k should be branched on.
+static inline int bnbVisit(BnbWorker *worker, int task, int k) {
+    BnbSearch *search = worker->search;
+    int complete;
+
+    if (worker->stopped) return 0;
+    if (++worker->nodes == search->nodeBatch) bnbCountNodes(worker);
+
+    Score bound = bnbNodeBound(search, worker->states, k, &complete);
+    if (complete) {
+        bnbRecord(worker, task, k, complete == 2, bound);
+        return 0;
+    }
+    return bound > worker->best && bound >= atomicLoad64(&search->sharedBest);
+}
+
+// Depth-first search of one subtree, switch-on branch first.
+static inline void bnbRunTask(BnbWorker *worker, int task) {
+    BnbSearch *search = worker->search;
+    const BnbTask *prefix = &search->tasks[task];
+    int start = prefix->depth;
+    int k = start;
+
+    memset(&worker->states[0], 0, sizeof(BnbState));
+    for (int i = 0; i < start; i++) {
+        worker->on[i] = (prefix->decisions >> i) & 1;
+        worker->states[i + 1] = worker->states[i];
+        if (worker->on[i]) bnbSwitchOn(&worker->states[i + 1], &search->items[i]);
+    }
+    worker->phase[start] = 0;
+
+    while (k >= start) {
+        if (worker->phase[k] == 0) {
+            if (!bnbVisit(worker, task, k)) {
+                k--;
+                continue;
+            }
+            worker->phase[k] = 1;
+            if (bnbCanSwitchOn(search, worker->on, &worker->states[k], k)) {
+                worker->on[k] = 1;
+                worker->states[k + 1] = worker->states[k];
+                bnbSwitchOn(&worker->states[k + 1], &search->items[k]);
+                worker->phase[++k] = 0;
+                continue;
+            }
+        }
+        if (worker->phase[k] == 1) {
+            worker->phase[k] = 2;
+            worker->on[k] = 0;
+            worker->states[k + 1] = worker->states[k];
+            worker->phase[++k] = 0;
+            continue;
+        }
+        k--;
+    }
+}
+
+static ThreadResult THREAD_CALL bnbWorkerMain(void *arg) {
+    BnbWorker *worker = arg;
+    BnbSearch *search = worker->search;
+    int64_t task;
+
+    while (!worker->stopped &&
+           (task = atomicAdd64(&search->nextTask, 1) - 1) < search->taskCount) {
+        bnbRunTask(worker, (int)task);
+        if (!worker->stopped) search->taskDone[task] = 1;
+    }
+    atomicAdd64(&search->sharedNodes, worker->nodes);
+    return 0;
+}
+
+// Enumerates the subtree roots: feasible on/off patterns of the first
+// items, cut short where a pattern is already complete.
+static inline int bnbSplit(BnbSearch *search, int depth, BnbState *path, unsigned char *on,
+                           uint32_t decisions, int splitDepth) {
+    int complete;
+    bnbNodeBound(search, path, depth, &complete);
+    if (depth == splitDepth || complete) {
+        search->tasks[search->taskCount].depth = depth;
+        search->tasks[search->taskCount].decisions = decisions;
+        search->taskCount++;
+        return 1;
+    }
+    int count = 0;
+    if (bnbCanSwitchOn(search, on, &path[depth], depth)) {
+        path[depth + 1] = path[depth];
+        bnbSwitchOn(&path[depth + 1], &search->items[depth]);
+        on[depth] = 1;
+        count += bnbSplit(search, depth + 1, path, on, decisions | (1u << depth), splitDepth);
+    }
+    path[depth + 1] = path[depth];
+    on[depth] = 0;
+    return count + bnbSplit(search, depth + 1, path, on, decisions, splitDepth);
+}
+
+// Gives every on item its minimum, then tops them up in rate order.
+static inline Score bnbApply(const BnbSearch *search, const unsigned char *on,
+                             IrrigationData *data) {
+    int64_t room = search->water;
+    Score value = 0;
+
+    for (int i = 0; i < search->itemCount; i++) {
+        if (on[i]) room -= search->items[i].minWater;
+    }
+    for (int i = 0; i < search->itemCount; i++) {
+        const BnbItem *item = &search->items[i];
+        if (!on[i]) continue;
+        int take = item->extra < room ? item->extra : (int)room;
+        room -= take;
+        value += item->rate * (item->minWater + take);
+        if (data) {
+            data->fields[item->field].allocated = item->minWater + take;
+            data->fields[item->field].scheduled = 1;
+            data->totalWaterUsed += item->minWater + take;
+        }
+    }
+    return value;
+}
+
+// The old brute-force pass: fill in priority order, giving the first field
+// that does not fit whatever is left if that covers its minimum.
+static inline void bnbSeed(const BnbSearch *search, const IrrigationData *data,
+                           const int *order, const int *itemOf, unsigned char *on) {
+    int64_t room = search->water;
+
+    memset(on, 0, (size_t)search->itemCount);
+    for (int k = 0; k < data->fieldCount && room > 0; k++) {
+        int i = order[k];
+        int item = itemOf[i];
+        if (item < 0) continue;
+        if (data->fields[i].waterNeeded > room && search->items[item].minWater > room) break;
+        on[item] = 1;
+        room -= data->fields[i].waterNeeded;
+    }
+}
+
+// Searches with the fields in the given priority order (from
+// prioritizeFields), which seeds the search and breaks ties; the fields
+// stay where they are. Returns 0 if the search state does not fit in memory.
+static inline int bruteForceScheduleOrdered(IrrigationData *data, const int *order,
+                                            const BruteForceOptions *options, Arena *arena,
+                                            BruteForceStats *stats) {
+    BnbSearch search;
+    BnbWorker workers[BRUTE_FORCE_MAX_THREADS];
+    ThreadHandle threads[BRUTE_FORCE_MAX_THREADS];
+    BnbItem *items;
+    int *itemOf;
+    BnbState path[BRUTE_FORCE_SPLIT_DEPTH + 1];
+    unsigned char *on;
+    unsigned char *seedOn;
+    const unsigned char *bestOn;
+    int itemCount = 0;
+    int workerCount;
+    int started = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&search, 0, sizeof(search));
+    data->totalWaterUsed = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+
+    // Fields with nothing to gain are never worth water
+    items = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(BnbItem));
+    itemOf = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    if (!items || !itemOf) return 0;
+    for (int k = 0; k < data->fieldCount; k++) {
+        int i = order[k];
+        const Field *field = &data->fields[i];
+        itemOf[i] = -1;
+        if (field->waterNeeded <= 0 || field->moisture >= 100) continue;
+        items[itemCount].field = i;
+        items[itemCount].rank = k;
+        items[itemCount].minWater = (field->waterNeeded + 9) / 10;
+        items[itemCount].extra = field->waterNeeded - items[itemCount].minWater;
+        items[itemCount].rate = fieldRate(field);
+        itemCount++;
+    }
+    qsort(items, itemCount, sizeof(BnbItem), compareBnbItems);
+    for (int i = 0; i < itemCount; i++) itemOf[items[i].field] = i;
+
+    search.items = items;
+    search.itemCount = itemCount;
+    search.water = data->totalWater > 0 ? data->totalWater : 0;
+    search.nodeLimit = options->nodeLimit;
+    search.nodeBatch = search.nodeLimit > 0 && search.nodeLimit < BRUTE_FORCE_NODE_BATCH
+                           ? search.nodeLimit
+                           : BRUTE_FORCE_NODE_BATCH;
+    search.prefixNeed = arenaAlloc(arena, ((size_t)itemCount + 1) * sizeof(int64_t));
+    search.prefixValue = arenaAlloc(arena, ((size_t)itemCount + 1) * sizeof(Score));
+    on = arenaAlloc(arena, (size_t)itemCount + 1);
+    seedOn = arenaAlloc(arena, (size_t)itemCount + 1);
+    if (!search.prefixNeed || !search.prefixValue || !on || !seedOn) return 0;
+    search.prefixNeed[0] = 0;
+    search.prefixValue[0] = 0;
+    for (int i = 0; i < itemCount; i++) {
+        int need = items[i].minWater + items[i].extra;
+        search.prefixNeed[i + 1] = search.prefixNeed[i] + need;
+        search.prefixValue[i + 1] = search.prefixValue[i] + items[i].rate * need;
+    }
+
+    uint64_t start = phaseBegin();
+    bnbSeed(&search, data, order, itemOf, seedOn);
+    stats->seedScore = bnbApply(&search, seedOn, NULL);
+    stats->rootBound = bnbTailBound(&search, 0, search.water);
+    search.sharedBest = stats->seedScore;
+
+    int splitDepth = itemCount < BRUTE_FORCE_SPLIT_DEPTH ? itemCount : BRUTE_FORCE_SPLIT_DEPTH;
+    search.tasks = arenaAlloc(arena, ((size_t)1 << splitDepth) * sizeof(BnbTask));
+    search.taskDone = arenaAlloc(arena, (size_t)1 << splitDepth);
+    if (!search.tasks || !search.taskDone) return 0;
+    memset(search.taskDone, 0, (size_t)1 << splitDepth);
+    memset(&path[0], 0, sizeof(BnbState));
+    bnbSplit(&search, 0, path, on, 0, splitDepth);
+
+    workerCount = options->threads > 0 ? options->threads : onlineCpuCount();
+    if (workerCount > BRUTE_FORCE_MAX_THREADS) workerCount = BRUTE_FORCE_MAX_THREADS;
+    if (workerCount > search.taskCount) workerCount = search.taskCount;
+    for (int w = 0; w < workerCount; w++) {
+        BnbWorker *worker = &workers[w];
+        memset(worker, 0, sizeof(*worker));
+        worker->search = &search;
+        worker->best = -1;
+        worker->bestTask = -1;
+        worker->states = arenaAlloc(arena, ((size_t)itemCount + 2) * sizeof(BnbState));
+        worker->phase = arenaAlloc(arena, (size_t)itemCount + 2);
+        worker->on = arenaAlloc(arena, (size_t)itemCount + 1);
+        worker->bestOn = arenaAlloc(arena, (size_t)itemCount + 1);
+        if (!worker->states || !worker->phase || !worker->on || !worker->bestOn) return 0;
+    }
+
+    // The calling thread works as worker 0
+    for (int w = 1; w < workerCount; w++) {
+        if (!threadCreate(&threads[w], bnbWorkerMain, &workers[w])) break;
+        started++;
+    }
+    bnbWorkerMain(&workers[0]);
+    for (int w = 1; w <= started; w++) threadJoin(threads[w]);
+
+    // Highest score wins; among equal scores the earliest subtree, then the
+    // seed, so the schedule is the same for every thread count.
+    stats->bestScore = stats->seedScore;
+    bestOn = seedOn;
+    int bestTask = search.taskCount;
+    for (int w = 0; w <= started; w++) {
+        const BnbWorker *worker = &workers[w];
+        if (worker->bestTask < 0) continue;
+        if (worker->best > stats->bestScore ||
+            (worker->best == stats->bestScore && worker->bestTask < bestTask)) {
+            stats->bestScore = worker->best;
+            bestTask = worker->bestTask;
+            bestOn = worker->bestOn;
+        }
+    }
+
+    stats->threadsUsed = started + 1;
+    stats->tasks = search.taskCount;
+    stats->nodes = search.sharedNodes;
+    stats->upperBound = stats->bestScore;
+    for (int t = 0; t < search.taskCount && search.stopped; t++) {
+        // Anything better lies in a subtree the search did not finish
+        const BnbTask *task = &search.tasks[t];
+        int complete;
+        if (search.taskDone[t]) continue;
+        for (int i = 0; i < task->depth; i++) {
+            path[i + 1] = path[i];
+            if ((task->decisions >> i) & 1) bnbSwitchOn(&path[i + 1], &items[i]);
+        }
+        Score bound = bnbNodeBound(&search, path, task->depth, &complete);
+        if (bound > stats->upperBound) stats->upperBound = bound;
+    }
+    stats->exact = stats->upperBound == stats->bestScore;
+    phaseEnd(PHASE_FILL, start);
+    profileCount((uint64_t)stats->nodes, 0);
+
+    start = phaseBegin();
+    bnbApply(&search, bestOn, data);
+    data->remainingWater = data->totalWater - data->totalWaterUsed;
+    phaseEnd(PHASE_BACKTRACK, start);
+    return 1;
+}
+
+// Prioritizes and searches; fields stay in input order. Returns 0 if
+// memory runs out.
+static inline int bruteForceSchedule(IrrigationData *data, const BruteForceOptions *options,
+                                     Arena *arena, BruteForceStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return bruteForceScheduleOrdered(data, order, options, arena, stats);
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef SMARTFARM_CACHE_H
+#define SMARTFARM_CACHE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "farm.h"
+#include "thread.h"
+
+// Schedule cache for a long-running process, shared by every thread that
+// schedules. The key is canonical: the scheduler, the budgets and the
+// (moisture, waterNeeded) of every field in priority order. Names and input
+// order are left out, since no scheduler looks at them; a resubmitted or
+// reordered field set hits the same entry, and because the schedulers only
+// see the fields in priority order (ties in input order), the cached
+// allocations put back by priority position are the ones a fresh run would
+// give.
+//
+// Entries are kept in LRU order and evicted once their total size passes
+// the limit. One mutex guards the table; a lookup or store holds it only to
+// copy one schedule.
+
+#define SCHEDULE_CACHE_DEFAULT_BYTES (64u * 1024 * 1024)
+#define SCHEDULE_CACHE_MIN_BUCKETS 64
+
+typedef struct {
+    int variant;               // the scheduler and any option that changes its answer
+    int totalWater;
+    int totalElectricity;
+    int waterDeliveryRate;
+    int fieldCount;
+} ScheduleCacheKey;
+
+typedef struct {
+    int totalWaterUsed;
+    int totalTimeUsed;
+    int remainingWater;
+    int remainingElectricity;
+    int useTimeConstraints;
+} ScheduleCacheTotals;
+
+// One cached schedule; its per-field data follows in the same allocation:
+// 2 ints of key per field, then allocated, timeNeeded and scheduled.
+typedef struct ScheduleCacheEntry {
+    struct ScheduleCacheEntry *next;    // hash chain
+    struct ScheduleCacheEntry *newer;   // LRU list
+    struct ScheduleCacheEntry *older;
+    uint64_t hash;
+    size_t bytes;
+    ScheduleCacheKey key;
+    ScheduleCacheTotals totals;
+} ScheduleCacheEntry;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+    size_t bytes;
+    size_t limitBytes;
+} ScheduleCacheStats;
+
+typedef struct {
+    PoolMutex lock;
+    ScheduleCacheEntry **buckets;
+    size_t bucketMask;
+    ScheduleCacheEntry *newest;
+    ScheduleCacheEntry *oldest;
+    ScheduleCacheStats stats;
+} ScheduleCache;
+
+static inline void scheduleCacheInit(ScheduleCache *cache, size_t limitBytes) {
+    memset(cache, 0, sizeof(*cache));
+    poolMutexInit(&cache->lock);
+    cache->stats.limitBytes = limitBytes;
+}
+
+static inline int *scheduleCacheFieldData(ScheduleCacheEntry *entry) {
+    return (int *)(entry + 1);
+}
+
+static inline uint64_t scheduleCacheMix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash * 0xff51afd7ed558ccdull;
+}
+
+static inline ScheduleCacheKey scheduleCacheKeyOf(int variant, const IrrigationData *data) {
+    ScheduleCacheKey key;
+    memset(&key, 0, sizeof(key));
+    key.variant = variant;
+    key.totalWater = data->totalWater;
+    key.totalElectricity = data->totalElectricity;
+    key.waterDeliveryRate = data->waterDeliveryRate;
+    key.fieldCount = data->fieldCount;
+    return key;
+}
+
+// Hash of the canonical key; order is the priority order from
+// prioritizeFields.
+static inline uint64_t scheduleCacheHash(int variant, const IrrigationData *data,
+                                         const int *order) {
+    ScheduleCacheKey key = scheduleCacheKeyOf(variant, data);
+    uint64_t hash = scheduleCacheMix(0, (uint64_t)(uint32_t)key.variant);
+
+    hash = scheduleCacheMix(hash, (uint64_t)(uint32_t)key.totalWater);
+    hash = scheduleCacheMix(hash, (uint64_t)(uint32_t)key.totalElectricity << 32 |
+                                      (uint32_t)key.waterDeliveryRate);
+    hash = scheduleCacheMix(hash, (uint64_t)(uint32_t)key.fieldCount);
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order[k]];
+        hash = scheduleCacheMix(hash, (uint64_t)(uint32_t)field->moisture << 32 |
+                                          (uint32_t)field->waterNeeded);
+    }
+    return hash;
+}
+
+static inline int scheduleCacheMatches(ScheduleCacheEntry *entry, uint64_t hash,
+                                       const ScheduleCacheKey *key, const IrrigationData *data,
+                                       const int *order) {
+    const int *tuples = scheduleCacheFieldData(entry);
+
+    if (entry->hash != hash || memcmp(&entry->key, key, sizeof(*key)) != 0) return 0;
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order[k]];
+        if (tuples[2 * k] != field->moisture || tuples[2 * k + 1] != field->waterNeeded) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline void scheduleCacheUnlink(ScheduleCache *cache, ScheduleCacheEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static inline void scheduleCachePushNewest(ScheduleCache *cache, ScheduleCacheEntry *entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest) cache->newest->newer = entry;
+    cache->newest = entry;
+    if (!cache->oldest) cache->oldest = entry;
+}
+
+static inline void scheduleCacheRemove(ScheduleCache *cache, ScheduleCacheEntry *entry) {
+    ScheduleCacheEntry **link = &cache->buckets[entry->hash & cache->bucketMask];
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+    scheduleCacheUnlink(cache, entry);
+    cache->stats.entries--;
+    cache->stats.bytes -= entry->bytes;
+    free(entry);
+}
+
+// Drops the least recently used entries until the cache is within its limit.
+static inline void scheduleCacheTrim(ScheduleCache *cache) {
+    while (cache->oldest && cache->stats.bytes > cache->stats.limitBytes) {
+        scheduleCacheRemove(cache, cache->oldest);
+        cache->stats.evictions++;
+    }
+}
+
+// Doubles the table once it holds more entries than buckets. Keeps the old
+// table if the new one does not fit in memory.
+static inline void scheduleCacheGrow(ScheduleCache *cache) {
+    size_t count = cache->buckets ? cache->bucketMask + 1 : 0;
+    if (cache->stats.entries < count) return;
+
+    size_t grown = count ? count * 2 : SCHEDULE_CACHE_MIN_BUCKETS;
+    ScheduleCacheEntry **buckets = calloc(grown, sizeof(ScheduleCacheEntry *));
+    if (!buckets) return;
+    for (size_t b = 0; b < count; b++) {
+        ScheduleCacheEntry *entry = cache->buckets[b];
+        while (entry) {
+            ScheduleCacheEntry *next = entry->next;
+            entry->next = buckets[entry->hash & (grown - 1)];
+            buckets[entry->hash & (grown - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucketMask = grown - 1;
+}
+
+// Writes the cached schedule for this request into the fields and returns
+// 1, or counts a miss and returns 0. Always 0, and not counted, while the
+// cache is off.
+static inline int scheduleCacheLookup(ScheduleCache *cache, int variant, IrrigationData *data,
+                                      const int *order, uint64_t hash) {
+    ScheduleCacheKey key = scheduleCacheKeyOf(variant, data);
+    ScheduleCacheEntry *entry = NULL;
+
+    poolLock(&cache->lock);
+    if (cache->stats.limitBytes == 0) {
+        poolUnlock(&cache->lock);
+        return 0;
+    }
+    if (cache->buckets) {
+        entry = cache->buckets[hash & cache->bucketMask];
+        while (entry && !scheduleCacheMatches(entry, hash, &key, data, order)) entry = entry->next;
+    }
+    if (!entry) {
+        cache->stats.misses++;
+        poolUnlock(&cache->lock);
+        return 0;
+    }
+
+    const int *slots = scheduleCacheFieldData(entry) + 2 * (size_t)data->fieldCount;
+    for (int k = 0; k < data->fieldCount; k++) {
+        Field *field = &data->fields[order[k]];
+        field->allocated = slots[3 * k];
+        field->timeNeeded = slots[3 * k + 1];
+        field->scheduled = slots[3 * k + 2];
+    }
+    data->totalWaterUsed = entry->totals.totalWaterUsed;
+    data->totalTimeUsed = entry->totals.totalTimeUsed;
+    data->remainingWater = entry->totals.remainingWater;
+    data->remainingElectricity = entry->totals.remainingElectricity;
+    data->useTimeConstraints = entry->totals.useTimeConstraints;
+    scheduleCacheUnlink(cache, entry);
+    scheduleCachePushNewest(cache, entry);
+    cache->stats.hits++;
+    poolUnlock(&cache->lock);
+    return 1;
+}
+
+// Keeps the schedule now in the fields, under the key it was looked up
+// with. A schedule bigger than the whole limit, or one that does not fit in
+// memory, is not kept.
+static inline void scheduleCacheStore(ScheduleCache *cache, int variant,
+                                      const IrrigationData *data, const int *order,
+                                      uint64_t hash) {
+    size_t bytes = sizeof(ScheduleCacheEntry) + (size_t)data->fieldCount * 5 * sizeof(int);
+    ScheduleCacheKey key = scheduleCacheKeyOf(variant, data);
+    ScheduleCacheEntry *entry;
+
+    poolLock(&cache->lock);
+    int fits = bytes <= cache->stats.limitBytes;
+    poolUnlock(&cache->lock);
+    if (!fits) return;
+
+    entry = malloc(bytes);
+    if (!entry) return;
+    memset(entry, 0, sizeof(*entry));
+    entry->hash = hash;
+    entry->bytes = bytes;
+    entry->key = key;
+    entry->totals.totalWaterUsed = data->totalWaterUsed;
+    entry->totals.totalTimeUsed = data->totalTimeUsed;
+    entry->totals.remainingWater = data->remainingWater;
+    entry->totals.remainingElectricity = data->remainingElectricity;
+    entry->totals.useTimeConstraints = data->useTimeConstraints;
+    int *tuples = scheduleCacheFieldData(entry);
+    int *slots = tuples + 2 * (size_t)data->fieldCount;
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order[k]];
+        tuples[2 * k] = field->moisture;
+        tuples[2 * k + 1] = field->waterNeeded;
+        slots[3 * k] = field->allocated;
+        slots[3 * k + 1] = field->timeNeeded;
+        slots[3 * k + 2] = field->scheduled;
+    }
+
+    poolLock(&cache->lock);
+    // Another thread may have stored the same request meanwhile
+    ScheduleCacheEntry *existing = NULL;
+    if (cache->buckets) {
+        existing = cache->buckets[hash & cache->bucketMask];
+        while (existing && !scheduleCacheMatches(existing, hash, &key, data, order)) {
+            existing = existing->next;
+        }
+    }
+    if (existing || bytes > cache->stats.limitBytes) {
+        poolUnlock(&cache->lock);
+        free(entry);
+        return;
+    }
+    scheduleCacheGrow(cache);
+    if (!cache->buckets) {
+        poolUnlock(&cache->lock);
+        free(entry);
+        return;
+    }
+    entry->next = cache->buckets[hash & cache->bucketMask];
+    cache->buckets[hash & cache->bucketMask] = entry;
+    scheduleCachePushNewest(cache, entry);
+    cache->stats.entries++;
+    cache->stats.bytes += bytes;
+    scheduleCacheTrim(cache);
+    poolUnlock(&cache->lock);
+}
+
+// Sets the size limit, evicting at once if the cache is over it; 0 turns
+// the cache off and empties it.
+static inline void scheduleCacheSetLimit(ScheduleCache *cache, size_t limitBytes) {
+    poolLock(&cache->lock);
+    cache->stats.limitBytes = limitBytes;
+    scheduleCacheTrim(cache);
+    poolUnlock(&cache->lock);
+}
+
+static inline ScheduleCacheStats scheduleCacheStats(ScheduleCache *cache) {
+    ScheduleCacheStats stats;
+    poolLock(&cache->lock);
+    stats = cache->stats;
+    poolUnlock(&cache->lock);
+    return stats;
+}
+
+static inline void scheduleCacheRelease(ScheduleCache *cache) {
+    while (cache->oldest) scheduleCacheRemove(cache, cache->oldest);
+    free(cache->buckets);
+    poolMutexDestroy(&cache->lock);
+    memset(cache, 0, sizeof(*cache));
+}
+
+#endif
@@ -0,0 +1,830 @@
+#ifndef SMARTFARM_DP_H
+#define SMARTFARM_DP_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "farm.h"
+#include "profile.h"
+#include "score.h"
+#include "thread.h"
+
+// DP scheduling engine: maximizes the summed (100 - moisture) * allocated /
+// waterNeeded over the water budget, giving each field either nothing or
+// between a tenth of its need and its full need.
+
+#define SCORE_UNREACHABLE (INT64_MIN / 4)
+#define MAX_THREADS 256
+// Worker chunks of the water axis are multiples of this many cells, so each
+// chunk's score, code and choice-log words start on their own cache line.
+#define CHUNK_CELLS 512
+#define CACHE_LINE 64
+
+typedef enum {
+    DP_MEMORY_LEAN,
+    DP_MEMORY_FULL
+} DPMemoryMode;
+
+typedef enum {
+    DP_KERNEL_DEQUE,
+    DP_KERNEL_SIMD,
+    DP_KERNEL_REFERENCE
+} DPKernel;
+
+typedef enum {
+    SIMD_AUTO,
+    SIMD_SCALAR,
+    SIMD_SSE42,
+    SIMD_AVX2
+} SimdLevel;
+
+typedef struct {
+    DPMemoryMode memoryMode;
+    DPKernel kernel;
+    SimdLevel simd;
+    int threads;
+    int reportStats;
+} DPOptions;
+
+typedef struct {
+    size_t tableBytes;
+    size_t peakTableBytes;
+    size_t fullTableBytes;
+    SimdLevel simdLevel;
+    int threadsUsed;
+    Score bestScore;
+} DPStats;
+
+// Per-field decisions packed at the minimum width: code 0 means "skip",
+// code k means "allocate minWater + k - 1". Each field's row starts on a
+// cache-line boundary.
+typedef struct {
+    uint64_t *words;
+    size_t *rowOffset;
+    unsigned char *rowBits;
+    size_t totalWords;
+} ChoiceLog;
+
+// What a lean run leaves in its arena: the choice log and the last row,
+// last[w] being the best score that uses exactly w units (negative when no
+// schedule does). Any budget can be backtracked from them.
+typedef struct {
+    ChoiceLog log;
+    const Score *last;
+} DPTables;
+
+static void trackAlloc(DPStats *stats, size_t bytes) {
+    stats->tableBytes += bytes;
+    if (stats->tableBytes > stats->peakTableBytes) {
+        stats->peakTableBytes = stats->tableBytes;
+    }
+}
+
+static void trackFree(DPStats *stats, size_t bytes) {
+    stats->tableBytes -= bytes;
+}
+
+static unsigned int choiceBitsFor(const Field *field) {
+    int minWater = (field->waterNeeded + 9) / 10;
+    unsigned int codes = (unsigned int)(field->waterNeeded - minWater) + 2;
+    unsigned int bits = 1;
+    while ((1u << bits) < codes) bits++;
+    return bits;
+}
+
+static size_t choiceRowWords(unsigned int bits, int totalWater) {
+    size_t lineWords = CACHE_LINE / sizeof(uint64_t);
+    size_t words = (((size_t)totalWater + 1) * bits + 63) / 64;
+    return (words + lineWords - 1) / lineWords * lineWords;
+}
+
+static size_t choiceLogBytes(const ChoiceLog *log, const IrrigationData *data) {
+    return log->totalWords * sizeof(uint64_t) + data->fieldCount * (sizeof(size_t) + 1);
+}
+
+static int choiceLogInit(ChoiceLog *log, const IrrigationData *data, const int *order,
+                         Arena *arena, DPStats *stats) {
+    log->totalWords = 0;
+    log->rowOffset = arenaAlloc(arena, data->fieldCount * sizeof(size_t));
+    log->rowBits = arenaAlloc(arena, data->fieldCount);
+    log->words = NULL;
+    if (!log->rowOffset || !log->rowBits) return 0;
+
+    for (int i = 0; i < data->fieldCount; i++) {
+        log->rowBits[i] = (unsigned char)choiceBitsFor(&data->fields[order[i]]);
+        log->rowOffset[i] = log->totalWords;
+        log->totalWords += choiceRowWords(log->rowBits[i], data->totalWater);
+    }
+
+    log->words = arenaAllocAligned(arena, log->totalWords * sizeof(uint64_t), CACHE_LINE);
+    if (!log->words) return 0;
+    memset(log->words, 0, log->totalWords * sizeof(uint64_t));
+    trackAlloc(stats, choiceLogBytes(log, data));
+    return 1;
+}
+
+static void choiceLogPut(ChoiceLog *log, int field, int w, uint64_t code) {
+    unsigned int bits = log->rowBits[field];
+    size_t bitPos = (size_t)w * bits;
+    uint64_t *row = log->words + log->rowOffset[field];
+    unsigned int shift = bitPos & 63;
+
+    row[bitPos >> 6] |= code << shift;
+    if (shift + bits > 64) {
+        row[(bitPos >> 6) + 1] |= code >> (64 - shift);
+    }
+}
+
+static uint64_t choiceLogGet(const ChoiceLog *log, int field, int w) {
+    unsigned int bits = log->rowBits[field];
+    size_t bitPos = (size_t)w * bits;
+    const uint64_t *row = log->words + log->rowOffset[field];
+    unsigned int shift = bitPos & 63;
+    uint64_t value = row[bitPos >> 6] >> shift;
+
+    if (shift + bits > 64) {
+        value |= row[(bitPos >> 6) + 1] << (64 - shift);
+    }
+    return value & ((1ull << bits) - 1);
+}
+
+// Packs codes[begin..end) into a zeroed row; begin must be a multiple of 64
+// so the range starts on a word boundary.
+static void choiceLogPackRange(ChoiceLog *log, int field, const int32_t *codes,
+                               int begin, int end) {
+    unsigned int bits = log->rowBits[field];
+    uint64_t *out = log->words + log->rowOffset[field] + ((size_t)begin * bits >> 6);
+    uint64_t word = 0;
+    unsigned int used = 0;
+
+    for (int w = begin; w < end; w++) {
+        uint64_t code = (uint64_t)codes[w];
+        word |= code << used;
+        used += bits;
+        if (used >= 64) {
+            *out++ = word;
+            used -= 64;
+            word = used ? code >> (bits - used) : 0;
+        }
+    }
+    if (used) *out = word;
+}
+
+static void finishAllocation(IrrigationData *data, int best_w) {
+    data->totalWaterUsed = best_w;
+    data->remainingWater = data->totalWater - best_w;
+}
+
+// Reference engine: full (fieldCount+1) x (totalWater+1) value and parent
+// tables. Row i is the i-th field in priority order.
+static int runFullTableDP(IrrigationData *data, const int *order, DPStats *stats) {
+    if (data->fieldCount <= 0) return 0;
+    size_t rowCount = (size_t)data->totalWater + 1;
+    size_t rowBytes = rowCount * (sizeof(float) + sizeof(int));
+    size_t pointerBytes = ((size_t)data->fieldCount + 1) * (sizeof(float *) + sizeof(int *));
+    float **dp = malloc((data->fieldCount + 1) * sizeof(float *));
+    int **parent = malloc((data->fieldCount + 1) * sizeof(int *));
+    if (!dp || !parent) {
+        free(dp);
+        free(parent);
+        return 0;
+    }
+    profileAlloc(pointerBytes);
+    for (int i = 0; i <= data->fieldCount; i++) {
+        dp[i] = malloc(rowCount * sizeof(float));
+        parent[i] = malloc(rowCount * sizeof(int));
+        if (!dp[i] || !parent[i]) {
+            for (int j = 0; j <= i; j++) {
+                free(dp[j]);
+                free(parent[j]);
+            }
+            free(dp);
+            free(parent);
+            profileFree((size_t)i * rowBytes + pointerBytes);
+            return 0;
+        }
+        trackAlloc(stats, rowBytes);
+        profileAlloc(rowBytes);
+        for (int w = 0; w <= data->totalWater; w++) {
+            dp[i][w] = -FLT_MAX;
+            parent[i][w] = -1;
+        }
+    }
+    dp[0][0] = 0;
+
+    uint64_t start = phaseBegin();
+    uint64_t improved = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[order[i]];
+        int minWater = (field->waterNeeded + 9) / 10;
+        for (int w = 0; w <= data->totalWater; w++) {
+            // Skip field
+            if (dp[i][w] > dp[i + 1][w]) {
+                dp[i + 1][w] = dp[i][w];
+                parent[i + 1][w] = -1;
+            }
+
+            // Allocate to field
+            for (int x = minWater; x <= field->waterNeeded; x++) {
+                if (w < x) break;
+                float value = (100.0 - field->moisture) * 
+                             (x / (float)field->waterNeeded);
+                float candidate = dp[i][w - x] + value;
+                
+                if (candidate > dp[i + 1][w]) {
+                    dp[i + 1][w] = candidate;
+                    parent[i + 1][w] = x;
+                }
+            }
+            if (parent[i + 1][w] >= 0) improved++;
+        }
+    }
+    phaseEnd(PHASE_FILL, start);
+    profileCount((uint64_t)data->fieldCount * rowCount, improved);
+    start = phaseBegin();
+
+    // Find optimal water usage
+    int best_w = 0;
+    float best_value = -FLT_MAX;
+    for (int w = 0; w <= data->totalWater; w++) {
+        if (dp[data->fieldCount][w] > best_value) {
+            best_value = dp[data->fieldCount][w];
+            best_w = w;
+        }
+    }
+
+    // Backtrack allocations
+    int current_w = best_w;
+    for (int i = data->fieldCount - 1; i >= 0; i--) {
+        int x = parent[i + 1][current_w];
+        if (x >= 0) {
+            data->fields[order[i]].allocated = x;
+            data->fields[order[i]].scheduled = 1;
+            current_w -= x;
+        }
+    }
+    finishAllocation(data, best_w);
+    phaseEnd(PHASE_BACKTRACK, start);
+
+    for (int i = 0; i <= data->fieldCount; i++) {
+        free(dp[i]);
+        free(parent[i]);
+        trackFree(stats, rowBytes);
+    }
+    free(dp);
+    free(parent);
+    profileFree((size_t)(data->fieldCount + 1) * rowBytes + pointerBytes);
+    return 1;
+}
+
+// Reference kernel: scans every allocation x in [minWater, waterNeeded] for
+// each budget w, O(totalWater * waterNeeded) per field. Like the other
+// kernels, returns the number of reachable budgets where the field
+// improved on skipping it.
+static int updateRowReference(const Score *prev, Score *cur, const Field *field,
+                              int i, ChoiceLog *log, int begin, int end) {
+    int minWater = (field->waterNeeded + 9) / 10;
+    Score rate = fieldRate(field);
+    int improved = 0;
+
+    for (int w = begin; w < end; w++) {
+        Score best = prev[w];
+        uint64_t code = 0;
+
+        for (int x = minWater; x <= field->waterNeeded; x++) {
+            if (w < x) break;
+            Score candidate = prev[w - x] + rate * x;
+
+            if (candidate > best) {
+                best = candidate;
+                code = (uint64_t)(x - minWater) + 1;
+            }
+        }
+
+        cur[w] = best;
+        if (code) {
+            choiceLogPut(log, i, w, code);
+            improved += best >= 0;
+        }
+    }
+    return improved;
+}
+
+// Deque kernel: the field's value is linear in x, so prev[w - x] + rate * x
+// equals (prev[j] - rate * j) + rate * w with j = w - x. The best j over the
+// window [w - waterNeeded, w - minWater] is a sliding-window maximum, kept in
+// a monotone deque for O(totalWater) per field. Equal keys keep the larger j
+// (smaller x) and the skip option wins ties, matching the reference order.
+// The deque is a ring of windowMask + 1 slots, at least one window wide; a
+// chunk starting past 0 first replays the window that precedes it.
+static int updateRowDeque(const Score *prev, Score *cur, int *window, int windowMask,
+                          const Field *field, int i, ChoiceLog *log,
+                          int begin, int end) {
+    int minWater = (field->waterNeeded + 9) / 10;
+    Score rate = fieldRate(field);
+    int head = 0, tail = 0;
+    int improved = 0;
+    int first = begin - field->waterNeeded > 0 ? begin - field->waterNeeded : 0;
+
+    for (int w = first + minWater; w < end; w++) {
+        int j = w - minWater;
+        if (prev[j] >= 0) {
+            Score key = prev[j] - rate * j;
+            while (tail > head) {
+                int back = window[(tail - 1) & windowMask];
+                if (prev[back] - rate * back > key) break;
+                tail--;
+            }
+            window[tail++ & windowMask] = j;
+        }
+        while (tail > head && window[head & windowMask] < w - field->waterNeeded) {
+            head++;
+        }
+        if (w < begin) continue;
+
+        Score best = prev[w];
+        uint64_t code = 0;
+        if (tail > head) {
+            int from = window[head & windowMask];
+            int x = w - from;
+            Score candidate = prev[from] + rate * x;
+            if (candidate > best) {
+                best = candidate;
+                code = (uint64_t)(x - minWater) + 1;
+            }
+        }
+
+        cur[w] = best;
+        if (code) {
+            choiceLogPut(log, i, w, code);
+            improved++;
+        }
+    }
+    for (int w = begin; w < end && w < first + minWater; w++) {
+        cur[w] = prev[w];
+    }
+    return improved;
+}
+
+// Transition kernel: the same comparisons as the reference kernel, reordered
+// x-major over cache-sized tiles of w so the inner loop is a branch-free
+// max/blend over contiguous rows. Integer scores make the SSE4.2/AVX2 variants
+// agree with the scalar fallback bit-for-bit. Codes land in a plain int32 row
+// and are packed into the choice log tile by tile.
+#define TRANSITION_TILE 2048
+
+static void transitionTileScalar(const Score *prev, Score *cur, int32_t *codes,
+                                 int begin, int end, int minWater, int maxWater, Score rate) {
+    for (int x = minWater; x <= maxWater; x++) {
+        int start = begin > x ? begin : x;
+        Score value = rate * x;
+        int32_t code = x - minWater + 1;
+        for (int w = start; w < end; w++) {
+            Score candidate = prev[w - x] + value;
+            if (candidate > cur[w]) {
+                cur[w] = candidate;
+                codes[w] = code;
+            }
+        }
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_DISPATCH 1
+
+__attribute__((target("sse4.2")))
+static void transitionTileSSE42(const Score *prev, Score *cur, int32_t *codes,
+                                int begin, int end, int minWater, int maxWater, Score rate) {
+    for (int x = minWater; x <= maxWater; x++) {
+        int w = begin > x ? begin : x;
+        Score value = rate * x;
+        int32_t code = x - minWater + 1;
+        __m128i valueVec = _mm_set1_epi64x(value);
+        __m128i codeVec = _mm_set1_epi32(code);
+
+        for (; w + 2 <= end; w += 2) {
+            __m128i candidate = _mm_add_epi64(
+                _mm_loadu_si128((const __m128i *)(prev + w - x)), valueVec);
+            __m128i old = _mm_loadu_si128((const __m128i *)(cur + w));
+            __m128i better = _mm_cmpgt_epi64(candidate, old);
+            _mm_storeu_si128((__m128i *)(cur + w), _mm_blendv_epi8(old, candidate, better));
+
+            __m128i better32 = _mm_shuffle_epi32(better, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128i oldCodes = _mm_loadl_epi64((const __m128i *)(codes + w));
+            _mm_storel_epi64((__m128i *)(codes + w), _mm_blendv_epi8(oldCodes, codeVec, better32));
+        }
+        for (; w < end; w++) {
+            Score candidate = prev[w - x] + value;
+            if (candidate > cur[w]) {
+                cur[w] = candidate;
+                codes[w] = code;
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void transitionTileAVX2(const Score *prev, Score *cur, int32_t *codes,
+                               int begin, int end, int minWater, int maxWater, Score rate) {
+    const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+    for (int x = minWater; x <= maxWater; x++) {
+        int w = begin > x ? begin : x;
+        Score value = rate * x;
+        int32_t code = x - minWater + 1;
+        __m256i valueVec = _mm256_set1_epi64x(value);
+        __m128i codeVec = _mm_set1_epi32(code);
+
+        for (; w + 4 <= end; w += 4) {
+            __m256i candidate = _mm256_add_epi64(
+                _mm256_loadu_si256((const __m256i *)(prev + w - x)), valueVec);
+            __m256i old = _mm256_loadu_si256((const __m256i *)(cur + w));
+            __m256i better = _mm256_cmpgt_epi64(candidate, old);
+            _mm256_storeu_si256((__m256i *)(cur + w), _mm256_blendv_epi8(old, candidate, better));
+
+            __m128i better32 = _mm256_castsi256_si128(
+                _mm256_permutevar8x32_epi32(better, evenLanes));
+            __m128i oldCodes = _mm_loadu_si128((const __m128i *)(codes + w));
+            _mm_storeu_si128((__m128i *)(codes + w), _mm_blendv_epi8(oldCodes, codeVec, better32));
+        }
+        for (; w < end; w++) {
+            Score candidate = prev[w - x] + value;
+            if (candidate > cur[w]) {
+                cur[w] = candidate;
+                codes[w] = code;
+            }
+        }
+    }
+}
+#endif
+
+typedef void (*TransitionTileFn)(const Score *, Score *, int32_t *, int, int, int, int, Score);
+
+static TransitionTileFn selectTransition(SimdLevel requested, SimdLevel *selected) {
+#ifdef HAVE_X86_DISPATCH
+    __builtin_cpu_init();
+    int hasAVX2 = __builtin_cpu_supports("avx2");
+    int hasSSE42 = __builtin_cpu_supports("sse4.2");
+
+    if ((requested == SIMD_AUTO || requested == SIMD_AVX2) && hasAVX2) {
+        *selected = SIMD_AVX2;
+        return transitionTileAVX2;
+    }
+    if ((requested == SIMD_AUTO || requested == SIMD_AVX2 || requested == SIMD_SSE42) && hasSSE42) {
+        *selected = SIMD_SSE42;
+        return transitionTileSSE42;
+    }
+#else
+    (void)requested;
+#endif
+    *selected = SIMD_SCALAR;
+    return transitionTileScalar;
+}
+
+static int updateRowTransition(const Score *prev, Score *cur, int32_t *codes,
+                               TransitionTileFn transition, const Field *field,
+                               int totalWater, int i, ChoiceLog *log, int begin, int end) {
+    int minWater = (field->waterNeeded + 9) / 10;
+    int maxWater = field->waterNeeded < totalWater ? field->waterNeeded : totalWater;
+    Score rate = fieldRate(field);
+    int improved = 0;
+
+    for (int tile = begin; tile < end; tile += TRANSITION_TILE) {
+        int tileEnd = tile + TRANSITION_TILE < end ? tile + TRANSITION_TILE : end;
+        memcpy(cur + tile, prev + tile, (size_t)(tileEnd - tile) * sizeof(Score));
+        memset(codes + tile, 0, (size_t)(tileEnd - tile) * sizeof(int32_t));
+        transition(prev, cur, codes, tile, tileEnd, minWater, maxWater, rate);
+        choiceLogPackRange(log, i, codes, tile, tileEnd);
+        for (int w = tile; w < tileEnd; w++) improved += codes[w] != 0 && cur[w] >= 0;
+    }
+    return improved;
+}
+
+// Shared state for one lean DP run. Rows are cache-line aligned and each
+// worker owns a disjoint, CHUNK_CELLS-aligned slice of the water axis.
+typedef struct {
+    IrrigationData *data;
+    const int *order;           // row i schedules data->fields[order[i]]
+    const DPOptions *options;
+    ChoiceLog log;
+    Score *prev;
+    Score *cur;
+    int32_t *codes;
+    int *windows;
+    int windowMask;
+    int threadCount;
+    TransitionTileFn transition;
+    uint64_t improved[MAX_THREADS];   // per worker, for the profile
+} DPEngine;
+
+static void updateRowChunk(DPEngine *engine, int i, int worker) {
+    const IrrigationData *data = engine->data;
+    int units = (data->totalWater + CHUNK_CELLS) / CHUNK_CELLS;
+    int begin = (int)((int64_t)units * worker / engine->threadCount) * CHUNK_CELLS;
+    int end = (int)((int64_t)units * (worker + 1) / engine->threadCount) * CHUNK_CELLS;
+
+    if (end > data->totalWater + 1) end = data->totalWater + 1;
+    if (begin >= end) return;
+
+    const Field *field = &data->fields[engine->order[i]];
+    if (field->waterNeeded <= 0) {
+        memcpy(engine->cur + begin, engine->prev + begin, (size_t)(end - begin) * sizeof(Score));
+    } else if (engine->options->kernel == DP_KERNEL_REFERENCE) {
+        engine->improved[worker] += updateRowReference(engine->prev, engine->cur, field, i,
+                                                       &engine->log, begin, end);
+    } else if (engine->options->kernel == DP_KERNEL_SIMD) {
+        engine->improved[worker] += updateRowTransition(engine->prev, engine->cur, engine->codes,
+                                                        engine->transition, field,
+                                                        data->totalWater, i, &engine->log,
+                                                        begin, end);
+    } else {
+        int *window = engine->windows + (size_t)worker * (engine->windowMask + 1);
+        engine->improved[worker] += updateRowDeque(engine->prev, engine->cur, window,
+                                                   engine->windowMask, field, i, &engine->log,
+                                                   begin, end);
+    }
+}
+
+// Persistent workers for the row updates. The calling thread acts as worker
+// 0; each field bumps the generation, every worker runs its chunk and the
+// caller waits until all have finished before swapping rows.
+typedef struct {
+    DPEngine *engine;
+    ThreadHandle *threads;
+    size_t threadBytes;
+    int *workerIds;
+    int started;
+    PoolMutex lock;
+    PoolCond wake;
+    PoolCond finished;
+    unsigned long generation;
+    int pending;
+    int field;
+    int shutdown;
+} DPThreadPool;
+
+typedef struct {
+    DPThreadPool *pool;
+    int worker;
+} DPWorkerArg;
+
+static void poolWorkerLoop(DPThreadPool *pool, int worker) {
+    unsigned long seen = 0;
+    for (;;) {
+        poolLock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            poolWait(&pool->wake, &pool->lock);
+        }
+        if (pool->shutdown) {
+            poolUnlock(&pool->lock);
+            return;
+        }
+        seen = pool->generation;
+        int field = pool->field;
+        poolUnlock(&pool->lock);
+
+        updateRowChunk(pool->engine, field, worker);
+
+        poolLock(&pool->lock);
+        if (--pool->pending == 0) poolSignal(&pool->finished);
+        poolUnlock(&pool->lock);
+    }
+}
+
+static ThreadResult THREAD_CALL poolThreadMain(void *arg) {
+    DPWorkerArg *worker = arg;
+    poolWorkerLoop(worker->pool, worker->worker);
+    return 0;
+}
+
+static int poolStart(DPThreadPool *pool, DPEngine *engine, DPWorkerArg *args) {
+    memset(pool, 0, sizeof(*pool));
+    pool->engine = engine;
+    pool->threadBytes = engine->threadCount * sizeof(ThreadHandle);
+    pool->threads = malloc(pool->threadBytes);
+    if (!pool->threads) return 0;
+    profileAlloc(pool->threadBytes);
+    poolMutexInit(&pool->lock);
+    poolCondInit(&pool->wake);
+    poolCondInit(&pool->finished);
+
+    for (int t = 1; t < engine->threadCount; t++) {
+        args[t].pool = pool;
+        args[t].worker = t;
+        if (!threadCreate(&pool->threads[t], poolThreadMain, &args[t])) break;
+        pool->started++;
+    }
+    // Run with however many workers actually started.
+    engine->threadCount = pool->started + 1;
+    return 1;
+}
+
+static void poolRunRow(DPThreadPool *pool, int field) {
+    poolLock(&pool->lock);
+    pool->field = field;
+    pool->pending = pool->started;
+    pool->generation++;
+    poolBroadcast(&pool->wake);
+    poolUnlock(&pool->lock);
+
+    updateRowChunk(pool->engine, field, 0);
+
+    poolLock(&pool->lock);
+    while (pool->pending > 0) {
+        poolWait(&pool->finished, &pool->lock);
+    }
+    poolUnlock(&pool->lock);
+}
+
+static void poolStop(DPThreadPool *pool) {
+    poolLock(&pool->lock);
+    pool->shutdown = 1;
+    poolBroadcast(&pool->wake);
+    poolUnlock(&pool->lock);
+
+    for (int t = 1; t <= pool->started; t++) {
+        threadJoin(pool->threads[t]);
+    }
+    poolCondDestroy(&pool->wake);
+    poolCondDestroy(&pool->finished);
+    poolMutexDestroy(&pool->lock);
+    free(pool->threads);
+    profileFree(pool->threadBytes);
+}
+
+static int windowMaskFor(const IrrigationData *data) {
+    int widest = 1;
+    for (int i = 0; i < data->fieldCount; i++) {
+        int need = data->fields[i].waterNeeded;
+        int width = need - (need + 9) / 10 + 1;
+        if (width > widest) widest = width;
+    }
+    if (widest > data->totalWater + 1) widest = data->totalWater + 1;
+
+    int slots = 1;
+    while (slots < widest + 1) slots <<= 1;
+    return slots - 1;
+}
+
+// Walks the choice log back from budget best_w of the last row, allocating
+// to the fields of rows that chose one.
+static void dpBacktrackFrom(IrrigationData *data, const int *order, const ChoiceLog *log,
+                            int best_w) {
+    int current_w = best_w;
+    for (int i = data->fieldCount - 1; i >= 0; i--) {
+        uint64_t code = choiceLogGet(log, i, current_w);
+        if (code) {
+            Field *field = &data->fields[order[i]];
+            int x = (field->waterNeeded + 9) / 10 + (int)code - 1;
+            field->allocated = x;
+            field->scheduled = 1;
+            current_w -= x;
+        }
+    }
+    finishAllocation(data, best_w);
+}
+
+// Finds the best budget in the last row and backtracks from it. Returns
+// the score.
+static Score dpBacktrack(IrrigationData *data, const int *order, const ChoiceLog *log,
+                         const Score *last) {
+    int best_w = 0;
+    Score best_value = SCORE_UNREACHABLE;
+    for (int w = 0; w <= data->totalWater; w++) {
+        if (last[w] > best_value) {
+            best_value = last[w];
+            best_w = w;
+        }
+    }
+    dpBacktrackFrom(data, order, log, best_w);
+    return best_value;
+}
+
+// Lean engine: two rolling fixed-point rows plus the packed choice log.
+// Scores are (100 - moisture) * x / waterNeeded in units of 2^-SCORE_SHIFT,
+// using a per-field rate so every kernel compares exact integers and picks
+// the same allocations. Reachable budgets score >= 0; SCORE_UNREACHABLE
+// (and anything derived from it) stays far below zero. All buffers come
+// from the request arena, so a serving worker reuses them across requests;
+// tables, when given, keeps them for later backtracks.
+static int runLeanDP(IrrigationData *data, const int *order, const DPOptions *options,
+                     Arena *arena, DPStats *stats, DPTables *tables) {
+    size_t rowCount = (size_t)data->totalWater + 1;
+    int chunkCount = (int)((rowCount + CHUNK_CELLS - 1) / CHUNK_CELLS);
+    DPEngine engine;
+
+    memset(&engine, 0, sizeof(engine));
+    engine.data = data;
+    engine.order = order;
+    engine.options = options;
+    engine.threadCount = options->threads < chunkCount ? options->threads : chunkCount;
+    engine.windowMask = windowMaskFor(data);
+
+    size_t windowBytes = (size_t)engine.threadCount * (engine.windowMask + 1) * sizeof(int);
+    size_t scratchBytes = rowCount * (2 * sizeof(Score) + sizeof(int32_t)) + windowBytes;
+    engine.prev = arenaAllocAligned(arena, rowCount * sizeof(Score), CACHE_LINE);
+    engine.cur = arenaAllocAligned(arena, rowCount * sizeof(Score), CACHE_LINE);
+    engine.codes = arenaAllocAligned(arena, rowCount * sizeof(int32_t), CACHE_LINE);
+    engine.windows = arenaAlloc(arena, windowBytes);
+    if (!engine.prev || !engine.cur || !engine.codes || !engine.windows ||
+        !choiceLogInit(&engine.log, data, order, arena, stats)) {
+        return 0;
+    }
+    trackAlloc(stats, scratchBytes);
+
+    engine.transition = selectTransition(options->simd, &stats->simdLevel);
+
+    DPThreadPool pool;
+    DPWorkerArg workerArgs[MAX_THREADS];
+    int pooled = engine.threadCount > 1 && poolStart(&pool, &engine, workerArgs);
+    if (!pooled) engine.threadCount = 1;
+    stats->threadsUsed = engine.threadCount;
+
+    for (int w = 0; w <= data->totalWater; w++) {
+        engine.prev[w] = SCORE_UNREACHABLE;
+    }
+    engine.prev[0] = 0;
+
+    uint64_t start = phaseBegin();
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (pooled) {
+            poolRunRow(&pool, i);
+        } else {
+            updateRowChunk(&engine, i, 0);
+        }
+
+        Score *swap = engine.prev;
+        engine.prev = engine.cur;
+        engine.cur = swap;
+    }
+    if (pooled) poolStop(&pool);
+    phaseEnd(PHASE_FILL, start);
+    if (profileActive()) {
+        uint64_t improved = 0;
+        for (int worker = 0; worker < engine.threadCount; worker++) {
+            improved += engine.improved[worker];
+        }
+        profileCount((uint64_t)data->fieldCount * rowCount, improved);
+    }
+
+    start = phaseBegin();
+    stats->bestScore = dpBacktrack(data, order, &engine.log, engine.prev);
+    phaseEnd(PHASE_BACKTRACK, start);
+    if (tables) {
+        tables->log = engine.log;
+        tables->last = engine.prev;
+    }
+
+    trackFree(stats, scratchBytes + choiceLogBytes(&engine.log, data));
+    return 1;
+}
+
+static inline void dpOptionsInit(DPOptions *options) {
+    options->memoryMode = DP_MEMORY_LEAN;
+    options->kernel = DP_KERNEL_DEQUE;
+    options->simd = SIMD_AUTO;
+    options->threads = 1;
+    options->reportStats = 0;
+}
+
+// Runs the DP over the fields in the given priority order (from
+// prioritizeFields); the fields stay where they are. Returns 0 when the
+// tables do not fit in memory.
+static inline int dpScheduleOrdered(IrrigationData *data, const int *order,
+                                    const DPOptions *options, Arena *arena, DPStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->threadsUsed = 1;
+    stats->fullTableBytes = ((size_t)data->fieldCount + 1) *
+                            ((size_t)data->totalWater + 1) * (sizeof(float) + sizeof(int));
+
+    return options->memoryMode == DP_MEMORY_FULL
+               ? runFullTableDP(data, order, stats)
+               : runLeanDP(data, order, options, arena, stats, NULL);
+}
+
+// The lean DP, keeping its choice log and last row in the arena. Returns 0
+// when the tables do not fit in memory.
+static inline int dpScheduleTables(IrrigationData *data, const int *order,
+                                   const DPOptions *options, Arena *arena, DPStats *stats,
+                                   DPTables *tables) {
+    memset(stats, 0, sizeof(*stats));
+    stats->threadsUsed = 1;
+    stats->fullTableBytes = ((size_t)data->fieldCount + 1) *
+                            ((size_t)data->totalWater + 1) * (sizeof(float) + sizeof(int));
+    return runLeanDP(data, order, options, arena, stats, tables);
+}
+
+// Schedules a parsed request in place; fields stay in input order. Returns
+// 0 when the tables do not fit in memory.
+static inline int dpSchedule(IrrigationData *data, const DPOptions *options, Arena *arena,
+                             DPStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return dpScheduleOrdered(data, order, options, arena, stats);
+}
+
+#endif
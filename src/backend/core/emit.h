@@ -0,0 +1,354 @@
+#ifndef SMARTFARM_EMIT_H
+#define SMARTFARM_EMIT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "farm.h"
+
+// Schedule output stage: the whole response is formatted into one growable
+// buffer (integers by hand, no printf) and written with a single fwrite.
+
+typedef enum {
+    OUTPUT_PRETTY,
+    OUTPUT_COMPACT,
+    OUTPUT_BINARY
+} OutputFormat;
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} OutputBuffer;
+
+// Whitespace for the JSON schedule output: pretty for one-shot runs, empty
+// for single-line responses in serve mode.
+typedef struct {
+    const char *newline;
+    const char *indent1;
+    const char *indent2;
+    const char *indent3;
+    const char *space;
+} OutputLayout;
+
+static inline OutputLayout outputLayout(int compact) {
+    OutputLayout layout;
+    layout.newline = compact ? "" : "\n";
+    layout.indent1 = compact ? "" : "  ";
+    layout.indent2 = compact ? "" : "    ";
+    layout.indent3 = compact ? "" : "      ";
+    layout.space = compact ? "" : " ";
+    return layout;
+}
+
+static inline void outputInit(OutputBuffer *buffer) {
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static inline void outputFree(OutputBuffer *buffer) {
+    free(buffer->data);
+    profileFree(buffer->capacity);
+    outputInit(buffer);
+}
+
+// Makes room for extra more bytes. After a failed allocation every later
+// append is dropped and outputFlush reports the error.
+static inline int outputReserve(OutputBuffer *buffer, size_t extra) {
+    if (buffer->failed) return 0;
+    if (buffer->capacity - buffer->length >= extra) return 1;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity - buffer->length < extra) capacity *= 2;
+    char *grown = realloc(buffer->data, capacity);
+    if (!grown) {
+        buffer->failed = 1;
+        return 0;
+    }
+    profileAlloc(capacity - buffer->capacity);
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+static inline void outputBytes(OutputBuffer *buffer, const void *bytes, size_t length) {
+    if (!outputReserve(buffer, length)) return;
+    memcpy(buffer->data + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static inline void outputText(OutputBuffer *buffer, const char *text) {
+    outputBytes(buffer, text, strlen(text));
+}
+
+static inline void outputInt(OutputBuffer *buffer, int value) {
+    char digits[12];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    if (!outputReserve(buffer, sizeof(digits))) return;
+    if (value < 0) buffer->data[buffer->length++] = '-';
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (count > 0) buffer->data[buffer->length++] = digits[--count];
+}
+
+// Fixed-point decimal with the given number of digits after the point.
+static inline void outputFixed(OutputBuffer *buffer, double value, int decimals) {
+    long long scale = 1;
+    for (int d = 0; d < decimals; d++) scale *= 10;
+
+    long long scaled = (long long)(value * scale + (value < 0 ? -0.5 : 0.5));
+    if (scaled < 0) {
+        outputText(buffer, "-");
+        scaled = -scaled;
+    }
+    long long whole = scaled / scale;
+    long long fraction = scaled % scale;
+    char digits[24];
+    int count = 0;
+
+    do {
+        digits[count++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole && count < 20);
+    if (!outputReserve(buffer, (size_t)count + 1 + (size_t)decimals)) return;
+    while (count > 0) buffer->data[buffer->length++] = digits[--count];
+    if (decimals <= 0) return;
+    buffer->data[buffer->length++] = '.';
+    for (int d = decimals - 1; d >= 0; d--) {
+        buffer->data[buffer->length + d] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    buffer->length += (size_t)decimals;
+}
+
+static inline void outputU32(OutputBuffer *buffer, uint32_t value) {
+    unsigned char bytes[4];
+    bytes[0] = (unsigned char)value;
+    bytes[1] = (unsigned char)(value >> 8);
+    bytes[2] = (unsigned char)(value >> 16);
+    bytes[3] = (unsigned char)(value >> 24);
+    outputBytes(buffer, bytes, sizeof(bytes));
+}
+
+// Writes the buffer with one fwrite and empties it. Returns 0 if any append
+// failed or the write was short.
+static inline int outputFlush(OutputBuffer *buffer, FILE *out) {
+    int ok = !buffer->failed &&
+             fwrite(buffer->data, 1, buffer->length, out) == buffer->length;
+    buffer->length = 0;
+    buffer->failed = 0;
+    return ok;
+}
+
+// "key": value with the layout's indentation and an optional trailing comma.
+static inline void outputIntMember(OutputBuffer *buffer, const OutputLayout *layout,
+                                   const char *indent, const char *key, int value, int comma) {
+    outputText(buffer, indent);
+    outputText(buffer, key);
+    outputText(buffer, layout->space);
+    outputInt(buffer, value);
+    if (comma) outputText(buffer, ",");
+}
+
+// Extra members for comparison reports and deadline-bounded runs.
+typedef struct {
+    double objective;
+    double wallMs;
+    int optimal;        // 1 or 0 adds "optimal"; -1 leaves it out
+} ScheduleMetrics;
+
+// JSON schedule object in the layout every scheduler has always printed,
+// without the trailing newline. Fields are listed in order (indices into
+// data->fields), or in input order when order is NULL. timed adds the
+// per-field timeNeeded and the time/electricity totals; metrics, when
+// given, follow "algorithm".
+static inline void emitScheduleObject(OutputBuffer *buffer, const IrrigationData *data,
+                                      const int *order, const char *algorithm, int timed,
+                                      int compact, const ScheduleMetrics *metrics) {
+    OutputLayout o = outputLayout(compact);
+    int scheduledCount = 0;
+    size_t estimate = 256;
+
+    // Size the buffer once up front; a pretty record is about 140 bytes
+    // plus the name.
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (data->fields[i].scheduled) estimate += 144 + (size_t)data->fields[i].nameLength;
+    }
+    if (!outputReserve(buffer, estimate)) return;
+
+    outputText(buffer, "{");
+    outputText(buffer, o.newline);
+    outputText(buffer, o.indent1);
+    outputText(buffer, "\"algorithm\":");
+    outputText(buffer, o.space);
+    outputText(buffer, "\"");
+    outputText(buffer, algorithm);
+    outputText(buffer, "\",");
+    outputText(buffer, o.newline);
+    if (metrics) {
+        outputText(buffer, o.indent1);
+        outputText(buffer, "\"objective\":");
+        outputText(buffer, o.space);
+        outputFixed(buffer, metrics->objective, 4);
+        outputText(buffer, ",");
+        outputText(buffer, o.newline);
+        outputText(buffer, o.indent1);
+        outputText(buffer, "\"wallMs\":");
+        outputText(buffer, o.space);
+        outputFixed(buffer, metrics->wallMs, 3);
+        outputText(buffer, ",");
+        outputText(buffer, o.newline);
+        if (metrics->optimal >= 0) {
+            outputText(buffer, o.indent1);
+            outputText(buffer, "\"optimal\":");
+            outputText(buffer, o.space);
+            outputText(buffer, metrics->optimal ? "true," : "false,");
+            outputText(buffer, o.newline);
+        }
+    }
+    outputText(buffer, o.indent1);
+    outputText(buffer, "\"scheduled\":");
+    outputText(buffer, o.space);
+    outputText(buffer, "[");
+    outputText(buffer, o.newline);
+
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order ? order[k] : k];
+        if (!field->scheduled) continue;
+
+        if (scheduledCount > 0) {
+            outputText(buffer, ",");
+            outputText(buffer, o.newline);
+        }
+        outputText(buffer, o.indent2);
+        outputText(buffer, "{");
+        outputText(buffer, o.newline);
+        outputText(buffer, o.indent3);
+        outputText(buffer, "\"name\":");
+        outputText(buffer, o.space);
+        outputText(buffer, "\"");
+        outputBytes(buffer, field->name, (size_t)field->nameLength);
+        outputText(buffer, "\",");
+        outputText(buffer, o.newline);
+        outputIntMember(buffer, &o, o.indent3, "\"moisture\":", field->moisture, 1);
+        outputText(buffer, o.newline);
+        outputIntMember(buffer, &o, o.indent3, "\"need\":", field->waterNeeded, 1);
+        outputText(buffer, o.newline);
+        outputIntMember(buffer, &o, o.indent3, "\"allocated\":", field->allocated, timed);
+        outputText(buffer, o.newline);
+        if (timed) {
+            outputIntMember(buffer, &o, o.indent3, "\"timeNeeded\":", field->timeNeeded, 0);
+            outputText(buffer, o.newline);
+        }
+        outputText(buffer, o.indent2);
+        outputText(buffer, "}");
+        scheduledCount++;
+    }
+
+    outputText(buffer, o.newline);
+    outputText(buffer, o.indent1);
+    outputText(buffer, "],");
+    outputText(buffer, o.newline);
+    outputIntMember(buffer, &o, o.indent1, "\"totalWaterUsed\":", data->totalWaterUsed, 1);
+    outputText(buffer, o.newline);
+    if (timed) {
+        outputIntMember(buffer, &o, o.indent1, "\"totalTimeUsed\":", data->totalTimeUsed, 1);
+        outputText(buffer, o.newline);
+        outputIntMember(buffer, &o, o.indent1, "\"remainingElectricity\":",
+                        data->remainingElectricity, 1);
+        outputText(buffer, o.newline);
+    }
+    outputIntMember(buffer, &o, o.indent1, "\"remainingWater\":", data->remainingWater, 0);
+    outputText(buffer, o.newline);
+    outputText(buffer, "}");
+}
+
+static inline void emitScheduleJson(OutputBuffer *buffer, const IrrigationData *data,
+                                    const int *order, const char *algorithm, int timed,
+                                    int compact) {
+    emitScheduleObject(buffer, data, order, algorithm, timed, compact, NULL);
+    outputText(buffer, "\n");
+}
+
+// Fixed-layout binary result, all fields little-endian 32-bit:
+//
+//   header (32 bytes)
+//     magic "SFR1", headerBytes = 32, recordBytes = 20, flags (bit 0: time
+//     constraints), fieldCount, scheduledCount, totalWaterUsed,
+//     remainingWater
+//   time totals (8 bytes, only when flag bit 0 is set)
+//     totalTimeUsed, remainingElectricity
+//   scheduledCount records (20 bytes each, in output order)
+//     originalIndex, moisture, waterNeeded, allocated, timeNeeded
+//
+// Names are left out; originalIndex is the field's position in the request.
+// Error responses stay JSON, so a reader can tell them apart by the first
+// byte ('{' instead of 'S').
+#define BINARY_RESULT_MAGIC "SFR1"
+#define BINARY_HEADER_BYTES 32
+#define BINARY_RECORD_BYTES 20
+
+static inline void emitScheduleBinary(OutputBuffer *buffer, const IrrigationData *data,
+                                      const int *order, int timed) {
+    uint32_t scheduledCount = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (data->fields[i].scheduled) scheduledCount++;
+    }
+
+    if (!outputReserve(buffer, BINARY_HEADER_BYTES + 8 +
+                                   (size_t)scheduledCount * BINARY_RECORD_BYTES)) {
+        return;
+    }
+    outputBytes(buffer, BINARY_RESULT_MAGIC, 4);
+    outputU32(buffer, BINARY_HEADER_BYTES);
+    outputU32(buffer, BINARY_RECORD_BYTES);
+    outputU32(buffer, timed ? 1u : 0u);
+    outputU32(buffer, (uint32_t)data->fieldCount);
+    outputU32(buffer, scheduledCount);
+    outputU32(buffer, (uint32_t)data->totalWaterUsed);
+    outputU32(buffer, (uint32_t)data->remainingWater);
+    if (timed) {
+        outputU32(buffer, (uint32_t)data->totalTimeUsed);
+        outputU32(buffer, (uint32_t)data->remainingElectricity);
+    }
+
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order ? order[k] : k];
+        if (!field->scheduled) continue;
+        outputU32(buffer, (uint32_t)field->originalIndex);
+        outputU32(buffer, (uint32_t)field->moisture);
+        outputU32(buffer, (uint32_t)field->waterNeeded);
+        outputU32(buffer, (uint32_t)field->allocated);
+        outputU32(buffer, (uint32_t)field->timeNeeded);
+    }
+}
+
+// Formats the schedule in the requested format and writes it in one go.
+// order is the listing order, NULL for input order. Returns 0 if the
+// response could not be built or written.
+static inline int emitSchedule(FILE *out, const IrrigationData *data, const int *order,
+                               const char *algorithm, int timed, OutputFormat format) {
+    OutputBuffer buffer;
+    int ok;
+
+    uint64_t start = phaseBegin();
+
+    outputInit(&buffer);
+    if (format == OUTPUT_BINARY) {
+        emitScheduleBinary(&buffer, data, order, timed);
+    } else {
+        emitScheduleJson(&buffer, data, order, algorithm, timed, format == OUTPUT_COMPACT);
+    }
+    ok = outputFlush(&buffer, out);
+    outputFree(&buffer);
+    phaseEnd(PHASE_OUTPUT, start);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef SMARTFARM_FARM_H
+#define SMARTFARM_FARM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "json.h"
+#include "profile.h"
+
+typedef struct {
+    const char *name;       // slice of the input buffer, still JSON-escaped
+    int nameLength;
+    int moisture;
+    int waterNeeded;
+    int timeNeeded;
+    int allocated;
+    int scheduled;
+    int originalIndex;
+} Field;
+
+typedef struct {
+    Field *fields;
+    int fieldCount;
+    int totalWater;
+    int totalElectricity;
+    int waterDeliveryRate;
+    int totalWaterUsed;
+    int totalTimeUsed;
+    int remainingWater;
+    int remainingElectricity;
+    int useTimeConstraints;
+    int deadlineMs;         // request's latency budget; 0 for none
+} IrrigationData;
+
+// Priority order as a qsort comparator: lowest moisture first, then highest
+// water need. The schedulers use prioritizeFields, which gives the same
+// order (ties kept in input order) without moving any Field.
+static inline int compareFields(const void *a, const void *b) {
+    const Field *fieldA = (const Field *)a;
+    const Field *fieldB = (const Field *)b;
+
+    if (fieldA->moisture != fieldB->moisture) {
+        return fieldA->moisture - fieldB->moisture;
+    }
+    return fieldB->waterNeeded - fieldA->waterNeeded;
+}
+
+#define PRIORITY_DIGIT_BITS 11
+#define PRIORITY_NEED_MASK ((1u << PRIORITY_DIGIT_BITS) - 1)
+#define PRIORITY_MOISTURE_SHIFT 32
+#define PRIORITY_MOISTURE_MASK 127u
+
+// One stable counting pass over (key, index) pairs on the digit
+// (key >> shift) & mask.
+static inline void priorityPass(const uint64_t *keysIn, const int *indexIn, uint64_t *keysOut,
+                                int *indexOut, size_t count, int shift, uint32_t mask) {
+    size_t offsets[PRIORITY_NEED_MASK + 1];
+    size_t total = 0;
+
+    memset(offsets, 0, ((size_t)mask + 1) * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) offsets[(keysIn[i] >> shift) & mask]++;
+    for (uint32_t digit = 0; digit <= mask; digit++) {
+        size_t bucket = offsets[digit];
+        offsets[digit] = total;
+        total += bucket;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = offsets[(keysIn[i] >> shift) & mask]++;
+        keysOut[slot] = keysIn[i];
+        indexOut[slot] = indexIn[i];
+    }
+}
+
+// Field indices in priority order (see compareFields; ties stay in input
+// order), for validated input: moisture 0-100, waterNeeded >= 0. The fields
+// themselves never move. Each index carries a key of moisture above the
+// need counted down from the largest need; counting passes on the need
+// digits that vary and then on the moisture make it O(n). Returns NULL if
+// out of memory.
+static inline int *prioritizeFields(const IrrigationData *data, Arena *arena) {
+    size_t count = (size_t)data->fieldCount;
+    uint64_t *keys = arenaAlloc(arena, (count + 1) * sizeof(uint64_t));
+    uint64_t *keysSpare = arenaAlloc(arena, (count + 1) * sizeof(uint64_t));
+    int *order = arenaAlloc(arena, (count + 1) * sizeof(int));
+    int *orderSpare = arenaAlloc(arena, (count + 1) * sizeof(int));
+    int maxNeed = 0;
+    uint64_t start = phaseBegin();
+
+    if (!keys || !keysSpare || !order || !orderSpare) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (data->fields[i].waterNeeded > maxNeed) maxNeed = data->fields[i].waterNeeded;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Field *field = &data->fields[i];
+        keys[i] = (uint64_t)(uint32_t)field->moisture << PRIORITY_MOISTURE_SHIFT |
+                  (uint32_t)(maxNeed - field->waterNeeded);
+        order[i] = (int)i;
+    }
+
+    for (int shift = 0; shift < 32 && (maxNeed >> shift) > 0; shift += PRIORITY_DIGIT_BITS) {
+        uint64_t *swapKeys = keys;
+        int *swapOrder = order;
+        priorityPass(keys, order, keysSpare, orderSpare, count, shift, PRIORITY_NEED_MASK);
+        keys = keysSpare;
+        order = orderSpare;
+        keysSpare = swapKeys;
+        orderSpare = swapOrder;
+    }
+    priorityPass(keys, order, keysSpare, orderSpare, count, PRIORITY_MOISTURE_SHIFT,
+                 PRIORITY_MOISTURE_MASK);
+    phaseEnd(PHASE_SORT, start);
+    return orderSpare;
+}
+
+// Numbers are read as ints; any other value type leaves the target at 0,
+// the same as a missing key.
+static inline int parseIntMember(JsonCursor *json, int *out) {
+    char c = jsonPeek(json);
+    if (c == '-' || (c >= '0' && c <= '9')) return jsonInt(json, out);
+    return jsonSkipValue(json);
+}
+
+static inline int parseFieldObject(JsonCursor *json, Field *field, int *named) {
+    JsonSlice key;
+    int first = 1;
+
+    memset(field, 0, sizeof(*field));
+    *named = 0;
+    if (jsonPeek(json) != '{') return jsonSkipValue(json);
+    json->cur++;
+
+    while (jsonNextKey(json, &first, &key)) {
+        int ok;
+        if (jsonSliceEquals(key, "name") && jsonPeek(json) == '"') {
+            JsonSlice name = {NULL, 0};
+            ok = jsonString(json, &name);
+            field->name = name.ptr;
+            field->nameLength = name.length;
+            *named = 1;
+        } else if (jsonSliceEquals(key, "moisture")) {
+            ok = parseIntMember(json, &field->moisture);
+        } else if (jsonSliceEquals(key, "waterNeeded")) {
+            ok = parseIntMember(json, &field->waterNeeded);
+        } else {
+            ok = jsonSkipValue(json);
+        }
+        if (!ok) return 0;
+    }
+    return !json->error;
+}
+
+static inline int parseFieldArray(JsonCursor *json, IrrigationData *data, Arena *arena) {
+    size_t capacity = 64;
+    int first = 1;
+
+    data->fields = arenaAlloc(arena, capacity * sizeof(Field));
+    if (!data->fields) return 0;
+    data->fieldCount = 0;
+
+    if (!jsonConsume(json, '[')) return 0;
+    while (jsonNextElement(json, &first)) {
+        int named;
+        if ((size_t)data->fieldCount == capacity) {
+            Field *grown = arenaGrow(arena, data->fields, capacity * sizeof(Field),
+                                     capacity * 2 * sizeof(Field));
+            if (!grown) return 0;
+            data->fields = grown;
+            capacity *= 2;
+        }
+
+        Field *field = &data->fields[data->fieldCount];
+        if (!parseFieldObject(json, field, &named)) return 0;
+        if (named) {
+            field->originalIndex = data->fieldCount;
+            data->fieldCount++;
+        }
+    }
+    return !json->error;
+}
+
+// Checks shared by every input path. fields holds the fieldCount named
+// fields that were read; only the first declaredCount of them are kept.
+static inline int validateIrrigationInput(IrrigationData *data, int declaredCount, int hasFields) {
+    if (data->totalWater <= 0) {
+        fprintf(stderr, "Error: Invalid total water amount\n");
+        return 0;
+    }
+
+    if (declaredCount <= 0) {
+        fprintf(stderr, "Error: Invalid field count: %d\n", declaredCount);
+        return 0;
+    }
+
+    if (data->deadlineMs < 0) {
+        fprintf(stderr, "Error: Invalid deadline: %d ms\n", data->deadlineMs);
+        return 0;
+    }
+
+    if (!hasFields) {
+        fprintf(stderr, "Error: Fields array not found\n");
+        return 0;
+    }
+
+    if (data->fieldCount > declaredCount) data->fieldCount = declaredCount;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (field->moisture < 0 || field->moisture > 100) {
+            fprintf(stderr, "Error: Invalid moisture level for field %.*s: %d\n",
+                    field->nameLength, field->name, field->moisture);
+            return 0;
+        }
+
+        if (field->waterNeeded < 0) {
+            fprintf(stderr, "Error: Invalid water needed for field %.*s: %d\n",
+                    field->nameLength, field->name, field->waterNeeded);
+            return 0;
+        }
+    }
+    return data->fieldCount > 0;
+}
+
+static inline int parseIrrigationText(const char *jsonString, size_t length,
+                                      IrrigationData *data, Arena *arena) {
+    if (!jsonString || !data) return 0;
+
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+    int declaredCount = 0;
+    int parsedCount = 0;
+    int sawFields = 0;
+
+    memset(data, 0, sizeof(IrrigationData));
+    jsonInit(&json, jsonString, length);
+
+    if (jsonConsume(&json, '{')) {
+        while (jsonNextKey(&json, &first, &key)) {
+            int ok;
+            if (jsonSliceEquals(key, "totalWater")) {
+                ok = parseIntMember(&json, &data->totalWater);
+            } else if (jsonSliceEquals(key, "totalElectricity")) {
+                ok = parseIntMember(&json, &data->totalElectricity);
+            } else if (jsonSliceEquals(key, "waterDeliveryRate")) {
+                ok = parseIntMember(&json, &data->waterDeliveryRate);
+            } else if (jsonSliceEquals(key, "fieldCount")) {
+                ok = parseIntMember(&json, &declaredCount);
+            } else if (jsonSliceEquals(key, "deadlineMs")) {
+                ok = parseIntMember(&json, &data->deadlineMs);
+            } else if (jsonSliceEquals(key, "fields")) {
+                if (jsonPeek(&json) != '[') {
+                    fprintf(stderr, "Error: Fields array start not found\n");
+                    return 0;
+                }
+                sawFields = 1;
+                ok = parseFieldArray(&json, data, arena);
+                parsedCount = data->fieldCount;
+            } else {
+                ok = jsonSkipValue(&json);
+            }
+            if (!ok) break;
+        }
+    }
+    if (json.error || (sawFields && !data->fields)) {
+        fprintf(stderr, "Error: Malformed JSON near offset %ld\n", jsonOffset(&json));
+        return 0;
+    }
+
+    data->fieldCount = parsedCount;
+    return validateIrrigationInput(data, declaredCount, sawFields);
+}
+
+// Single forward pass over the request JSON shared by every scheduler. Top
+// level keys may appear in any order; unknown keys are skipped. Only the
+// first fieldCount named field objects are kept.
+static inline int parseIrrigationInput(const char *jsonString, size_t length,
+                                       IrrigationData *data, Arena *arena) {
+    uint64_t start = phaseBegin();
+    int ok = parseIrrigationText(jsonString, length, data, arena);
+    phaseEnd(PHASE_PARSE, start);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef SMARTFARM_FRONTIER_H
+#define SMARTFARM_FRONTIER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "emit.h"
+#include "farm.h"
+#include "incremental.h"
+#include "json.h"
+#include "latency.h"
+#include "score.h"
+
+// Water-budget frontier. The DP's last row already holds the best score for
+// every budget, so one run gives the whole value-versus-water curve, and
+// the choice log it keeps can be walked back from any budget. A full
+// request builds the frontier and answers with its breakpoints;
+// {"command":"budget","water":N} then returns the schedule for a budget of
+// N units, the same one a run with totalWater N would pick, without
+// another DP.
+//
+// The curve is the best score over budgets up to w, so it never falls, and
+// it is piecewise linear between the points where its slope changes; only
+// those are sent. With a tolerance, consecutive pieces are merged while
+// the straight line between breakpoints stays that close to the curve.
+
+typedef struct {
+    int water;
+    double objective;
+} FrontierPoint;
+
+typedef struct {
+    IncrementalSession session;  // the copied request, the tables and the points
+    DPOptions options;
+    DPTables tables;
+    DPStats dpStats;
+    int *bestAt;                 // bestAt[w]: the budget up to w with the best score
+    FrontierPoint *points;
+    int pointCount;
+    double tolerance;            // allowed error of the breakpoints, in objective units
+    double maxError;             // the largest the curve is off between breakpoints
+    uint64_t buildMicros;
+    uint64_t budgetMicros;       // the last budget command
+} Frontier;
+
+static inline void frontierInit(Frontier *frontier, const DPOptions *options, double tolerance) {
+    memset(frontier, 0, sizeof(*frontier));
+    incrementalSessionInit(&frontier->session);
+    frontier->options = *options;
+    frontier->tolerance = tolerance;
+}
+
+static inline void frontierRelease(Frontier *frontier) {
+    arenaRelease(&frontier->session.arena);
+    memset(frontier, 0, sizeof(*frontier));
+}
+
+static inline double frontierObjective(Score score) {
+    return (double)score / (double)(1ll << SCORE_SHIFT);
+}
+
+// Breakpoints where the slope changes; exact, since scores are integers.
+static void frontierExactPoints(Frontier *frontier, const Score *curve, int totalWater) {
+    int count = 0;
+
+    for (int w = 0; w <= totalWater; w++) {
+        if (w > 0 && w < totalWater &&
+            curve[w] - curve[w - 1] == curve[w + 1] - curve[w]) {
+            continue;
+        }
+        frontier->points[count].water = w;
+        frontier->points[count].objective = frontierObjective(curve[w]);
+        count++;
+    }
+    frontier->pointCount = count;
+    frontier->maxError = 0;
+}
+
+// Sliding cone: each piece starts at the previous breakpoint and keeps the
+// range of slopes that pass within the tolerance of every point so far;
+// once the range closes, the piece ends one unit earlier on the middle
+// slope.
+static void frontierMergedPoints(Frontier *frontier, const Score *curve, int totalWater) {
+    double tolerance = frontier->tolerance * (double)(1ll << SCORE_SHIFT);
+    double anchor = (double)curve[0];
+    int anchorWater = 0;
+    double low = -1e300, high = 1e300;
+    int count = 0;
+
+    frontier->points[count].water = 0;
+    frontier->points[count].objective = frontierObjective(curve[0]);
+    count++;
+    for (int w = 1; w <= totalWater; w++) {
+        double run = (double)(w - anchorWater);
+        double pointLow = ((double)curve[w] - tolerance - anchor) / run;
+        double pointHigh = ((double)curve[w] + tolerance - anchor) / run;
+        if ((pointLow > low ? pointLow : low) > (pointHigh < high ? pointHigh : high)) {
+            double slope = (low + high) / 2;
+            anchor += slope * (double)(w - 1 - anchorWater);
+            anchorWater = w - 1;
+            frontier->points[count].water = anchorWater;
+            frontier->points[count].objective = anchor / (double)(1ll << SCORE_SHIFT);
+            count++;
+            pointLow = (double)curve[w] - tolerance - anchor;
+            pointHigh = (double)curve[w] + tolerance - anchor;
+            low = -1e300;
+            high = 1e300;
+        }
+        if (pointLow > low) low = pointLow;
+        if (pointHigh < high) high = pointHigh;
+    }
+    if (anchorWater < totalWater) {
+        // As close to the best score as the last piece allows
+        double slope = ((double)curve[totalWater] - anchor) / (double)(totalWater - anchorWater);
+        if (slope < low) slope = low;
+        if (slope > high) slope = high;
+        anchor += slope * (double)(totalWater - anchorWater);
+        frontier->points[count].water = totalWater;
+        frontier->points[count].objective = anchor / (double)(1ll << SCORE_SHIFT);
+        count++;
+    }
+    frontier->pointCount = count;
+
+    // Measured rather than assumed, so the response states what it delivers
+    double worst = 0;
+    for (int k = 1; k < count; k++) {
+        const FrontierPoint *from = &frontier->points[k - 1];
+        const FrontierPoint *to = &frontier->points[k];
+        double slope = (to->objective - from->objective) / (to->water - from->water);
+        for (int w = from->water; w <= to->water; w++) {
+            double error = from->objective + slope * (w - from->water) -
+                           frontierObjective(curve[w]);
+            if (error < 0) error = -error;
+            if (error > worst) worst = error;
+        }
+    }
+    frontier->maxError = worst;
+}
+
+// Copies a full request, runs the DP once and computes the breakpoints.
+static inline IncrementalResult frontierStart(Frontier *frontier, const char *input,
+                                              size_t length) {
+    IncrementalSession *session = &frontier->session;
+    IrrigationData *data = &session->data;
+    IncrementalResult result = incrementalLoad(session, input, length);
+    if (result != INCREMENTAL_OK) return result;
+
+    uint64_t start = monotonicMicros();
+    size_t rowCount = (size_t)data->totalWater + 1;
+    Score *curve = arenaAlloc(&session->arena, rowCount * sizeof(Score));
+    frontier->bestAt = arenaAlloc(&session->arena, rowCount * sizeof(int));
+    frontier->points = arenaAlloc(&session->arena, (rowCount + 1) * sizeof(FrontierPoint));
+    if (!curve || !frontier->bestAt || !frontier->points || !incrementalPrioritize(session) ||
+        !dpScheduleTables(data, session->order, &frontier->options, &session->arena,
+                          &frontier->dpStats, &frontier->tables)) {
+        return INCREMENTAL_NO_MEMORY;
+    }
+
+    // Best over budgets up to w; the first budget wins ties, as in the DP
+    const Score *last = frontier->tables.last;
+    for (int w = 0; w <= data->totalWater; w++) {
+        if (w > 0 && last[w] <= curve[w - 1]) {
+            curve[w] = curve[w - 1];
+            frontier->bestAt[w] = frontier->bestAt[w - 1];
+        } else {
+            curve[w] = last[w];
+            frontier->bestAt[w] = w;
+        }
+    }
+    if (frontier->tolerance > 0) {
+        frontierMergedPoints(frontier, curve, data->totalWater);
+    } else {
+        frontierExactPoints(frontier, curve, data->totalWater);
+    }
+    frontier->buildMicros = monotonicMicros() - start;
+    session->active = 1;
+    return INCREMENTAL_OK;
+}
+
+// Writes the schedule for a budget of water units into the session's
+// fields. Returns 0 if the budget is outside 0..totalWater.
+static inline int frontierSchedule(Frontier *frontier, int water) {
+    IrrigationData *data = &frontier->session.data;
+    uint64_t start = monotonicMicros();
+
+    if (water < 0 || water > data->totalWater) return 0;
+    incrementalClearSchedule(data);
+    dpBacktrackFrom(data, frontier->session.order, &frontier->tables.log,
+                    frontier->bestAt[water]);
+    data->remainingWater = water - data->totalWaterUsed;
+    frontier->budgetMicros = monotonicMicros() - start;
+    return 1;
+}
+
+// Reads N from {"command":"budget","water":N}.
+static inline int parseBudgetCommand(const char *input, size_t length, int *water) {
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+    int found = 0;
+
+    jsonInit(&json, input, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        int ok;
+        if (jsonSliceEquals(key, "water")) {
+            ok = jsonInt(&json, water);
+            found = 1;
+        } else {
+            ok = jsonSkipValue(&json);
+        }
+        if (!ok) return 0;
+    }
+    return found && !json.error;
+}
+
+// The breakpoints as [water, objective] pairs, objective to four places.
+static inline int emitFrontier(FILE *out, const Frontier *frontier, const char *algorithm,
+                               int compact) {
+    const IrrigationData *data = &frontier->session.data;
+    OutputLayout o = outputLayout(compact);
+    OutputBuffer buffer;
+    uint64_t start = phaseBegin();
+    int ok;
+
+    outputInit(&buffer);
+    if (!outputReserve(&buffer, 256 + (size_t)frontier->pointCount * 32)) return 0;
+    outputText(&buffer, "{");
+    outputText(&buffer, o.newline);
+    outputText(&buffer, o.indent1);
+    outputText(&buffer, "\"algorithm\":");
+    outputText(&buffer, o.space);
+    outputText(&buffer, "\"");
+    outputText(&buffer, algorithm);
+    outputText(&buffer, "\",");
+    outputText(&buffer, o.newline);
+    outputIntMember(&buffer, &o, o.indent1, "\"totalWater\":", data->totalWater, 1);
+    outputText(&buffer, o.newline);
+    outputIntMember(&buffer, &o, o.indent1, "\"bestWater\":",
+                    frontier->bestAt[data->totalWater], 1);
+    outputText(&buffer, o.newline);
+    outputText(&buffer, o.indent1);
+    outputText(&buffer, "\"bestObjective\":");
+    outputText(&buffer, o.space);
+    outputFixed(&buffer, frontierObjective(frontier->dpStats.bestScore), 4);
+    outputText(&buffer, ",");
+    outputText(&buffer, o.newline);
+    outputText(&buffer, o.indent1);
+    outputText(&buffer, "\"maxError\":");
+    outputText(&buffer, o.space);
+    outputFixed(&buffer, frontier->maxError, 4);
+    outputText(&buffer, ",");
+    outputText(&buffer, o.newline);
+    outputText(&buffer, o.indent1);
+    outputText(&buffer, "\"breakpoints\":");
+    outputText(&buffer, o.space);
+    outputText(&buffer, "[");
+    outputText(&buffer, o.newline);
+    for (int k = 0; k < frontier->pointCount; k++) {
+        outputText(&buffer, o.indent2);
+        outputText(&buffer, "[");
+        outputInt(&buffer, frontier->points[k].water);
+        outputText(&buffer, ",");
+        outputFixed(&buffer, frontier->points[k].objective, 4);
+        outputText(&buffer, k + 1 < frontier->pointCount ? "]," : "]");
+        outputText(&buffer, o.newline);
+    }
+    outputText(&buffer, o.indent1);
+    outputText(&buffer, "]");
+    outputText(&buffer, o.newline);
+    outputText(&buffer, "}\n");
+    ok = outputFlush(&buffer, out);
+    outputFree(&buffer);
+    phaseEnd(PHASE_OUTPUT, start);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef SMARTFARM_GREEDY_H
+#define SMARTFARM_GREEDY_H
+
+#include <stdlib.h>
+
+#include "arena.h"
+#include "farm.h"
+#include "profile.h"
+
+// Time constraints apply only when both electricity and a delivery rate are
+// given; otherwise the greedy pass runs on water alone with these defaults.
+static inline void greedyApplyDefaults(IrrigationData *data) {
+    data->useTimeConstraints = (data->totalElectricity > 0 && data->waterDeliveryRate > 0);
+    if (!data->useTimeConstraints) {
+        data->totalElectricity = 1000;
+        data->waterDeliveryRate = 50;
+    }
+}
+
+static inline void greedyFieldTime(const IrrigationData *data, Field *field) {
+    field->timeNeeded = (field->waterNeeded + data->waterDeliveryRate - 1) / data->waterDeliveryRate;
+    if (field->timeNeeded <= 0) {
+        field->timeNeeded = 1;
+    }
+}
+
+static inline void greedyFieldTimes(IrrigationData *data) {
+    if (!data) return;
+    
+    if (data->waterDeliveryRate <= 0) {
+        data->waterDeliveryRate = 50;
+    }
+    
+    for (int i = 0; i < data->fieldCount; i++) {
+        greedyFieldTime(data, &data->fields[i]);
+    }
+}
+
+// Allocates to the next field in priority order. Returns 0 once the water
+// has run out and the pass stops.
+static inline int greedyScheduleField(IrrigationData *data, Field *field) {
+    if (data->useTimeConstraints) {
+        int minWater = field->waterNeeded / 10;
+        int minTime = (minWater + data->waterDeliveryRate - 1) / data->waterDeliveryRate;
+        
+        if (data->remainingWater >= minWater && data->remainingElectricity >= minTime) {
+            int waterToAllocate = field->waterNeeded;
+            int timeToAllocate = field->timeNeeded;
+            
+            if (waterToAllocate > data->remainingWater) {
+                waterToAllocate = data->remainingWater;
+                timeToAllocate = (waterToAllocate + data->waterDeliveryRate - 1) / data->waterDeliveryRate;
+            }
+            
+            if (timeToAllocate > data->remainingElectricity) {
+                timeToAllocate = data->remainingElectricity;
+                waterToAllocate = timeToAllocate * data->waterDeliveryRate;
+                if (waterToAllocate > field->waterNeeded) {
+                    waterToAllocate = field->waterNeeded;
+                }
+            }
+            
+            field->allocated = waterToAllocate;
+            field->scheduled = 1;
+            data->remainingWater -= waterToAllocate;
+            data->remainingElectricity -= timeToAllocate;
+            data->totalWaterUsed += waterToAllocate;
+            data->totalTimeUsed += timeToAllocate;
+        }
+    } else {
+        if (data->remainingWater >= field->waterNeeded) {
+            field->allocated = field->waterNeeded;
+            field->scheduled = 1;
+            data->remainingWater -= field->waterNeeded;
+            data->totalWaterUsed += field->waterNeeded;
+        } else if (data->remainingWater > 0) {
+            int minAllocation = field->waterNeeded / 10;
+            if (data->remainingWater >= minAllocation) {
+                field->allocated = data->remainingWater;
+                field->scheduled = 1;
+                data->totalWaterUsed += data->remainingWater;
+                data->remainingWater = 0;
+            }
+            return 0;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Greedy pass over the fields in the given priority order (from
+// prioritizeFields).
+static inline void greedyScheduleOrdered(IrrigationData *data, const int *order) {
+    if (!data || data->fieldCount <= 0 || data->totalWater < 0) {
+        return;
+    }
+    
+    if (data->useTimeConstraints) {
+        greedyFieldTimes(data);
+    }
+    
+    data->remainingWater = data->totalWater;
+    data->remainingElectricity = data->totalElectricity;
+    data->totalWaterUsed = 0;
+    data->totalTimeUsed = 0;
+    
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+    
+    uint64_t start = phaseBegin();
+    int visited = 0;
+    int scheduled = 0;
+    for (int k = 0; k < data->fieldCount; k++) {
+        Field *field = &data->fields[order[k]];
+        int more = greedyScheduleField(data, field);
+        visited++;
+        scheduled += field->scheduled;
+        if (!more) break;
+    }
+    phaseEnd(PHASE_FILL, start);
+    profileCount((uint64_t)visited, (uint64_t)scheduled);
+}
+
+// Schedules in priority order and returns that order, which is also the
+// output order; the fields stay where they are. Returns NULL if the order
+// does not fit in memory.
+static inline const int *greedySchedule(IrrigationData *data, Arena *arena) {
+    const int *order = prioritizeFields(data, arena);
+    if (order) greedyScheduleOrdered(data, order);
+    return order;
+}
+
+#endif
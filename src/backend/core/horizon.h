@@ -0,0 +1,569 @@
+#ifndef SMARTFARM_HORIZON_H
+#define SMARTFARM_HORIZON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "emit.h"
+#include "farm.h"
+#include "incremental.h"
+#include "json.h"
+#include "latency.h"
+#include "score.h"
+
+// Rolling-horizon planning. A full request with "horizonDays" plans that
+// many days ahead against a seasonal allocation: "seasonWater" units are
+// left for the next "seasonDays" days, and totalWater is what can be
+// delivered in one day. Each field dries by "dryingRate" moisture points a
+// day (per field or for the whole request) and gains one point for every
+// waterNeeded / (100 - moisture) units it is given, the rate its request
+// implies, up to 100. Day d is planned from the moisture the days before it
+// leave, with its need scaled to match.
+//
+// Every day of the window keeps an incremental DP session (incremental.h).
+// A pass runs the days in order, each on its budget, then splits the
+// window's share of the season between the days by the upper concave hull
+// of their value-versus-water curves, steepest pieces first; passes repeat
+// until the split settles or stops paying. {"command":"advance"} commits
+// day 0, optionally with observed readings for the new day 0 in the update
+// command's "fields" format, and slides the window: every day keeps its
+// tables and only the fields whose predicted readings moved are
+// recomputed, and the day that falls off is reused as the new last day.
+
+#define HORIZON_MAX_DAYS     31
+#define HORIZON_DEFAULT_DAYS 7
+#define HORIZON_DEFAULT_DRYING 3   // moisture points a field loses a day
+#define HORIZON_PASSES       3     // forward passes per plan, at most
+#define HORIZON_MAX_NEED     1000000000
+
+typedef struct {
+    int passes;
+    int64_t rowsRun;        // DP rows the last plan recomputed
+    int64_t rowCount;       // what rebuilding every day on every pass runs
+    uint64_t planMicros;
+} HorizonStats;
+
+typedef struct {
+    int water;
+    Score score;
+} HorizonVertex;
+
+typedef struct {
+    IncrementalDP slots[HORIZON_MAX_DAYS];  // day d lives in slot (first + d) % days
+    Arena arena;                            // the per-field model and the plan
+    size_t rowBudget;                       // split evenly between the days
+    int days;                               // horizonDays
+    int window;                             // days planned: days, or fewer at season end
+    int first;
+    int day;                                // days advanced since the request
+    int fieldCount;
+    int dailyWater;
+    int seasonWater;                        // left for the rest of the season
+    int seasonDays;
+    double *cost;                           // water per moisture point
+    double *drying;
+    double *predicted;                      // predicted[d * fieldCount + i], d = 0..window
+    int *todayMoisture;
+    int *todayNeed;
+    int *budget;
+    int *used;
+    Score *score;
+    Score *curve;
+    HorizonVertex *hull;                    // hull[d * (dailyWater + 1) + k]
+    int *hullCount;
+    FieldUpdate *updates;
+    int active;
+    HorizonStats stats;
+} Horizon;
+
+static inline void horizonInit(Horizon *horizon, const DPOptions *options, size_t rowBudget) {
+    memset(horizon, 0, sizeof(*horizon));
+    arenaInit(&horizon->arena);
+    for (int d = 0; d < HORIZON_MAX_DAYS; d++) {
+        incrementalDPInit(&horizon->slots[d], options, rowBudget);
+    }
+    horizon->rowBudget = rowBudget;
+}
+
+static inline void horizonRelease(Horizon *horizon) {
+    for (int d = 0; d < HORIZON_MAX_DAYS; d++) incrementalDPRelease(&horizon->slots[d]);
+    arenaRelease(&horizon->arena);
+    memset(horizon, 0, sizeof(*horizon));
+}
+
+static inline IncrementalDP *horizonSlot(Horizon *horizon, int day) {
+    return &horizon->slots[(horizon->first + day) % horizon->days];
+}
+
+static inline double horizonObjective(Score score) {
+    return (double)score / (double)(1ll << SCORE_SHIFT);
+}
+
+static inline int horizonRound(double moisture) {
+    return (int)(moisture + 0.5);
+}
+
+static inline double horizonCost(int moisture, int waterNeeded) {
+    return (double)waterNeeded / (moisture < 100 ? 100 - moisture : 1);
+}
+
+// What a field at this moisture needs to reach 100, rounded up.
+static inline int horizonNeed(double cost, int moisture) {
+    double need = cost * (100 - moisture);
+    if (need >= HORIZON_MAX_NEED) return HORIZON_MAX_NEED;
+    int whole = (int)need;
+    return need - whole > 1e-9 ? whole + 1 : whole;
+}
+
+// Reads the horizon members of a full request. fieldDrying[i] is left at -1
+// for fields without their own dryingRate; fields are counted as farm.h
+// counts them, named objects only.
+static inline int parseHorizonRequest(const char *input, size_t length, int fieldCount,
+                                      int *days, int *seasonWater, int *seasonDays,
+                                      int *drying, int *fieldDrying) {
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+
+    *days = HORIZON_DEFAULT_DAYS;
+    *seasonWater = -1;
+    *seasonDays = -1;
+    *drying = HORIZON_DEFAULT_DRYING;
+    for (int i = 0; i < fieldCount; i++) fieldDrying[i] = -1;
+
+    jsonInit(&json, input, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        int ok;
+        if (jsonSliceEquals(key, "horizonDays")) {
+            ok = parseIntMember(&json, days);
+        } else if (jsonSliceEquals(key, "seasonWater")) {
+            ok = parseIntMember(&json, seasonWater);
+        } else if (jsonSliceEquals(key, "seasonDays")) {
+            ok = parseIntMember(&json, seasonDays);
+        } else if (jsonSliceEquals(key, "dryingRate")) {
+            ok = parseIntMember(&json, drying);
+        } else if (jsonSliceEquals(key, "fields") && jsonPeek(&json) == '[') {
+            int firstElement = 1;
+            int index = 0;
+            json.cur++;
+            while (jsonNextElement(&json, &firstElement)) {
+                int firstKey = 1, named = 0, rate = -1;
+                if (jsonPeek(&json) != '{') {
+                    if (!jsonSkipValue(&json)) return 0;
+                    continue;
+                }
+                json.cur++;
+                while (jsonNextKey(&json, &firstKey, &key)) {
+                    int fieldOk;
+                    if (jsonSliceEquals(key, "name") && jsonPeek(&json) == '"') {
+                        JsonSlice name;
+                        fieldOk = jsonString(&json, &name);
+                        named = 1;
+                    } else if (jsonSliceEquals(key, "dryingRate") && jsonPeek(&json) != 'n') {
+                        fieldOk = jsonInt(&json, &rate);
+                        if (fieldOk && (rate < 0 || rate > 100)) {
+                            fprintf(stderr, "Error: Drying rate must be between 0 and 100\n");
+                            return 0;
+                        }
+                    } else {
+                        fieldOk = jsonSkipValue(&json);
+                    }
+                    if (!fieldOk) return 0;
+                }
+                if (named) {
+                    if (index < fieldCount) fieldDrying[index] = rate;
+                    index++;
+                }
+            }
+            ok = !json.error;
+        } else {
+            ok = jsonSkipValue(&json);
+        }
+        if (!ok) return 0;
+    }
+    if (json.error) return 0;
+
+    if (*days < 1 || *days > HORIZON_MAX_DAYS) {
+        fprintf(stderr, "Error: Horizon days must be between 1 and %d\n", HORIZON_MAX_DAYS);
+        return 0;
+    }
+    if (*drying < 0 || *drying > 100) {
+        fprintf(stderr, "Error: Drying rate must be between 0 and 100\n");
+        return 0;
+    }
+    if (*seasonDays == -1) *seasonDays = *days;
+    if (*seasonDays < 1) {
+        fprintf(stderr, "Error: Season days must be at least 1\n");
+        return 0;
+    }
+    if (*seasonWater < -1) {
+        fprintf(stderr, "Error: Season water must not be negative\n");
+        return 0;
+    }
+    return 1;
+}
+
+// The window's share of what is left of the season, at most what can be
+// delivered.
+static inline int64_t horizonWindowWater(const Horizon *horizon) {
+    int64_t share = (int64_t)horizon->seasonWater * horizon->window / horizon->seasonDays;
+    int64_t deliverable = (int64_t)horizon->dailyWater * horizon->window;
+    return share < deliverable ? share : deliverable;
+}
+
+static inline int horizonPace(const Horizon *horizon) {
+    int64_t pace = horizonWindowWater(horizon) / horizon->window;
+    return (int)(pace < horizon->dailyWater ? pace : horizon->dailyWater);
+}
+
+// Upper concave hull of the best score over budgets up to w.
+static inline void horizonHull(Horizon *horizon, int day, const Score *last) {
+    int water = horizon->dailyWater;
+    Score *curve = horizon->curve;
+    HorizonVertex *hull = horizon->hull + (size_t)day * ((size_t)water + 1);
+    int count = 0;
+
+    for (int w = 0; w <= water; w++) {
+        curve[w] = w > 0 && last[w] <= curve[w - 1] ? curve[w - 1] : last[w];
+        if (w > 0 && curve[w] == curve[w - 1]) continue;
+        while (count >= 2) {
+            const HorizonVertex *a = &hull[count - 2];
+            const HorizonVertex *b = &hull[count - 1];
+            double cross = (double)(b->water - a->water) * (double)(curve[w] - a->score) -
+                           (double)(b->score - a->score) * (double)(w - a->water);
+            if (cross < 0) break;
+            count--;
+        }
+        hull[count].water = w;
+        hull[count].score = curve[w];
+        count++;
+    }
+    horizon->hullCount[day] = count;
+}
+
+// Plans every day of the window on its current budget, from today's
+// readings forward. Returns 0 if a day's tables could not be built.
+static inline int horizonForward(Horizon *horizon, Arena *arena) {
+    int count = horizon->fieldCount;
+
+    for (int d = 0; d < horizon->window; d++) {
+        IncrementalDP *slot = horizonSlot(horizon, d);
+        IrrigationData *data = &slot->session.data;
+        const double *moisture = horizon->predicted + (size_t)d * count;
+        double *next = horizon->predicted + (size_t)(d + 1) * count;
+        int changed = 0;
+
+        for (int i = 0; i < count; i++) {
+            Field *field = &data->fields[i];
+            int level = d == 0 ? horizon->todayMoisture[i] : horizonRound(moisture[i]);
+            int need = d == 0 ? horizon->todayNeed[i] : horizonNeed(horizon->cost[i], level);
+            if (!slot->session.active) {
+                field->moisture = level;
+                field->waterNeeded = need;
+            } else if (field->moisture != level || field->waterNeeded != need) {
+                horizon->updates[changed].index = i;
+                horizon->updates[changed].moisture = level;
+                horizon->updates[changed].waterNeeded = need;
+                changed++;
+            }
+        }
+        if (!slot->session.active) {
+            if (incrementalDPBuild(slot) != INCREMENTAL_OK) return 0;
+        } else if (incrementalDPUpdate(slot, horizon->updates, changed, arena) != INCREMENTAL_OK) {
+            return 0;
+        }
+        horizon->stats.rowsRun += slot->session.stats.rowsRun;
+        horizon->stats.rowCount += count;
+
+        // The best budget within the day's share; the first wins ties
+        const Score *last = slot->last;
+        int best = 0;
+        for (int w = 1; w <= horizon->budget[d]; w++) {
+            if (last[w] > last[best]) best = w;
+        }
+        incrementalClearSchedule(data);
+        dpBacktrackFrom(data, slot->session.order, &slot->engine.log, best);
+        data->remainingWater = horizon->budget[d] - best;
+        horizon->used[d] = best;
+        horizon->score[d] = last[best];
+        horizonHull(horizon, d, last);
+
+        for (int i = 0; i < count; i++) {
+            const Field *field = &data->fields[i];
+            double level = moisture[i];
+            if (field->scheduled && horizon->cost[i] > 0) {
+                level += field->allocated / horizon->cost[i];
+            }
+            if (level > 100) level = 100;
+            level -= horizon->drying[i];
+            next[i] = level > 0 ? level : 0;
+        }
+    }
+    return 1;
+}
+
+// Water-fills the window's water over the days' hull pieces, steepest
+// first; earlier days win ties. Water no piece pays for goes back to the
+// days in order, up to what each can deliver, so a day's budget is still
+// its share. Returns 1 if any budget moved.
+static inline int horizonSplit(Horizon *horizon) {
+    int64_t remaining = horizonWindowWater(horizon);
+    int position[HORIZON_MAX_DAYS] = {0};
+    int budget[HORIZON_MAX_DAYS] = {0};
+    size_t stride = (size_t)horizon->dailyWater + 1;
+    int moved = 0;
+
+    while (remaining > 0) {
+        int pick = -1;
+        double steepest = 0;
+        for (int d = 0; d < horizon->window; d++) {
+            if (position[d] + 1 >= horizon->hullCount[d]) continue;
+            const HorizonVertex *from = &horizon->hull[d * stride + position[d]];
+            double slope = (double)(from[1].score - from->score) / (from[1].water - from->water);
+            if (slope > steepest) {
+                steepest = slope;
+                pick = d;
+            }
+        }
+        if (pick < 0) break;
+
+        const HorizonVertex *from = &horizon->hull[pick * stride + position[pick]];
+        int piece = from[1].water - from->water;
+        if (piece <= remaining) {
+            budget[pick] = from[1].water;
+            position[pick]++;
+            remaining -= piece;
+        } else {
+            budget[pick] = from->water + (int)remaining;
+            remaining = 0;
+        }
+    }
+    for (int d = 0; d < horizon->window && remaining > 0; d++) {
+        int room = horizon->dailyWater - budget[d];
+        int give = room < remaining ? room : (int)remaining;
+        budget[d] += give;
+        remaining -= give;
+    }
+
+    for (int d = 0; d < horizon->window; d++) {
+        if (horizon->budget[d] != budget[d]) moved = 1;
+        horizon->budget[d] = budget[d];
+    }
+    return moved;
+}
+
+// Scales budgets carried over from the last window down to this window's
+// share, so no plan kept from them can spend more than the season allows.
+// Rounding leftovers go to the days in order.
+static inline void horizonFitBudgets(Horizon *horizon) {
+    int64_t share = horizonWindowWater(horizon);
+    int64_t total = 0, given = 0;
+
+    for (int d = 0; d < horizon->window; d++) total += horizon->budget[d];
+    if (total <= share) return;
+    for (int d = 0; d < horizon->window; d++) {
+        horizon->budget[d] = (int)(horizon->budget[d] * share / total);
+        given += horizon->budget[d];
+    }
+    for (int d = 0; d < horizon->window && given < share; d++) {
+        if (horizon->budget[d] < horizon->dailyWater) {
+            horizon->budget[d]++;
+            given++;
+        }
+    }
+}
+
+// The days interact through the moisture they leave, which the split does
+// not see, so a split can plan worse than the one before it; the best
+// window total found is the one kept.
+static inline IncrementalResult horizonPlan(Horizon *horizon, Arena *arena) {
+    uint64_t start = monotonicMicros();
+    int bestBudget[HORIZON_MAX_DAYS];
+    Score bestTotal = -1;
+
+    memset(&horizon->stats, 0, sizeof(horizon->stats));
+    for (;;) {
+        Score total = 0;
+        horizon->stats.passes++;
+        if (!horizonForward(horizon, arena)) {
+            horizon->active = 0;
+            return INCREMENTAL_NO_MEMORY;
+        }
+        for (int d = 0; d < horizon->window; d++) total += horizon->score[d];
+        if (total < bestTotal) {
+            memcpy(horizon->budget, bestBudget, (size_t)horizon->window * sizeof(int));
+            horizon->stats.passes++;
+            if (!horizonForward(horizon, arena)) {
+                horizon->active = 0;
+                return INCREMENTAL_NO_MEMORY;
+            }
+            break;
+        }
+        bestTotal = total;
+        memcpy(bestBudget, horizon->budget, (size_t)horizon->window * sizeof(int));
+        if (horizon->stats.passes >= HORIZON_PASSES || !horizonSplit(horizon)) break;
+    }
+    horizon->stats.planMicros = monotonicMicros() - start;
+    horizon->active = 1;
+    return INCREMENTAL_OK;
+}
+
+// Copies a full request into every day and plans the window.
+static inline IncrementalResult horizonStart(Horizon *horizon, const char *input, size_t length,
+                                             Arena *arena) {
+    IncrementalDP *today = &horizon->slots[0];
+    const IrrigationData *data = &today->session.data;
+    int seasonWater, drying;
+    int *fieldDrying;
+
+    horizon->active = 0;
+    for (int d = 0; d < HORIZON_MAX_DAYS; d++) horizon->slots[d].session.active = 0;
+    arenaReset(&horizon->arena);
+    profileArena(&horizon->arena);
+    IncrementalResult result = incrementalLoad(&today->session, input, length);
+    if (result != INCREMENTAL_OK) return result;
+
+    int count = data->fieldCount;
+    fieldDrying = arenaAlloc(arena, (size_t)count * sizeof(int));
+    if (!fieldDrying) return INCREMENTAL_NO_MEMORY;
+    if (!parseHorizonRequest(input, length, count, &horizon->days, &seasonWater,
+                             &horizon->seasonDays, &drying, fieldDrying)) {
+        return INCREMENTAL_INVALID;
+    }
+    for (int d = 1; d < horizon->days; d++) {
+        result = incrementalLoad(&horizon->slots[d].session, input, length);
+        if (result != INCREMENTAL_OK) return result;
+    }
+    for (int d = 0; d < horizon->days; d++) {
+        horizon->slots[d].rowBudget = horizon->rowBudget / (size_t)horizon->days;
+    }
+
+    size_t days = (size_t)horizon->days;
+    size_t stride = (size_t)data->totalWater + 1;
+    horizon->fieldCount = count;
+    horizon->dailyWater = data->totalWater;
+    if (seasonWater < 0) {
+        // No seasonal limit: every day may use all it can deliver
+        int64_t season = (int64_t)data->totalWater * horizon->seasonDays;
+        seasonWater = season < 2147483647 ? (int)season : 2147483647;
+    }
+    horizon->seasonWater = seasonWater;
+    horizon->window = horizon->days < horizon->seasonDays ? horizon->days : horizon->seasonDays;
+    horizon->first = 0;
+    horizon->day = 0;
+    horizon->cost = arenaAlloc(&horizon->arena, (size_t)count * sizeof(double));
+    horizon->drying = arenaAlloc(&horizon->arena, (size_t)count * sizeof(double));
+    horizon->predicted = arenaAlloc(&horizon->arena, (days + 1) * count * sizeof(double));
+    horizon->todayMoisture = arenaAlloc(&horizon->arena, (size_t)count * sizeof(int));
+    horizon->todayNeed = arenaAlloc(&horizon->arena, (size_t)count * sizeof(int));
+    horizon->budget = arenaAlloc(&horizon->arena, days * sizeof(int));
+    horizon->used = arenaAlloc(&horizon->arena, days * sizeof(int));
+    horizon->score = arenaAlloc(&horizon->arena, days * sizeof(Score));
+    horizon->curve = arenaAlloc(&horizon->arena, stride * sizeof(Score));
+    horizon->hull = arenaAlloc(&horizon->arena, days * stride * sizeof(HorizonVertex));
+    horizon->hullCount = arenaAlloc(&horizon->arena, days * sizeof(int));
+    horizon->updates = arenaAlloc(&horizon->arena, (size_t)count * sizeof(FieldUpdate));
+    if (!horizon->cost || !horizon->drying || !horizon->predicted || !horizon->todayMoisture ||
+        !horizon->todayNeed || !horizon->budget || !horizon->used || !horizon->score ||
+        !horizon->curve || !horizon->hull || !horizon->hullCount || !horizon->updates) {
+        return INCREMENTAL_NO_MEMORY;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const Field *field = &data->fields[i];
+        horizon->todayMoisture[i] = field->moisture;
+        horizon->todayNeed[i] = field->waterNeeded;
+        horizon->predicted[i] = field->moisture;
+        horizon->cost[i] = horizonCost(field->moisture, field->waterNeeded);
+        horizon->drying[i] = fieldDrying[i] >= 0 ? fieldDrying[i] : drying;
+    }
+
+    // An even split to start from; the passes move it
+    int64_t water = horizonWindowWater(horizon);
+    for (int d = 0; d < horizon->window; d++) {
+        int64_t share = water / horizon->window + (d < water % horizon->window);
+        horizon->budget[d] = (int)(share < horizon->dailyWater ? share : horizon->dailyWater);
+    }
+    return horizonPlan(horizon, arena);
+}
+
+// Commits day 0 and replans from the next day, with the readings given
+// replacing its predicted ones. The caller checks the season has a day
+// left.
+static inline IncrementalResult horizonAdvance(Horizon *horizon, const FieldUpdate *readings,
+                                               int readingCount, Arena *arena) {
+    int count = horizon->fieldCount;
+
+    horizon->seasonWater -= horizon->used[0];
+    if (horizon->seasonWater < 0) horizon->seasonWater = 0;
+    horizon->seasonDays--;
+    horizon->day++;
+
+    memmove(horizon->predicted, horizon->predicted + count, (size_t)count * sizeof(double));
+    for (int i = 0; i < count; i++) {
+        horizon->todayMoisture[i] = horizonRound(horizon->predicted[i]);
+        horizon->todayNeed[i] = horizonNeed(horizon->cost[i], horizon->todayMoisture[i]);
+    }
+    for (int r = 0; r < readingCount; r++) {
+        const FieldUpdate *reading = &readings[r];
+        int i = reading->index;
+        if (reading->moisture >= 0) {
+            horizon->todayMoisture[i] = reading->moisture;
+            horizon->predicted[i] = reading->moisture;
+            horizon->todayNeed[i] = horizonNeed(horizon->cost[i], reading->moisture);
+        }
+        if (reading->waterNeeded >= 0) {
+            horizon->todayNeed[i] = reading->waterNeeded;
+            horizon->cost[i] = horizonCost(horizon->todayMoisture[i], reading->waterNeeded);
+        }
+    }
+
+    // The old day 0 comes back as the last day; the rest keep their tables
+    int pace = horizonPace(horizon);
+    horizon->first = (horizon->first + 1) % horizon->days;
+    memmove(horizon->budget, horizon->budget + 1, (size_t)(horizon->days - 1) * sizeof(int));
+    horizon->budget[horizon->days - 1] = pace;
+    horizon->window = horizon->days < horizon->seasonDays ? horizon->days : horizon->seasonDays;
+    horizonFitBudgets(horizon);
+    return horizonPlan(horizon, arena);
+}
+
+// The window's schedules in day order, day 0 first. Each day lists the
+// predicted moisture and need it was planned on; its budget is
+// totalWaterUsed + remainingWater.
+static inline int emitHorizon(FILE *out, const Horizon *horizon, int compact) {
+    const char *newline = compact ? "" : "\n";
+    OutputBuffer buffer;
+    uint64_t start = phaseBegin();
+    int ok;
+
+    outputInit(&buffer);
+    outputText(&buffer, "[");
+    outputText(&buffer, newline);
+    for (int d = 0; d < horizon->window; d++) {
+        const IncrementalDP *slot = &horizon->slots[(horizon->first + d) % horizon->days];
+        ScheduleMetrics metrics;
+        if (d > 0) {
+            outputText(&buffer, ",");
+            outputText(&buffer, newline);
+        }
+        metrics.objective = horizonObjective(horizon->score[d]);
+        metrics.wallMs = horizon->stats.planMicros / 1000.0;
+        metrics.optimal = -1;
+        emitScheduleObject(&buffer, &slot->session.data, NULL, "DynamicProgrammingHorizon", 0,
+                           compact, &metrics);
+    }
+    outputText(&buffer, newline);
+    outputText(&buffer, "]\n");
+    ok = outputFlush(&buffer, out);
+    outputFree(&buffer);
+    phaseEnd(PHASE_OUTPUT, start);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,604 @@
+#ifndef SMARTFARM_INCREMENTAL_H
+#define SMARTFARM_INCREMENTAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "farm.h"
+#include "greedy.h"
+#include "json.h"
+#include "latency.h"
+
+// Incremental rescheduling for a serving worker. A full request starts a
+// session: the request is copied into memory the session owns and scheduled
+// once. {"command":"update","fields":[{"index":3,"moisture":41}]} then
+// changes the moisture or waterNeeded of some fields (picked by "index",
+// their position in the request, or by "name") and redoes only the part of
+// the schedule those changes reach.
+//
+// DP: the table rows stay resident (every rowInterval-th one when the whole
+// table does not fit the row budget) and each updated field moves to the end
+// of the processing order. An update recomputes the rows from the field's
+// old position, rounded down to a kept row, so fields that change often
+// settle at the end and cost a few rows each. The score is always the
+// optimum; among schedules with the same score the one picked can differ
+// from a fresh run, which processes the fields in priority order.
+//
+// Greedy: the schedule depends on the priority order, so an updated field
+// moves to its new place in that order and the pass resumes from the earlier
+// of its old and new positions with the water and electricity left there.
+// The schedule is the same as a fresh run.
+
+// Kept DP rows may take this much memory before rows are thinned out.
+#define INCREMENTAL_DEFAULT_ROW_BUDGET ((size_t)256 << 20)
+
+typedef enum {
+    INCREMENTAL_OK,
+    INCREMENTAL_INVALID,
+    INCREMENTAL_NO_MEMORY
+} IncrementalResult;
+
+// One field's new readings; -1 keeps the current value.
+typedef struct {
+    int index;
+    int moisture;
+    int waterNeeded;
+} FieldUpdate;
+
+typedef struct {
+    int fieldsChanged;
+    int rowsRun;            // DP rows or greedy positions the last run went through
+    int rowCount;           // what a full run goes through
+    int rowInterval;        // DP: rows kept between updates, every rowInterval-th
+    uint64_t updateMicros;
+    uint64_t fullMicros;    // the full run that started the session
+} IncrementalStats;
+
+typedef struct {
+    Arena arena;            // the copied request and everything sized by it
+    IrrigationData data;
+    int *order;             // processing order (DP) or priority order (greedy)
+    int *position;          // position[i]: where field i sits in order
+    int active;
+    IncrementalStats stats;
+} IncrementalSession;
+
+static inline void incrementalSessionInit(IncrementalSession *session) {
+    memset(session, 0, sizeof(*session));
+    arenaInit(&session->arena);
+}
+
+// Copies and parses a full request and puts its fields in priority order.
+// The previous session, if any, is dropped.
+static inline IncrementalResult incrementalLoad(IncrementalSession *session,
+                                                const char *input, size_t length) {
+    char *copy;
+
+    session->active = 0;
+    arenaReset(&session->arena);
+    profileArena(&session->arena);
+    copy = arenaAlloc(&session->arena, length + 1);
+    if (!copy) return INCREMENTAL_NO_MEMORY;
+    memcpy(copy, input, length);
+    copy[length] = '\0';
+    if (!parseIrrigationInput(copy, length, &session->data, &session->arena)) {
+        return INCREMENTAL_INVALID;
+    }
+    memset(&session->stats, 0, sizeof(session->stats));
+    return INCREMENTAL_OK;
+}
+
+static inline int incrementalPrioritize(IncrementalSession *session) {
+    int count = session->data.fieldCount;
+
+    session->order = prioritizeFields(&session->data, &session->arena);
+    session->position = arenaAlloc(&session->arena, ((size_t)count + 1) * sizeof(int));
+    if (!session->order || !session->position) return 0;
+    for (int k = 0; k < count; k++) session->position[session->order[k]] = k;
+    return 1;
+}
+
+static inline void incrementalClearSchedule(IrrigationData *data) {
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+}
+
+static inline int parseFieldUpdate(JsonCursor *json, const IrrigationData *data,
+                                   FieldUpdate *update) {
+    JsonSlice key;
+    JsonSlice name = {NULL, 0};
+    int first = 1;
+    int named = 0, hasMoisture = 0, hasNeed = 0;
+    int moisture = 0, waterNeeded = 0;
+
+    update->index = -1;
+    if (!jsonConsume(json, '{')) return 0;
+    while (jsonNextKey(json, &first, &key)) {
+        int ok;
+        if (jsonSliceEquals(key, "index")) {
+            ok = jsonInt(json, &update->index);
+        } else if (jsonSliceEquals(key, "name") && jsonPeek(json) == '"') {
+            ok = jsonString(json, &name);
+            named = 1;
+        } else if (jsonSliceEquals(key, "moisture")) {
+            ok = jsonInt(json, &moisture);
+            hasMoisture = 1;
+        } else if (jsonSliceEquals(key, "waterNeeded")) {
+            ok = jsonInt(json, &waterNeeded);
+            hasNeed = 1;
+        } else {
+            ok = jsonSkipValue(json);
+        }
+        if (!ok) return 0;
+    }
+    if (json->error) return 0;
+
+    if (update->index < 0 && named) {
+        for (int i = 0; i < data->fieldCount; i++) {
+            const Field *field = &data->fields[i];
+            if (field->nameLength == name.length &&
+                memcmp(field->name, name.ptr, (size_t)name.length) == 0) {
+                update->index = i;
+                break;
+            }
+        }
+    }
+    if (update->index < 0 || update->index >= data->fieldCount) {
+        fprintf(stderr, "Error: Update names no field of the session\n");
+        return 0;
+    }
+
+    const Field *field = &data->fields[update->index];
+    if (hasMoisture && (moisture < 0 || moisture > 100)) {
+        fprintf(stderr, "Error: Invalid moisture level for field %.*s: %d\n",
+                field->nameLength, field->name, moisture);
+        return 0;
+    }
+    if (hasNeed && waterNeeded < 0) {
+        fprintf(stderr, "Error: Invalid water needed for field %.*s: %d\n",
+                field->nameLength, field->name, waterNeeded);
+        return 0;
+    }
+    update->moisture = hasMoisture ? moisture : -1;
+    update->waterNeeded = hasNeed ? waterNeeded : -1;
+    return 1;
+}
+
+// Reads the "fields" array of an update command into arena memory. Returns
+// 0 (with the reason on stderr) if the command is malformed or names a
+// field the session does not have.
+static inline int parseFieldUpdates(const char *input, size_t length, const IrrigationData *data,
+                                    Arena *arena, FieldUpdate **updates, int *count) {
+    JsonCursor json;
+    JsonSlice key;
+    size_t capacity = 16;
+    int first = 1;
+
+    *count = 0;
+    *updates = arenaAlloc(arena, capacity * sizeof(FieldUpdate));
+    if (!*updates) return 0;
+
+    jsonInit(&json, input, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        if (!jsonSliceEquals(key, "fields")) {
+            if (!jsonSkipValue(&json)) return 0;
+            continue;
+        }
+        int firstElement = 1;
+        if (!jsonConsume(&json, '[')) return 0;
+        while (jsonNextElement(&json, &firstElement)) {
+            if ((size_t)*count == capacity) {
+                FieldUpdate *grown = arenaGrow(arena, *updates, capacity * sizeof(FieldUpdate),
+                                               capacity * 2 * sizeof(FieldUpdate));
+                if (!grown) return 0;
+                *updates = grown;
+                capacity *= 2;
+            }
+            if (!parseFieldUpdate(&json, data, &(*updates)[*count])) return 0;
+            (*count)++;
+        }
+        if (json.error) return 0;
+    }
+    return !json.error;
+}
+
+static inline void incrementalApply(IncrementalSession *session, const FieldUpdate *update) {
+    Field *field = &session->data.fields[update->index];
+    if (update->moisture >= 0) field->moisture = update->moisture;
+    if (update->waterNeeded >= 0) field->waterNeeded = update->waterNeeded;
+}
+
+// One stderr line per session start or update, with the full run to compare
+// against.
+static inline void incrementalReport(FILE *out, const char *algorithm, const char *event,
+                                     const IncrementalSession *session) {
+    const IncrementalStats *stats = &session->stats;
+    uint64_t micros = stats->updateMicros ? stats->updateMicros : 1;
+
+    fprintf(out,
+            "incremental_%s algorithm=%s fields=%d changed=%d rows=%d/%d row_interval=%d "
+            "update_us=%llu full_us=%llu speedup=%.1f\n",
+            event, algorithm, session->data.fieldCount, stats->fieldsChanged, stats->rowsRun,
+            stats->rowCount, stats->rowInterval, (unsigned long long)stats->updateMicros,
+            (unsigned long long)stats->fullMicros, (double)stats->fullMicros / micros);
+}
+
+// DP session: the lean engine's kernels over session.order, one thread.
+typedef struct {
+    IncrementalSession session;
+    DPOptions options;
+    DPEngine engine;
+    DPStats dpStats;
+    size_t rowBudget;
+    Score *rows;            // kept rows: slot s is row s * rowInterval
+    size_t rowStride;       // scores per kept row, whole cache lines
+    int rowInterval;
+    Score *scratch[2];
+    Score *last;            // row fieldCount after the last run
+    size_t logCapacity;     // words allocated for engine.log.words
+    int windowSlots;        // ints allocated for engine.windows
+} IncrementalDP;
+
+static inline void incrementalDPInit(IncrementalDP *dp, const DPOptions *options,
+                                     size_t rowBudget) {
+    memset(dp, 0, sizeof(*dp));
+    incrementalSessionInit(&dp->session);
+    dp->options = *options;
+    dp->options.threads = 1;
+    dp->rowBudget = rowBudget;
+}
+
+static inline void incrementalDPRelease(IncrementalDP *dp) {
+    free(dp->engine.log.words);
+    free(dp->engine.windows);
+    arenaRelease(&dp->session.arena);
+    memset(dp, 0, sizeof(*dp));
+}
+
+// Lays out the choice log rows from start on for the fields now there and
+// clears them; rows before start keep their place and contents.
+static inline int incrementalLayoutLog(IncrementalDP *dp, int start) {
+    const IrrigationData *data = &dp->session.data;
+    ChoiceLog *log = &dp->engine.log;
+    size_t words = start > 0 ? log->rowOffset[start] : 0;
+    size_t first = words;
+
+    for (int i = start; i < data->fieldCount; i++) {
+        log->rowBits[i] = (unsigned char)choiceBitsFor(&data->fields[dp->session.order[i]]);
+        log->rowOffset[i] = words;
+        words += choiceRowWords(log->rowBits[i], data->totalWater);
+    }
+    if (words > dp->logCapacity) {
+        // Headroom so a later change to a larger need rarely reallocates
+        size_t capacity = words + words / 4;
+        uint64_t *grown = realloc(log->words, capacity * sizeof(uint64_t));
+        if (!grown) return 0;
+        profileAlloc((capacity - dp->logCapacity) * sizeof(uint64_t));
+        log->words = grown;
+        dp->logCapacity = capacity;
+    }
+    memset(log->words + first, 0, (words - first) * sizeof(uint64_t));
+    log->totalWords = words;
+    return 1;
+}
+
+static inline int incrementalSizeWindows(IncrementalDP *dp) {
+    int mask = windowMaskFor(&dp->session.data);
+    if (mask + 1 > dp->windowSlots) {
+        int *grown = realloc(dp->engine.windows, ((size_t)mask + 1) * sizeof(int));
+        if (!grown) return 0;
+        profileAlloc(((size_t)mask + 1 - (size_t)dp->windowSlots) * sizeof(int));
+        dp->engine.windows = grown;
+        dp->windowSlots = mask + 1;
+    }
+    dp->engine.windowMask = mask;
+    return 1;
+}
+
+// Recomputes the rows for positions from..fieldCount-1, starting at the
+// kept row at or before from. Returns the number of rows run, or -1 if the
+// choice log could not grow.
+static inline int incrementalDPRun(IncrementalDP *dp, int from) {
+    DPEngine *engine = &dp->engine;
+    int count = dp->session.data.fieldCount;
+    int interval = dp->rowInterval;
+    int start = from / interval * interval;
+
+    if (!incrementalLayoutLog(dp, start) || !incrementalSizeWindows(dp)) return -1;
+
+    Score *prev = dp->rows + (size_t)(start / interval) * dp->rowStride;
+    for (int i = start; i < count; i++) {
+        Score *cur;
+        if ((i + 1) % interval == 0) {
+            cur = dp->rows + (size_t)((i + 1) / interval) * dp->rowStride;
+        } else {
+            cur = prev == dp->scratch[0] ? dp->scratch[1] : dp->scratch[0];
+        }
+        engine->prev = prev;
+        engine->cur = cur;
+        updateRowChunk(engine, i, 0);
+        prev = cur;
+    }
+    dp->last = prev;
+    return count - start;
+}
+
+// Builds the tables for the request already loaded into the session and
+// schedules it. Callers may adjust the loaded fields first.
+static inline IncrementalResult incrementalDPBuild(IncrementalDP *dp) {
+    IncrementalSession *session = &dp->session;
+    IrrigationData *data = &session->data;
+    uint64_t start = monotonicMicros();
+    size_t lineScores = CACHE_LINE / sizeof(Score);
+    size_t rowCount = (size_t)data->totalWater + 1;
+    size_t fieldCount = (size_t)data->fieldCount;
+    dp->rowStride = (rowCount + lineScores - 1) / lineScores * lineScores;
+    size_t rowBytes = dp->rowStride * sizeof(Score);
+
+    // Keep every row if the budget allows, else the fewest gaps that fit
+    size_t slots = dp->rowBudget / rowBytes;
+    if (slots < 2) {
+        dp->rowInterval = data->fieldCount + 1;
+    } else if (slots > fieldCount) {
+        dp->rowInterval = 1;
+    } else {
+        dp->rowInterval = (int)((fieldCount + slots - 2) / (slots - 1));
+    }
+    slots = fieldCount / (size_t)dp->rowInterval + 1;
+
+    // The choice log words and deque windows outlive sessions
+    uint64_t *logWords = dp->engine.log.words;
+    int *windows = dp->engine.windows;
+    memset(&dp->engine, 0, sizeof(dp->engine));
+    memset(&dp->dpStats, 0, sizeof(dp->dpStats));
+    dp->engine.log.words = logWords;
+    dp->engine.windows = windows;
+    dp->engine.data = data;
+    dp->engine.options = &dp->options;
+    dp->engine.threadCount = 1;
+    dp->engine.transition = selectTransition(dp->options.simd, &dp->dpStats.simdLevel);
+    dp->engine.log.rowOffset = arenaAlloc(&session->arena, (fieldCount + 1) * sizeof(size_t));
+    dp->engine.log.rowBits = arenaAlloc(&session->arena, fieldCount + 1);
+    dp->engine.codes = arenaAllocAligned(&session->arena, rowCount * sizeof(int32_t), CACHE_LINE);
+    dp->rows = arenaAllocAligned(&session->arena, slots * rowBytes, CACHE_LINE);
+    dp->scratch[0] = arenaAllocAligned(&session->arena, rowBytes, CACHE_LINE);
+    dp->scratch[1] = arenaAllocAligned(&session->arena, rowBytes, CACHE_LINE);
+    if (!dp->engine.log.rowOffset || !dp->engine.log.rowBits || !dp->engine.codes ||
+        !dp->rows || !dp->scratch[0] || !dp->scratch[1] || !incrementalPrioritize(session)) {
+        return INCREMENTAL_NO_MEMORY;
+    }
+    dp->engine.order = session->order;
+
+    for (size_t w = 0; w < rowCount; w++) dp->rows[w] = SCORE_UNREACHABLE;
+    dp->rows[0] = 0;
+    if (incrementalDPRun(dp, 0) < 0) return INCREMENTAL_NO_MEMORY;
+    dp->dpStats.bestScore = dpBacktrack(data, session->order, &dp->engine.log, dp->last);
+
+    dp->dpStats.threadsUsed = 1;
+    dp->dpStats.tableBytes = (slots + 2) * rowBytes + rowCount * sizeof(int32_t) +
+                             choiceLogBytes(&dp->engine.log, data);
+    dp->dpStats.peakTableBytes = dp->dpStats.tableBytes;
+    dp->dpStats.fullTableBytes = (fieldCount + 1) * rowCount * (sizeof(float) + sizeof(int));
+    session->stats.fullMicros = monotonicMicros() - start;
+    session->stats.updateMicros = session->stats.fullMicros;
+    session->stats.rowsRun = data->fieldCount;
+    session->stats.rowCount = data->fieldCount;
+    session->stats.rowInterval = dp->rowInterval;
+    session->active = 1;
+    return INCREMENTAL_OK;
+}
+
+// Starts a DP session from a full request and schedules it.
+static inline IncrementalResult incrementalDPStart(IncrementalDP *dp, const char *input,
+                                                   size_t length) {
+    IncrementalResult result = incrementalLoad(&dp->session, input, length);
+    if (result != INCREMENTAL_OK) return result;
+    return incrementalDPBuild(dp);
+}
+
+// Applies the updates, moves the changed fields to the end of the
+// processing order and recomputes from the first place they left.
+static inline IncrementalResult incrementalDPUpdate(IncrementalDP *dp, const FieldUpdate *updates,
+                                                    int count, Arena *arena) {
+    IncrementalSession *session = &dp->session;
+    IrrigationData *data = &session->data;
+    int fieldCount = data->fieldCount;
+    uint64_t start = monotonicMicros();
+    unsigned char *changed = arenaAlloc(arena, (size_t)fieldCount);
+    int *moved = arenaAlloc(arena, (size_t)fieldCount * sizeof(int));
+    int movedCount = 0;
+    int from = fieldCount;
+
+    if (!changed || !moved) return INCREMENTAL_NO_MEMORY;
+    memset(changed, 0, (size_t)fieldCount);
+    for (int u = 0; u < count; u++) {
+        int field = updates[u].index;
+        incrementalApply(session, &updates[u]);
+        if (changed[field]) continue;
+        changed[field] = 1;
+        if (session->position[field] < from) from = session->position[field];
+    }
+
+    // Changed fields go last, in the order they had among themselves
+    int write = from;
+    for (int k = from; k < fieldCount; k++) {
+        int field = session->order[k];
+        if (changed[field]) {
+            moved[movedCount++] = field;
+        } else {
+            session->order[write++] = field;
+        }
+    }
+    for (int m = 0; m < movedCount; m++) session->order[write++] = moved[m];
+    for (int k = from; k < fieldCount; k++) session->position[session->order[k]] = k;
+
+    session->stats.fieldsChanged = movedCount;
+    session->stats.rowsRun = 0;
+    if (from < fieldCount) {
+        int rows = incrementalDPRun(dp, from);
+        if (rows < 0) {
+            session->active = 0;
+            return INCREMENTAL_NO_MEMORY;
+        }
+        session->stats.rowsRun = rows;
+    }
+    incrementalClearSchedule(data);
+    dp->dpStats.bestScore = dpBacktrack(data, session->order, &dp->engine.log, dp->last);
+    session->stats.updateMicros = monotonicMicros() - start;
+    return INCREMENTAL_OK;
+}
+
+// What the greedy pass had left before a position.
+typedef struct {
+    int remainingWater;
+    int remainingElectricity;
+} GreedyCheckpoint;
+
+typedef struct {
+    IncrementalSession session;
+    GreedyCheckpoint *checkpoints;  // checkpoints[k]: left before position k
+    int visited;                    // positions the last pass went through
+    int scheduledEnd;               // no field from this position on is scheduled
+} IncrementalGreedy;
+
+static inline void incrementalGreedyInit(IncrementalGreedy *greedy) {
+    memset(greedy, 0, sizeof(*greedy));
+    incrementalSessionInit(&greedy->session);
+}
+
+static inline void incrementalGreedyRelease(IncrementalGreedy *greedy) {
+    arenaRelease(&greedy->session.arena);
+    memset(greedy, 0, sizeof(*greedy));
+}
+
+// Resumes the greedy pass at position from. Returns the positions run.
+static inline int incrementalGreedyRun(IncrementalGreedy *greedy, int from) {
+    IrrigationData *data = &greedy->session.data;
+    const int *order = greedy->session.order;
+    int k;
+
+    for (k = from; k < greedy->scheduledEnd; k++) {
+        data->fields[order[k]].scheduled = 0;
+        data->fields[order[k]].allocated = 0;
+    }
+    data->remainingWater = greedy->checkpoints[from].remainingWater;
+    data->remainingElectricity = greedy->checkpoints[from].remainingElectricity;
+    data->totalWaterUsed = data->totalWater - data->remainingWater;
+    data->totalTimeUsed = data->totalElectricity - data->remainingElectricity;
+
+    for (k = from; k < data->fieldCount; k++) {
+        greedy->checkpoints[k].remainingWater = data->remainingWater;
+        greedy->checkpoints[k].remainingElectricity = data->remainingElectricity;
+        if (!greedyScheduleField(data, &data->fields[order[k]])) {
+            k++;
+            break;
+        }
+    }
+    greedy->visited = k;
+    greedy->scheduledEnd = k;
+    return k - from;
+}
+
+// Starts a greedy session from a full request and schedules it.
+static inline IncrementalResult incrementalGreedyStart(IncrementalGreedy *greedy,
+                                                       const char *input, size_t length) {
+    IncrementalSession *session = &greedy->session;
+    IrrigationData *data = &session->data;
+    IncrementalResult result = incrementalLoad(session, input, length);
+    if (result != INCREMENTAL_OK) return result;
+
+    uint64_t start = monotonicMicros();
+    greedyApplyDefaults(data);
+    greedy->checkpoints = arenaAlloc(&session->arena,
+                                     ((size_t)data->fieldCount + 1) * sizeof(GreedyCheckpoint));
+    if (!greedy->checkpoints || !incrementalPrioritize(session)) return INCREMENTAL_NO_MEMORY;
+    if (data->useTimeConstraints) greedyFieldTimes(data);
+
+    greedy->checkpoints[0].remainingWater = data->totalWater;
+    greedy->checkpoints[0].remainingElectricity = data->totalElectricity;
+    greedy->scheduledEnd = 0;
+    session->stats.rowsRun = incrementalGreedyRun(greedy, 0);
+    session->stats.fullMicros = monotonicMicros() - start;
+    session->stats.updateMicros = session->stats.fullMicros;
+    session->stats.rowCount = data->fieldCount;
+    session->stats.rowInterval = 1;
+    session->active = 1;
+    return INCREMENTAL_OK;
+}
+
+// Priority order with ties in input order, as prioritizeFields gives it.
+static inline int greedyComesBefore(const IrrigationData *data, int a, int b) {
+    int cmp = compareFields(&data->fields[a], &data->fields[b]);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+// Moves a field whose readings changed from position from to its place in
+// priority order. Returns its new position.
+static inline int incrementalGreedyReorder(IncrementalGreedy *greedy, int field, int from) {
+    IncrementalSession *session = &greedy->session;
+    int *order = session->order;
+    int low = 0;
+    int high = session->data.fieldCount - 1;
+
+    // Insertion point among the other fields: slot i holds the field at
+    // position i, or i + 1 once past the field being moved
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int other = order[mid < from ? mid : mid + 1];
+        if (greedyComesBefore(&session->data, field, other)) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    int to = low;
+    if (to < from) {
+        memmove(order + to + 1, order + to, (size_t)(from - to) * sizeof(int));
+    } else if (to > from) {
+        memmove(order + from, order + from + 1, (size_t)(to - from) * sizeof(int));
+    }
+    order[to] = field;
+    for (int k = to < from ? to : from; k <= (to < from ? from : to); k++) {
+        session->position[order[k]] = k;
+    }
+    return to;
+}
+
+// Applies the updates and reruns the pass from the first position any
+// changed field left or joined, if the pass got that far.
+static inline IncrementalResult incrementalGreedyUpdate(IncrementalGreedy *greedy,
+                                                        const FieldUpdate *updates, int count) {
+    IncrementalSession *session = &greedy->session;
+    IrrigationData *data = &session->data;
+    uint64_t start = monotonicMicros();
+    int from = data->fieldCount;
+
+    for (int u = 0; u < count; u++) {
+        int field = updates[u].index;
+        int old = session->position[field];
+        incrementalApply(session, &updates[u]);
+        if (data->useTimeConstraints) greedyFieldTime(data, &data->fields[field]);
+
+        int moved = incrementalGreedyReorder(greedy, field, old);
+        if (old < from) from = old;
+        if (moved < from) from = moved;
+        // Shifting fields by one may carry a scheduled one past the mark
+        greedy->scheduledEnd = greedy->scheduledEnd + 1 > moved + 1 ? greedy->scheduledEnd + 1
+                                                                    : moved + 1;
+        if (greedy->scheduledEnd > data->fieldCount) greedy->scheduledEnd = data->fieldCount;
+    }
+
+    session->stats.fieldsChanged = count;
+    session->stats.rowsRun = from < greedy->visited ? incrementalGreedyRun(greedy, from) : 0;
+    session->stats.updateMicros = monotonicMicros() - start;
+    return INCREMENTAL_OK;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef SMARTFARM_JSON_H
+#define SMARTFARM_JSON_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH 64
+
+// Forward-only JSON reader over a NUL-terminated buffer. Strings come back
+// as slices into the buffer (escape sequences left as written), so nothing
+// is copied. Any malformed input sets error and stops further reads.
+typedef struct {
+    const char *start;
+    const char *cur;
+    const char *end;
+    int error;
+} JsonCursor;
+
+typedef struct {
+    const char *ptr;
+    int length;
+} JsonSlice;
+
+static inline void jsonInit(JsonCursor *json, const char *text, size_t length) {
+    json->start = text;
+    json->cur = text;
+    json->end = text + length;
+    json->error = 0;
+}
+
+static inline int jsonFail(JsonCursor *json) {
+    json->error = 1;
+    return 0;
+}
+
+static inline void jsonSkipSpace(JsonCursor *json) {
+    while (json->cur < json->end &&
+           (*json->cur == ' ' || *json->cur == '\t' || *json->cur == '\n' || *json->cur == '\r')) {
+        json->cur++;
+    }
+}
+
+// Returns the next significant character without consuming it, or 0 at end.
+static inline char jsonPeek(JsonCursor *json) {
+    jsonSkipSpace(json);
+    return json->cur < json->end ? *json->cur : 0;
+}
+
+static inline int jsonConsume(JsonCursor *json, char expected) {
+    if (jsonPeek(json) != expected) return jsonFail(json);
+    json->cur++;
+    return 1;
+}
+
+static inline int jsonString(JsonCursor *json, JsonSlice *out) {
+    if (!jsonConsume(json, '"')) return 0;
+    const char *begin = json->cur;
+    while (json->cur < json->end && *json->cur != '"') {
+        if (*json->cur == '\\') {
+            json->cur++;
+            if (json->cur >= json->end) break;
+        }
+        json->cur++;
+    }
+    if (json->cur >= json->end) return jsonFail(json);
+    out->ptr = begin;
+    out->length = (int)(json->cur - begin);
+    json->cur++;
+    return 1;
+}
+
+// Reads a number and truncates it toward zero, clamped to the int range.
+static inline int jsonInt(JsonCursor *json, int *out) {
+    jsonSkipSpace(json);
+    const char *p = json->cur;
+    int negative = 0;
+    long long value = 0;
+
+    if (p < json->end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    if (p >= json->end || *p < '0' || *p > '9') return jsonFail(json);
+    while (p < json->end && *p >= '0' && *p <= '9') {
+        if (value < 1000000000000LL) value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p < json->end && (*p == '.' || *p == 'e' || *p == 'E')) {
+        char *after;
+        double real = strtod(json->cur, &after);
+        if (after == json->cur) return jsonFail(json);
+        json->cur = after;
+        if (real > 2147483647.0) real = 2147483647.0;
+        if (real < -2147483648.0) real = -2147483648.0;
+        *out = (int)real;
+        return 1;
+    }
+
+    json->cur = p;
+    if (negative) value = -value;
+    if (value > 2147483647LL) value = 2147483647LL;
+    if (value < -2147483648LL) value = -2147483648LL;
+    *out = (int)value;
+    return 1;
+}
+
+static inline int jsonLiteral(JsonCursor *json, const char *word) {
+    size_t length = strlen(word);
+    if ((size_t)(json->end - json->cur) < length || memcmp(json->cur, word, length) != 0) {
+        return jsonFail(json);
+    }
+    json->cur += length;
+    return 1;
+}
+
+// Iterates object members: call with *first = 1 after the opening brace has
+// been consumed; returns 1 with the next key, or 0 at the closing brace or
+// on error (check json->error).
+static inline int jsonNextKey(JsonCursor *json, int *first, JsonSlice *key) {
+    char c = jsonPeek(json);
+    if (*first) {
+        *first = 0;
+        if (c == '}') {
+            json->cur++;
+            return 0;
+        }
+    } else if (c == ',') {
+        json->cur++;
+    } else if (c == '}') {
+        json->cur++;
+        return 0;
+    } else {
+        return jsonFail(json);
+    }
+    return jsonString(json, key) && jsonConsume(json, ':');
+}
+
+// Same protocol as jsonNextKey for array elements; leaves the cursor at the
+// element's value.
+static inline int jsonNextElement(JsonCursor *json, int *first) {
+    char c = jsonPeek(json);
+    if (*first) {
+        *first = 0;
+        if (c == ']') {
+            json->cur++;
+            return 0;
+        }
+        return 1;
+    }
+    if (c == ',') {
+        json->cur++;
+        return 1;
+    }
+    if (c == ']') {
+        json->cur++;
+        return 0;
+    }
+    return jsonFail(json);
+}
+
+static inline int jsonSkipValueAt(JsonCursor *json, int depth) {
+    JsonSlice ignored;
+    int number, first = 1;
+    char c = jsonPeek(json);
+
+    if (depth > JSON_MAX_DEPTH) return jsonFail(json);
+    switch (c) {
+        case '"':
+            return jsonString(json, &ignored);
+        case '{':
+            json->cur++;
+            while (jsonNextKey(json, &first, &ignored)) {
+                if (!jsonSkipValueAt(json, depth + 1)) return 0;
+            }
+            return !json->error;
+        case '[':
+            json->cur++;
+            while (jsonNextElement(json, &first)) {
+                if (!jsonSkipValueAt(json, depth + 1)) return 0;
+            }
+            return !json->error;
+        case 't':
+            return jsonLiteral(json, "true");
+        case 'f':
+            return jsonLiteral(json, "false");
+        case 'n':
+            return jsonLiteral(json, "null");
+        default:
+            return jsonInt(json, &number);
+    }
+}
+
+static inline int jsonSkipValue(JsonCursor *json) {
+    return jsonSkipValueAt(json, 0);
+}
+
+static inline int jsonSliceEquals(JsonSlice slice, const char *text) {
+    size_t length = strlen(text);
+    return (size_t)slice.length == length && memcmp(slice.ptr, text, length) == 0;
+}
+
+static inline long jsonOffset(const JsonCursor *json) {
+    return (long)(json->cur - json->start);
+}
+
+#endif
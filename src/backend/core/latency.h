@@ -0,0 +1,90 @@
+#ifndef SMARTFARM_LATENCY_H
+#define SMARTFARM_LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define LATENCY_BUCKETS 32
+
+// Latency counters for a long-running worker or a batch run. Bucket k
+// counts requests that took [2^k, 2^(k+1)) microseconds.
+typedef struct {
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t totalMicros;
+    uint64_t maxMicros;
+    uint64_t lastMicros;
+    uint64_t buckets[LATENCY_BUCKETS];
+} LatencyCounters;
+
+static inline uint64_t monotonicMicros(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart * 1000000.0 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+#endif
+}
+
+static inline void latencyRecord(LatencyCounters *counters, uint64_t micros, int ok) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (micros >> (bucket + 1)) != 0) bucket++;
+
+    counters->requests++;
+    if (!ok) counters->errors++;
+    counters->totalMicros += micros;
+    counters->lastMicros = micros;
+    if (micros > counters->maxMicros) counters->maxMicros = micros;
+    counters->buckets[bucket]++;
+}
+
+// Adds another worker's counters into these.
+static inline void latencyMerge(LatencyCounters *into, const LatencyCounters *from) {
+    into->requests += from->requests;
+    into->errors += from->errors;
+    into->totalMicros += from->totalMicros;
+    if (from->maxMicros > into->maxMicros) into->maxMicros = from->maxMicros;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        into->buckets[bucket] += from->buckets[bucket];
+    }
+}
+
+// Upper bound of the bucket holding the given percentile, capped at the max.
+static inline uint64_t latencyPercentile(const LatencyCounters *counters, double percentile) {
+    uint64_t target = (uint64_t)(counters->requests * percentile / 100.0 + 0.5);
+    uint64_t seen = 0;
+    if (target == 0) target = 1;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += counters->buckets[bucket];
+        if (seen >= target) {
+            uint64_t upper = (uint64_t)2 << bucket;
+            return upper < counters->maxMicros ? upper : counters->maxMicros;
+        }
+    }
+    return counters->maxMicros;
+}
+
+static inline void latencyWrite(FILE *out, const LatencyCounters *counters) {
+    uint64_t mean = counters->requests ? counters->totalMicros / counters->requests : 0;
+    fprintf(out,
+            "{\"requests\":%llu,\"errors\":%llu,\"lastUs\":%llu,\"meanUs\":%llu,"
+            "\"p50Us\":%llu,\"p99Us\":%llu,\"maxUs\":%llu}\n",
+            (unsigned long long)counters->requests, (unsigned long long)counters->errors,
+            (unsigned long long)counters->lastMicros,
+            (unsigned long long)mean,
+            (unsigned long long)(counters->requests ? latencyPercentile(counters, 50) : 0),
+            (unsigned long long)(counters->requests ? latencyPercentile(counters, 99) : 0),
+            (unsigned long long)counters->maxMicros);
+}
+
+#endif
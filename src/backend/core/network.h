@@ -0,0 +1,518 @@
+#ifndef SMARTFARM_NETWORK_H
+#define SMARTFARM_NETWORK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "farm.h"
+#include "json.h"
+#include "score.h"
+
+// Network-constrained scheduler. Water reaches the fields through pumps and
+// mains with flow caps, described next to the fields:
+//
+//   "network": {"pumps": [{"name": "north", "capacity": 3000}],
+//               "pipes": [{"from": "north", "to": "main-1", "capacity": 1200}]}
+//
+// and each field names the pump or main it hangs off with "main". Pumps
+// draw from the totalWater pool (no capacity: as much as the pool has),
+// pipes carry water one way between pumps and mains, and a field without
+// "main" draws from the pool directly.
+//
+// The allocation is a flow from the pool to the fields. Only the field arcs
+// carry a cost, minus the field's rate, so successive shortest paths
+// augments the highest-rate field that can still be reached first and the
+// shortest-path search reduces to a breadth-first search for any residual
+// path: no heap and no potentials. Nodes left unreachable stay unreachable
+// as flow is added, so once a main is cut off its fields are skipped
+// without a search. Without the DP's minimum allocation this is the
+// optimal flow, and its score bounds every schedule; with it, a field that
+// cannot get its minimum gets nothing and the water goes on down the list,
+// and the gap to the bound is reported. A request without a network is the
+// DP's problem, and gets the DP's schedule.
+
+#define NETWORK_UNLIMITED 2147483647
+
+typedef struct {
+    int to;
+    int next;               // next arc out of the same node, -1 at the end
+    int capacity;           // residual; arc a ^ 1 is a's reverse
+} NetworkArc;
+
+typedef struct {
+    int present;            // 0 when the request has no "network"
+    int nodeCount;          // node 0 is the pool
+    int pumpCount;
+    int pipeCount;
+    int *head;              // first arc out of each node, -1 for none
+    NetworkArc *arcs;
+    int *initial;           // capacity of each arc before any flow
+    int arcCount;
+    int *fieldNode;         // node each field hangs off, 0 for the pool
+} WaterNetwork;
+
+typedef struct {
+    int present;
+    int searches;           // breadth-first searches, in both passes
+    int augments;
+    int cutOff;             // fields skipped because their main was cut off
+    int belowMinimum;       // fields reached but short of their minimum
+    Score relaxedScore;     // optimum without minimum allocations: a bound
+    Score bestScore;
+    int exact;              // 1 when bestScore reaches relaxedScore
+} NetworkStats;
+
+typedef struct {
+    int field;
+    int rank;               // position in priority order, for ties
+    Score rate;
+} NetworkItem;
+
+typedef struct {
+    const char *name;
+    int length;
+    int node;
+} NetworkName;
+
+typedef struct {
+    JsonSlice from;
+    JsonSlice to;
+    int capacity;
+} NetworkPipe;
+
+static int compareNetworkItems(const void *a, const void *b) {
+    const NetworkItem *itemA = a;
+    const NetworkItem *itemB = b;
+    if (itemA->rate != itemB->rate) return itemA->rate > itemB->rate ? -1 : 1;
+    return itemA->rank - itemB->rank;
+}
+
+static inline uint32_t networkNameHash(const char *name, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return hash;
+}
+
+// Looks a name up in the open-addressed table, adding it as the next node
+// when add is set. Returns the node, or -1.
+static inline int networkNode(NetworkName *table, int mask, WaterNetwork *network,
+                              JsonSlice name, int add) {
+    uint32_t slot = networkNameHash(name.ptr, name.length) & (uint32_t)mask;
+    while (table[slot].name) {
+        if (table[slot].length == name.length &&
+            memcmp(table[slot].name, name.ptr, (size_t)name.length) == 0) {
+            return table[slot].node;
+        }
+        slot = (slot + 1) & (uint32_t)mask;
+    }
+    if (!add) return -1;
+    table[slot].name = name.ptr;
+    table[slot].length = name.length;
+    table[slot].node = network->nodeCount++;
+    return table[slot].node;
+}
+
+static inline void networkAddArc(WaterNetwork *network, int from, int to, int capacity) {
+    NetworkArc *arc = &network->arcs[network->arcCount];
+    arc->to = to;
+    arc->capacity = capacity;
+    arc->next = network->head[from];
+    network->head[from] = network->arcCount++;
+    arc[1].to = from;
+    arc[1].capacity = 0;
+    arc[1].next = network->head[to];
+    network->head[to] = network->arcCount++;
+}
+
+static inline int networkGrow(Arena *arena, void **items, int count, int *capacity,
+                              size_t size) {
+    if (count < *capacity) return 1;
+    void *grown = arenaGrow(arena, *items, (size_t)*capacity * size,
+                            (size_t)*capacity * 2 * size);
+    if (!grown) return 0;
+    *items = grown;
+    *capacity *= 2;
+    return 1;
+}
+
+// {"name": ..., "capacity": ...} or {"from": ..., "to": ..., "capacity": ...}
+// capacity is left at -1 without the key; a negative one given is an error.
+static inline int parseNetworkEntry(JsonCursor *json, JsonSlice *name, JsonSlice *to,
+                                    int *capacity) {
+    JsonSlice key;
+    int first = 1;
+
+    name->ptr = NULL;
+    to->ptr = NULL;
+    *capacity = -1;
+    if (!jsonConsume(json, '{')) return 0;
+    while (jsonNextKey(json, &first, &key)) {
+        int ok;
+        if ((jsonSliceEquals(key, "name") || jsonSliceEquals(key, "from")) &&
+            jsonPeek(json) == '"') {
+            ok = jsonString(json, name);
+        } else if (jsonSliceEquals(key, "to") && jsonPeek(json) == '"') {
+            ok = jsonString(json, to);
+        } else if (jsonSliceEquals(key, "capacity")) {
+            ok = parseIntMember(json, capacity);
+            if (ok && *capacity < 0) {
+                fprintf(stderr, "Error: Network capacities must be at least 0\n");
+                return 0;
+            }
+        } else {
+            ok = jsonSkipValue(json);
+        }
+        if (!ok) return 0;
+    }
+    return !json->error;
+}
+
+// Reads "network" and each field's "main" from the request data was
+// parsed from, and builds the graph. Returns 0, with the reason on stderr,
+// if the network is malformed or a field names a main it does not have.
+static inline int parseWaterNetwork(const char *input, size_t length, const IrrigationData *data,
+                                    WaterNetwork *network, Arena *arena) {
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+    int pumpCapacity = 16, pipeCapacity = 16;
+    NetworkPipe *pumps = arenaAlloc(arena, (size_t)pumpCapacity * sizeof(NetworkPipe));
+    NetworkPipe *pipes = arenaAlloc(arena, (size_t)pipeCapacity * sizeof(NetworkPipe));
+    JsonSlice *mains = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+
+    memset(network, 0, sizeof(*network));
+    if (!pumps || !pipes || !mains) return 0;
+    memset(mains, 0, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+
+    jsonInit(&json, input, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        int ok = 1;
+        if (jsonSliceEquals(key, "network") && jsonPeek(&json) == '{') {
+            int firstPart = 1;
+            network->present = 1;
+            json.cur++;
+            while (ok && jsonNextKey(&json, &firstPart, &key)) {
+                int isPump = jsonSliceEquals(key, "pumps");
+                if ((!isPump && !jsonSliceEquals(key, "pipes")) || jsonPeek(&json) != '[') {
+                    ok = jsonSkipValue(&json);
+                    continue;
+                }
+                int firstEntry = 1;
+                json.cur++;
+                while (ok && jsonNextElement(&json, &firstEntry)) {
+                    NetworkPipe entry;
+                    if (!parseNetworkEntry(&json, &entry.from, &entry.to, &entry.capacity)) {
+                        return 0;
+                    }
+                    if (isPump) {
+                        if (!entry.from.ptr) {
+                            fprintf(stderr, "Error: Pump without a name\n");
+                            return 0;
+                        }
+                        ok = networkGrow(arena, (void **)&pumps, network->pumpCount,
+                                         &pumpCapacity, sizeof(NetworkPipe));
+                        if (ok) pumps[network->pumpCount++] = entry;
+                    } else {
+                        if (!entry.from.ptr || !entry.to.ptr || entry.capacity < 0) {
+                            fprintf(stderr, "Error: Pipes need \"from\", \"to\" and a capacity "
+                                            "of at least 0\n");
+                            return 0;
+                        }
+                        ok = networkGrow(arena, (void **)&pipes, network->pipeCount,
+                                         &pipeCapacity, sizeof(NetworkPipe));
+                        if (ok) pipes[network->pipeCount++] = entry;
+                    }
+                }
+            }
+            ok = ok && !json.error;
+        } else if (jsonSliceEquals(key, "fields") && jsonPeek(&json) == '[') {
+            // Counted as farm.h counts them: named objects only
+            int firstElement = 1;
+            int index = 0;
+            json.cur++;
+            while (ok && jsonNextElement(&json, &firstElement)) {
+                JsonSlice main = {NULL, 0};
+                int firstKey = 1, named = 0;
+                if (jsonPeek(&json) != '{') {
+                    ok = jsonSkipValue(&json);
+                    continue;
+                }
+                json.cur++;
+                while (ok && jsonNextKey(&json, &firstKey, &key)) {
+                    if (jsonSliceEquals(key, "name") && jsonPeek(&json) == '"') {
+                        JsonSlice name;
+                        ok = jsonString(&json, &name);
+                        named = 1;
+                    } else if (jsonSliceEquals(key, "main") && jsonPeek(&json) == '"') {
+                        ok = jsonString(&json, &main);
+                    } else {
+                        ok = jsonSkipValue(&json);
+                    }
+                }
+                if (named) {
+                    if (index < data->fieldCount) mains[index] = main;
+                    index++;
+                }
+            }
+            ok = ok && !json.error;
+        } else {
+            ok = jsonSkipValue(&json);
+        }
+        if (!ok) return 0;
+    }
+    if (json.error) return 0;
+
+    // Pumps first, then the mains the pipes name; node 0 is the pool
+    int names = network->pumpCount + 2 * network->pipeCount;
+    int mask = 1;
+    while (mask < 2 * names + 1) mask <<= 1;
+    NetworkName *table = arenaAlloc(arena, (size_t)mask * sizeof(NetworkName));
+    if (!table) return 0;
+    memset(table, 0, (size_t)mask * sizeof(NetworkName));
+    mask--;
+
+    network->nodeCount = 1;
+    for (int p = 0; p < network->pumpCount; p++) {
+        if (networkNode(table, mask, network, pumps[p].from, 0) >= 0) {
+            fprintf(stderr, "Error: Pump %.*s is listed twice\n", pumps[p].from.length,
+                    pumps[p].from.ptr);
+            return 0;
+        }
+        networkNode(table, mask, network, pumps[p].from, 1);
+    }
+    for (int p = 0; p < network->pipeCount; p++) {
+        networkNode(table, mask, network, pipes[p].from, 1);
+        networkNode(table, mask, network, pipes[p].to, 1);
+    }
+
+    network->arcCount = 0;
+    network->head = arenaAlloc(arena, (size_t)network->nodeCount * sizeof(int));
+    network->arcs = arenaAlloc(arena, (size_t)(2 * (names + 1)) * sizeof(NetworkArc));
+    network->initial = arenaAlloc(arena, (size_t)(2 * (names + 1)) * sizeof(int));
+    network->fieldNode = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    if (!network->head || !network->arcs || !network->initial || !network->fieldNode) return 0;
+    for (int v = 0; v < network->nodeCount; v++) network->head[v] = -1;
+    for (int p = 0; p < network->pumpCount; p++) {
+        networkAddArc(network, 0, 1 + p,
+                      pumps[p].capacity >= 0 ? pumps[p].capacity : NETWORK_UNLIMITED);
+    }
+    for (int p = 0; p < network->pipeCount; p++) {
+        networkAddArc(network, networkNode(table, mask, network, pipes[p].from, 0),
+                      networkNode(table, mask, network, pipes[p].to, 0), pipes[p].capacity);
+    }
+    for (int a = 0; a < network->arcCount; a++) network->initial[a] = network->arcs[a].capacity;
+
+    for (int i = 0; i < data->fieldCount; i++) {
+        network->fieldNode[i] = 0;
+        if (!mains[i].ptr) continue;
+        network->fieldNode[i] = networkNode(table, mask, network, mains[i], 0);
+        if (network->fieldNode[i] < 0) {
+            fprintf(stderr, "Error: Field %.*s hangs off unknown main %.*s\n",
+                    data->fields[i].nameLength, data->fields[i].name, mains[i].length,
+                    mains[i].ptr);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Search and undo state for one pass.
+typedef struct {
+    WaterNetwork *network;
+    int *parentArc;         // arc the search reached each node by
+    int *seen;              // seen[v] == search: reached by the current search
+    int *queue;
+    unsigned char *cutOff;  // no residual path from the pool any more
+    int *undo;              // arcs and amounts pushed for the current field
+    int undoCount;
+    int undoCapacity;
+    int search;
+} NetworkSearch;
+
+// Breadth-first search for a residual path from the pool to target.
+static inline int networkFindPath(NetworkSearch *state, int target, NetworkStats *stats) {
+    const WaterNetwork *network = state->network;
+    int head = 0, tail = 0;
+
+    stats->searches++;
+    state->search++;
+    state->seen[0] = state->search;
+    state->queue[tail++] = 0;
+    while (head < tail) {
+        int v = state->queue[head++];
+        for (int a = network->head[v]; a >= 0; a = network->arcs[a].next) {
+            int to = network->arcs[a].to;
+            if (network->arcs[a].capacity <= 0 || state->seen[to] == state->search ||
+                state->cutOff[to]) {
+                continue;
+            }
+            state->seen[to] = state->search;
+            state->parentArc[to] = a;
+            if (to == target) return 1;
+            state->queue[tail++] = to;
+        }
+    }
+    return 0;
+}
+
+// Gives the field as much as the network and the pool carry, up to its
+// need; less than minimum is taken back. Returns what the field got.
+static inline int networkFeed(NetworkSearch *state, int target, int want, int minimum,
+                              NetworkStats *stats, Arena *arena) {
+    WaterNetwork *network = state->network;
+    int pushed = 0;
+    int blocked = 0;
+
+    state->undoCount = 0;
+    if (target == 0) return want >= minimum ? want : 0;
+    while (pushed < want) {
+        if (!networkFindPath(state, target, stats)) {
+            blocked = 1;
+            break;
+        }
+        int amount = want - pushed;
+        for (int v = target; v != 0; v = network->arcs[state->parentArc[v] ^ 1].to) {
+            int capacity = network->arcs[state->parentArc[v]].capacity;
+            if (capacity < amount) amount = capacity;
+        }
+        for (int v = target; v != 0; v = network->arcs[state->parentArc[v] ^ 1].to) {
+            int a = state->parentArc[v];
+            if (!networkGrow(arena, (void **)&state->undo, state->undoCount + 1,
+                             &state->undoCapacity, sizeof(int))) {
+                return -1;
+            }
+            network->arcs[a].capacity -= amount;
+            network->arcs[a ^ 1].capacity += amount;
+            state->undo[state->undoCount++] = a;
+            state->undo[state->undoCount++] = amount;
+        }
+        pushed += amount;
+        stats->augments++;
+    }
+
+    if (pushed > 0 && pushed < minimum) {
+        for (int u = state->undoCount - 2; u >= 0; u -= 2) {
+            network->arcs[state->undo[u]].capacity += state->undo[u + 1];
+            network->arcs[state->undo[u] ^ 1].capacity -= state->undo[u + 1];
+        }
+        stats->belowMinimum++;
+        return 0;
+    }
+    if (blocked) {
+        // Whatever the last search missed is out of reach for good
+        for (int v = 1; v < network->nodeCount; v++) {
+            if (state->seen[v] != state->search) state->cutOff[v] = 1;
+        }
+    }
+    return pushed >= minimum ? pushed : 0;
+}
+
+// One pass down the items, highest rate first. With strict, every field
+// gets nothing or at least the DP's minimum of ceil(need / 10); without,
+// the pass is the optimal flow. Returns the score, or -1 if out of memory.
+static inline Score networkPass(IrrigationData *data, WaterNetwork *network,
+                                const NetworkItem *items, int itemCount, int strict,
+                                NetworkStats *stats, Arena *arena) {
+    NetworkSearch state;
+    int remaining = data->totalWater;
+    Score score = 0;
+
+    memset(&state, 0, sizeof(state));
+    state.network = network;
+    state.parentArc = arenaAlloc(arena, (size_t)network->nodeCount * sizeof(int));
+    state.seen = arenaAlloc(arena, (size_t)network->nodeCount * sizeof(int));
+    state.queue = arenaAlloc(arena, (size_t)network->nodeCount * sizeof(int));
+    state.cutOff = arenaAlloc(arena, (size_t)network->nodeCount);
+    state.undoCapacity = 64;
+    state.undo = arenaAlloc(arena, (size_t)state.undoCapacity * sizeof(int));
+    if (!state.parentArc || !state.seen || !state.queue || !state.cutOff || !state.undo) {
+        return -1;
+    }
+    memset(state.seen, 0, (size_t)network->nodeCount * sizeof(int));
+    memset(state.cutOff, 0, (size_t)network->nodeCount);
+    for (int a = 0; a < network->arcCount; a++) network->arcs[a].capacity = network->initial[a];
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+
+    for (int k = 0; k < itemCount && remaining > 0; k++) {
+        Field *field = &data->fields[items[k].field];
+        int node = network->fieldNode[items[k].field];
+        int want = field->waterNeeded < remaining ? field->waterNeeded : remaining;
+        int minimum = strict ? (field->waterNeeded + 9) / 10 : 1;
+
+        if (state.cutOff[node]) {
+            stats->cutOff++;
+            continue;
+        }
+        if (want < minimum) continue;
+        int got = networkFeed(&state, node, want, minimum, stats, arena);
+        if (got < 0) return -1;
+        if (got == 0) continue;
+        field->allocated = got;
+        field->scheduled = 1;
+        remaining -= got;
+        score += items[k].rate * got;
+    }
+    data->totalWaterUsed = data->totalWater - remaining;
+    data->remainingWater = remaining;
+    return score;
+}
+
+// Schedules within the network, with the fields in the given priority
+// order (from prioritizeFields) breaking rate ties; the fields stay where
+// they are. Returns 0 if out of memory.
+static inline int networkScheduleOrdered(IrrigationData *data, const int *order,
+                                         WaterNetwork *network, Arena *arena,
+                                         NetworkStats *stats) {
+    NetworkItem *items;
+    int itemCount = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->present = network->present;
+    if (!network->present) {
+        DPOptions options;
+        DPStats dpStats;
+        dpOptionsInit(&options);
+        if (!dpScheduleOrdered(data, order, &options, arena, &dpStats)) return 0;
+        stats->relaxedScore = dpStats.bestScore;
+        stats->bestScore = dpStats.bestScore;
+        stats->exact = 1;
+        return 1;
+    }
+
+    items = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(NetworkItem));
+    if (!items) return 0;
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order[k]];
+        if (field->waterNeeded <= 0 || field->moisture >= 100) continue;
+        items[itemCount].field = order[k];
+        items[itemCount].rank = k;
+        items[itemCount].rate = fieldRate(field);
+        itemCount++;
+    }
+    qsort(items, (size_t)itemCount, sizeof(NetworkItem), compareNetworkItems);
+
+    stats->relaxedScore = networkPass(data, network, items, itemCount, 0, stats, arena);
+    if (stats->relaxedScore < 0) return 0;
+    stats->cutOff = 0;
+    stats->bestScore = networkPass(data, network, items, itemCount, 1, stats, arena);
+    if (stats->bestScore < 0) return 0;
+    stats->exact = stats->bestScore == stats->relaxedScore;
+    return 1;
+}
+
+static inline int networkSchedule(IrrigationData *data, WaterNetwork *network, Arena *arena,
+                                  NetworkStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return networkScheduleOrdered(data, order, network, arena, stats);
+}
+
+#endif
@@ -0,0 +1,482 @@
+#ifndef SMARTFARM_POWER_H
+#define SMARTFARM_POWER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "farm.h"
+#include "greedy.h"
+#include "profile.h"
+#include "score.h"
+
+// Water- and electricity-constrained scheduler. Maximizes the DP objective
+// while also keeping the pump time, ceil(allocated / waterDeliveryRate) per
+// field, within totalElectricity, the budget the greedy pass honours.
+//
+// Instead of a totalWater x totalElectricity table, electricity moves into
+// the objective: each unit of pump time costs a multiplier mu, and a
+// water-only DP finds the best penalized schedule. For any mu >= 0,
+// L(mu) = penalized optimum + mu * totalElectricity bounds the true optimum
+// from above, and L is convex and piecewise linear in mu, so cutting planes
+// from the schedules found so far pick the next mu and the search ends in
+// a handful of DP runs. Every schedule met on the way is repaired to fit
+// both budgets and the best one is kept; its gap to the smallest bound is
+// reported, and a zero gap proves it optimal.
+
+#define POWER_DEFAULT_ITERATIONS 32
+
+typedef struct {
+    int maxIterations;     // penalized DP runs, including the one at mu = 0
+    double gapTolerance;   // stop once (bound - score) / bound is this small
+} PowerOptions;
+
+typedef struct {
+    int constrained;       // 0 when the request sets no electricity budget
+    int iterations;
+    Score waterOnlyScore;  // optimum with electricity ignored, L(0)
+    Score dualBound;       // smallest L(mu) seen: no schedule scores more
+    Score multiplier;      // mu at that bound, score units per unit of time
+    Score bestScore;
+    int timeUsed;
+    int exact;             // 1 when bestScore reaches dualBound
+    size_t peakTableBytes;
+} PowerStats;
+
+typedef struct {
+    int field;
+    int rank;              // position in priority order, for ties
+    Score rate;
+} PowerItem;
+
+// Lagrangian DP state: two rolling rows, a row of choice codes and the
+// packed choice log shared with the DP engine.
+typedef struct {
+    IrrigationData *data;
+    const int *order;      // row i schedules data->fields[order[i]]
+    ChoiceLog log;
+    Score *prev;
+    Score *cur;
+    int32_t *codes;
+    int *window;
+    int windowMask;
+    int *windowBest;       // windowBest[k]: best j in (k - waterDeliveryRate, k], or -1
+} PowerEngine;
+
+static inline void powerOptionsInit(PowerOptions *options) {
+    options->maxIterations = POWER_DEFAULT_ITERATIONS;
+    options->gapTolerance = 0;
+}
+
+static int comparePowerItems(const void *a, const void *b) {
+    const PowerItem *itemA = a;
+    const PowerItem *itemB = b;
+    if (itemA->rate != itemB->rate) return itemA->rate > itemB->rate ? -1 : 1;
+    return itemA->rank - itemB->rank;
+}
+
+static inline int powerTime(int water, int deliveryRate) {
+    return (water + deliveryRate - 1) / deliveryRate;
+}
+
+// One sliding-window maximum over the allocations [low, high], all of which
+// take the same pump time and so pay the same penalty. As in the deque
+// kernel, equal keys keep the larger j, so smaller allocations win ties.
+static void powerWindowPass(const PowerEngine *engine, const Field *field, int low, int high,
+                            Score penalty) {
+    const Score *prev = engine->prev;
+    Score *cur = engine->cur;
+    int *window = engine->window;
+    int mask = engine->windowMask;
+    int totalWater = engine->data->totalWater;
+    int minWater = (field->waterNeeded + 9) / 10;
+    Score rate = fieldRate(field);
+    int head = 0, tail = 0;
+
+    for (int w = low; w <= totalWater; w++) {
+        int j = w - low;
+        if (prev[j] >= 0) {
+            Score key = prev[j] - rate * j;
+            while (tail > head) {
+                int back = window[(tail - 1) & mask];
+                if (prev[back] - rate * back > key) break;
+                tail--;
+            }
+            window[tail++ & mask] = j;
+        }
+        while (tail > head && window[head & mask] < w - high) head++;
+        if (tail == head) continue;
+
+        int from = window[head & mask];
+        Score candidate = prev[from] + rate * (w - from) - penalty;
+        if (candidate > cur[w]) {
+            cur[w] = candidate;
+            engine->codes[w] = w - from - minWater + 1;
+        }
+    }
+}
+
+// Fills windowBest with the best j of every window waterDeliveryRate wide,
+// with the same tie rule as the window pass.
+static void powerWindowMax(const PowerEngine *engine, const Field *field) {
+    const Score *prev = engine->prev;
+    int *window = engine->window;
+    int mask = engine->windowMask;
+    int width = engine->data->waterDeliveryRate;
+    Score rate = fieldRate(field);
+    int head = 0, tail = 0;
+
+    for (int j = 0; j <= engine->data->totalWater; j++) {
+        if (prev[j] >= 0) {
+            Score key = prev[j] - rate * j;
+            while (tail > head) {
+                int back = window[(tail - 1) & mask];
+                if (prev[back] - rate * back > key) break;
+                tail--;
+            }
+            window[tail++ & mask] = j;
+        }
+        while (tail > head && window[head & mask] <= j - width) head++;
+        engine->windowBest[j] = tail > head ? window[head & mask] : -1;
+    }
+}
+
+// The window pass for a range exactly waterDeliveryRate wide starting at
+// low, reading the maxima from windowBest.
+static void powerShiftedPass(const PowerEngine *engine, const Field *field, int low,
+                             Score penalty) {
+    const Score *prev = engine->prev;
+    Score *cur = engine->cur;
+    const int *windowBest = engine->windowBest;
+    int minWater = (field->waterNeeded + 9) / 10;
+    Score rate = fieldRate(field);
+
+    for (int w = low; w <= engine->data->totalWater; w++) {
+        int from = windowBest[w - low];
+        if (from < 0) continue;
+        Score candidate = prev[from] + rate * (w - from) - penalty;
+        if (candidate > cur[w]) {
+            cur[w] = candidate;
+            engine->codes[w] = w - from - minWater + 1;
+        }
+    }
+}
+
+// Penalized row update. The allocations that take t units of pump time are
+// a range at most waterDeliveryRate wide, and the value is linear within
+// it, so each t is one window pass at penalty mu * t; the full-width ranges
+// share one set of window maxima. Ranges whose best allocation cannot pay
+// for its time are skipped: any schedule using them does better without
+// the field. Returns 0 when every range is skipped and the row is prev
+// unchanged, which at a high mu is most of them. With no penalty the
+// ranges merge into the DP's single window.
+static int powerUpdateRow(PowerEngine *engine, int i, Score mu) {
+    const IrrigationData *data = engine->data;
+    const Field *field = &data->fields[engine->order[i]];
+    size_t rowCount = (size_t)data->totalWater + 1;
+    int deliveryRate = data->waterDeliveryRate;
+    int minWater = (field->waterNeeded + 9) / 10;
+    int maxWater = field->waterNeeded < data->totalWater ? field->waterNeeded : data->totalWater;
+    Score rate = fieldRate(field);
+    int updated = 0;
+    int haveMaxima = 0;
+
+    if (field->waterNeeded <= 0 || minWater > maxWater) return 0;
+    if (mu == 0) {
+        memcpy(engine->cur, engine->prev, rowCount * sizeof(Score));
+        memset(engine->codes, 0, rowCount * sizeof(int32_t));
+        powerWindowPass(engine, field, minWater, maxWater, 0);
+        choiceLogPackRange(&engine->log, i, engine->codes, 0, (int)rowCount);
+        return 1;
+    }
+    for (int t = powerTime(minWater, deliveryRate); t <= powerTime(maxWater, deliveryRate); t++) {
+        int64_t first = (int64_t)(t - 1) * deliveryRate + 1;
+        int64_t last = (int64_t)t * deliveryRate;
+        int low = first > minWater ? (int)first : minWater;
+        int high = last < maxWater ? (int)last : maxWater;
+        if (low > high) continue;
+        if (mu > 0 && t > rate * high / mu) continue;
+        if (!updated) {
+            memcpy(engine->cur, engine->prev, rowCount * sizeof(Score));
+            memset(engine->codes, 0, rowCount * sizeof(int32_t));
+            updated = 1;
+        }
+        if (high - low + 1 < deliveryRate) {
+            powerWindowPass(engine, field, low, high, mu * t);
+            continue;
+        }
+        if (!haveMaxima) {
+            powerWindowMax(engine, field);
+            haveMaxima = 1;
+        }
+        powerShiftedPass(engine, field, low, mu * t);
+    }
+    if (updated) choiceLogPackRange(&engine->log, i, engine->codes, 0, (int)rowCount);
+    return updated;
+}
+
+// Best schedule for penalty mu, written into the fields. Returns the
+// penalized score.
+static Score powerEvaluate(PowerEngine *engine, Score mu) {
+    IrrigationData *data = engine->data;
+
+    uint64_t start = phaseBegin();
+    int rowsRun = 0;
+
+    memset(engine->log.words, 0, engine->log.totalWords * sizeof(uint64_t));
+    for (int w = 0; w <= data->totalWater; w++) {
+        engine->prev[w] = SCORE_UNREACHABLE;
+    }
+    engine->prev[0] = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (!powerUpdateRow(engine, i, mu)) continue;
+        Score *swap = engine->prev;
+        engine->prev = engine->cur;
+        engine->cur = swap;
+        rowsRun++;
+    }
+    phaseEnd(PHASE_FILL, start);
+    profileCount((uint64_t)rowsRun * ((uint64_t)data->totalWater + 1), 0);
+
+    start = phaseBegin();
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+    Score penalized = dpBacktrack(data, engine->order, &engine->log, engine->prev);
+    phaseEnd(PHASE_BACKTRACK, start);
+    return penalized;
+}
+
+static void powerMeasure(const IrrigationData *data, Score *score, int64_t *time) {
+    *score = 0;
+    *time = 0;
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (!field->scheduled) continue;
+        *score += fieldRate(field) * field->allocated;
+        *time += powerTime(field->allocated, data->waterDeliveryRate);
+    }
+}
+
+static void powerSetAllocation(Field *field, int water) {
+    field->allocated = water;
+    field->scheduled = water > 0;
+}
+
+// Makes a schedule fit both budgets, then spends what is left. While over
+// the electricity budget, pump time comes off the lowest-rate fields
+// first, dropping a field once it would fall below a tenth of its need.
+// Then fields are topped up, or started at their minimum or more, highest
+// rate first, while water and time remain.
+static void powerRepair(IrrigationData *data, const PowerItem *items, int itemCount) {
+    int deliveryRate = data->waterDeliveryRate;
+    int64_t water = 0;
+    int64_t time = 0;
+
+    for (int i = 0; i < data->fieldCount; i++) {
+        const Field *field = &data->fields[i];
+        if (!field->scheduled) continue;
+        water += field->allocated;
+        time += powerTime(field->allocated, deliveryRate);
+    }
+
+    for (int k = itemCount - 1; k >= 0 && time > data->totalElectricity; k--) {
+        Field *field = &data->fields[items[k].field];
+        if (!field->scheduled) continue;
+        int fieldTime = powerTime(field->allocated, deliveryRate);
+        int64_t keep = fieldTime - (time - data->totalElectricity);
+        int64_t reduced = keep > 0 ? keep * deliveryRate : 0;
+        if (reduced < (field->waterNeeded + 9) / 10) reduced = 0;
+        water -= field->allocated - reduced;
+        time -= fieldTime - powerTime((int)reduced, deliveryRate);
+        powerSetAllocation(field, (int)reduced);
+    }
+
+    for (int k = 0; k < itemCount; k++) {
+        Field *field = &data->fields[items[k].field];
+        int64_t roomWater = data->totalWater - water;
+        int64_t roomTime = data->totalElectricity - time;
+        int fieldTime = powerTime(field->allocated, deliveryRate);
+        int64_t grown = field->allocated + roomWater;
+
+        if (roomWater <= 0 || roomTime < 0) break;
+        if (field->allocated >= field->waterNeeded) continue;
+        if (grown > field->waterNeeded) grown = field->waterNeeded;
+        if (grown > (fieldTime + roomTime) * deliveryRate) {
+            grown = (fieldTime + roomTime) * deliveryRate;
+        }
+        if (grown <= field->allocated || grown < (field->waterNeeded + 9) / 10) continue;
+        water += grown - field->allocated;
+        time += powerTime((int)grown, deliveryRate) - fieldTime;
+        powerSetAllocation(field, (int)grown);
+    }
+}
+
+// Repairs the schedule in the fields and keeps it in best if it beats the
+// best so far. Returns the repaired score and time.
+static void powerKeepRepaired(IrrigationData *data, const PowerItem *items, int itemCount,
+                              int *best, PowerStats *stats, Score *score, int64_t *time) {
+    powerRepair(data, items, itemCount);
+    powerMeasure(data, score, time);
+    if (*score > stats->bestScore) {
+        stats->bestScore = *score;
+        for (int i = 0; i < data->fieldCount; i++) best[i] = data->fields[i].allocated;
+    }
+}
+
+// Schedules with the fields in the given priority order (from
+// prioritizeFields), which orders the DP rows and breaks ties; the fields
+// stay where they are. Without an electricity budget this is the DP.
+// Returns 0 if the tables do not fit in memory.
+static inline int powerScheduleOrdered(IrrigationData *data, const int *order,
+                                       const PowerOptions *options, Arena *arena,
+                                       PowerStats *stats) {
+    PowerEngine engine;
+    DPStats tableStats;
+    PowerItem *items;
+    int *best;
+    int itemCount = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    data->useTimeConstraints = data->totalElectricity > 0 && data->waterDeliveryRate > 0;
+    stats->constrained = data->useTimeConstraints;
+    if (!stats->constrained) {
+        DPOptions dpOptions;
+        dpOptionsInit(&dpOptions);
+        if (!dpScheduleOrdered(data, order, &dpOptions, arena, &tableStats)) return 0;
+        stats->iterations = 1;
+        stats->waterOnlyScore = tableStats.bestScore;
+        stats->dualBound = tableStats.bestScore;
+        stats->bestScore = tableStats.bestScore;
+        stats->exact = 1;
+        stats->peakTableBytes = tableStats.peakTableBytes;
+        return 1;
+    }
+
+    size_t rowCount = (size_t)data->totalWater + 1;
+    int windowSlots = windowMaskFor(data) + 1;
+    while (windowSlots < data->waterDeliveryRate + 1 && (size_t)windowSlots < rowCount + 1) {
+        windowSlots <<= 1;
+    }
+    memset(&engine, 0, sizeof(engine));
+    memset(&tableStats, 0, sizeof(tableStats));
+    engine.data = data;
+    engine.order = order;
+    engine.windowMask = windowSlots - 1;
+    engine.prev = arenaAllocAligned(arena, rowCount * sizeof(Score), CACHE_LINE);
+    engine.cur = arenaAllocAligned(arena, rowCount * sizeof(Score), CACHE_LINE);
+    engine.codes = arenaAllocAligned(arena, rowCount * sizeof(int32_t), CACHE_LINE);
+    engine.window = arenaAlloc(arena, (size_t)windowSlots * sizeof(int));
+    engine.windowBest = arenaAlloc(arena, rowCount * sizeof(int));
+    items = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(PowerItem));
+    best = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    if (!engine.prev || !engine.cur || !engine.codes || !engine.window || !engine.windowBest ||
+        !items || !best || !choiceLogInit(&engine.log, data, order, arena, &tableStats)) {
+        return 0;
+    }
+    trackAlloc(&tableStats, rowCount * (2 * sizeof(Score) + sizeof(int32_t) + sizeof(int)) +
+                                (size_t)windowSlots * sizeof(int));
+    greedyFieldTimes(data);
+
+    // Repair tops fields up in rate order
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[order[k]];
+        if (field->waterNeeded <= 0 || field->moisture >= 100) continue;
+        items[itemCount].field = order[k];
+        items[itemCount].rank = k;
+        items[itemCount].rate = fieldRate(field);
+        itemCount++;
+    }
+    qsort(items, itemCount, sizeof(PowerItem), comparePowerItems);
+
+    Score score;
+    int64_t time;
+    Score penalized = powerEvaluate(&engine, 0);
+    powerMeasure(data, &score, &time);
+    stats->iterations = 1;
+    stats->waterOnlyScore = penalized;
+    stats->dualBound = penalized;
+    stats->bestScore = -1;
+
+    if (time <= data->totalElectricity) {
+        // The water-only optimum already fits
+        stats->bestScore = score;
+    } else {
+        // Cutting planes: every schedule is a line score - mu * time +
+        // mu * E below L. tooLong holds the latest schedule over the budget,
+        // fits the latest within it, starting from the better of the
+        // repaired water-only schedule and a fill from nothing.
+        Score tooLongScore = score, fitsScore, emptyScore;
+        int64_t tooLongTime = time, fitsTime, emptyTime;
+
+        powerKeepRepaired(data, items, itemCount, best, stats, &fitsScore, &fitsTime);
+        for (int i = 0; i < data->fieldCount; i++) powerSetAllocation(&data->fields[i], 0);
+        powerKeepRepaired(data, items, itemCount, best, stats, &emptyScore, &emptyTime);
+        if (emptyScore > fitsScore) {
+            fitsScore = emptyScore;
+            fitsTime = emptyTime;
+        }
+
+        while (stats->iterations < options->maxIterations) {
+            // Where the two lines cross
+            Score mu = (tooLongScore - fitsScore) / (tooLongTime - fitsTime);
+            if (mu < 0) mu = 0;
+            penalized = powerEvaluate(&engine, mu);
+            powerMeasure(data, &score, &time);
+            stats->iterations++;
+
+            Score bound = penalized + mu * data->totalElectricity;
+            if (bound < stats->dualBound) {
+                stats->dualBound = bound;
+                stats->multiplier = mu;
+            }
+
+            int repeated = (score == tooLongScore && time == tooLongTime) ||
+                           (score == fitsScore && time == fitsTime);
+            if (time > data->totalElectricity) {
+                tooLongScore = score;
+                tooLongTime = time;
+            } else {
+                fitsScore = score;
+                fitsTime = time;
+            }
+
+            Score repaired;
+            int64_t repairedTime;
+            powerKeepRepaired(data, items, itemCount, best, stats, &repaired, &repairedTime);
+
+            // No new cut, or a schedule using exactly the budget: L is at its minimum
+            if (repeated || time == data->totalElectricity ||
+                stats->dualBound - stats->bestScore <=
+                    (Score)(options->gapTolerance * (double)stats->dualBound)) {
+                break;
+            }
+        }
+        for (int i = 0; i < data->fieldCount; i++) powerSetAllocation(&data->fields[i], best[i]);
+    }
+
+    powerMeasure(data, &score, &time);
+    data->totalWaterUsed = 0;
+    for (int i = 0; i < data->fieldCount; i++) data->totalWaterUsed += data->fields[i].allocated;
+    data->remainingWater = data->totalWater - data->totalWaterUsed;
+    data->totalTimeUsed = (int)time;
+    data->remainingElectricity = data->totalElectricity - data->totalTimeUsed;
+    stats->timeUsed = data->totalTimeUsed;
+    stats->exact = stats->bestScore == stats->dualBound;
+    stats->peakTableBytes = tableStats.peakTableBytes;
+    return 1;
+}
+
+// Prioritizes and schedules; fields stay in input order. Returns 0 if
+// memory runs out.
+static inline int powerSchedule(IrrigationData *data, const PowerOptions *options, Arena *arena,
+                                PowerStats *stats) {
+    const int *order = prioritizeFields(data, arena);
+    if (!order) return 0;
+    return powerScheduleOrdered(data, order, options, arena, stats);
+}
+
+#endif
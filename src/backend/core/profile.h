@@ -0,0 +1,184 @@
+#ifndef SMARTFARM_PROFILE_H
+#define SMARTFARM_PROFILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "arena.h"
+#include "latency.h"
+
+// Per-phase timing and counters for one request, written to stderr after
+// the response when a scheduler runs with --profile line|json:
+//
+//   profile ok=1 read_us=12 parse_us=85 sort_us=9 fill_us=10342 ...
+//   {"profile":{"ok":1,"readUs":12,"parseUs":85,"sortUs":9,"fillUs":10342,...}}
+//
+// read is the stdin read of a one-shot run; in the serve modes a request
+// line is already in memory when its profile starts. fill is the search
+// itself (DP rows, the greedy pass, branch-and-bound) and cells/
+// improvements count its work: for the DP, table cells filled and cells
+// where the field's allocation beat skipping it. There is no order-restore
+// phase, since the fields never leave input order. peak_heap_bytes is the
+// request's high-water mark: what it used of its arena, plus what it holds
+// outside it (the full-memory DP tables, the output buffer, the
+// incremental engine's buffers and the session arenas a full request
+// refills, the thread pool, the zone workers' arenas). peak_rss_kb is the
+// process's, so it never goes down in the serve modes.
+//
+// When profiling is off every hook is one test of a thread-local pointer.
+
+#if defined(_MSC_VER)
+#define PROFILE_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILE_THREAD_LOCAL __thread
+#endif
+
+typedef enum {
+    PHASE_READ,
+    PHASE_PARSE,
+    PHASE_SORT,
+    PHASE_FILL,
+    PHASE_BACKTRACK,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} Phase;
+
+typedef enum {
+    PROFILE_OFF,
+    PROFILE_LINE,
+    PROFILE_JSON
+} ProfileFormat;
+
+// A horizon plan refills a session per day and its own arena
+#define PROFILE_MAX_ARENAS 32
+
+typedef struct {
+    uint64_t micros[PHASE_COUNT];
+    uint64_t startMicros;
+    uint64_t cells;
+    uint64_t improvements;
+    const Arena *arena;         // the request's
+    const Arena *sessions[PROFILE_MAX_ARENAS];   // refilled by the request
+    int sessionCount;
+    size_t heapBytes;           // held outside the arenas
+    size_t peakBytes;
+} PhaseProfile;
+
+static const char *const phaseLineNames[PHASE_COUNT] = {
+    "read_us", "parse_us", "sort_us", "fill_us", "backtrack_us", "output_us"
+};
+static const char *const phaseJsonNames[PHASE_COUNT] = {
+    "readUs", "parseUs", "sortUs", "fillUs", "backtrackUs", "outputUs"
+};
+
+// Set once from the command line, before any worker starts
+static ProfileFormat profileFormat = PROFILE_OFF;
+// The request the calling thread is running, NULL when not profiling
+static PROFILE_THREAD_LOCAL PhaseProfile *currentProfile;
+
+static inline long peakResidentKB(void) {
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss;
+#endif
+}
+
+static inline uint64_t phaseBegin(void) {
+    return currentProfile ? monotonicMicros() : 0;
+}
+
+static inline void phaseEnd(Phase phase, uint64_t start) {
+    if (currentProfile) currentProfile->micros[phase] += monotonicMicros() - start;
+}
+
+static inline void profileCount(uint64_t cells, uint64_t improvements) {
+    if (!currentProfile) return;
+    currentProfile->cells += cells;
+    currentProfile->improvements += improvements;
+}
+
+static inline int profileActive(void) {
+    return currentProfile != NULL;
+}
+
+static inline void profilePeak(PhaseProfile *profile) {
+    size_t bytes = profile->arena->usedBytes + profile->heapBytes;
+    for (int s = 0; s < profile->sessionCount; s++) bytes += profile->sessions[s]->usedBytes;
+    if (bytes > profile->peakBytes) profile->peakBytes = bytes;
+}
+
+// Counts a long-lived arena the request has just reset toward its peak.
+static inline void profileArena(const Arena *arena) {
+    PhaseProfile *profile = currentProfile;
+    if (!profile || profile->sessionCount == PROFILE_MAX_ARENAS) return;
+    for (int s = 0; s < profile->sessionCount; s++) {
+        if (profile->sessions[s] == arena) return;
+    }
+    profile->sessions[profile->sessionCount++] = arena;
+}
+
+// Heap taken and given back outside the request arena. Frees of buffers
+// that outlive a request, like the incremental engine's, may exceed what
+// this request took.
+static inline void profileAlloc(size_t bytes) {
+    if (!currentProfile) return;
+    currentProfile->heapBytes += bytes;
+    profilePeak(currentProfile);
+}
+
+static inline void profileFree(size_t bytes) {
+    if (!currentProfile) return;
+    profilePeak(currentProfile);
+    currentProfile->heapBytes -= bytes < currentProfile->heapBytes ? bytes
+                                                                   : currentProfile->heapBytes;
+}
+
+// Starts profiling a request on the calling thread, if --profile is on.
+// arena is the request's, empty at this point.
+static inline void profileBegin(PhaseProfile *profile, const Arena *arena) {
+    if (profileFormat == PROFILE_OFF) return;
+    memset(profile, 0, sizeof(*profile));
+    profile->startMicros = monotonicMicros();
+    profile->arena = arena;
+    currentProfile = profile;
+}
+
+// Writes the request's profile, in one call so lines from batch workers do
+// not interleave, and stops profiling.
+static inline void profileEnd(int ok) {
+    PhaseProfile *profile = currentProfile;
+    char text[640];
+    int used;
+
+    if (!profile) return;
+    profilePeak(profile);
+    currentProfile = NULL;
+    uint64_t total = monotonicMicros() - profile->startMicros;
+    int json = profileFormat == PROFILE_JSON;
+
+    used = snprintf(text, sizeof(text), json ? "{\"profile\":{\"ok\":%d" : "profile ok=%d", ok);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        used += snprintf(text + used, sizeof(text) - (size_t)used,
+                         json ? ",\"%s\":%llu" : " %s=%llu",
+                         json ? phaseJsonNames[phase] : phaseLineNames[phase],
+                         (unsigned long long)profile->micros[phase]);
+    }
+    snprintf(text + used, sizeof(text) - (size_t)used,
+             json ? ",\"totalUs\":%llu,\"cells\":%llu,\"improvements\":%llu,"
+                    "\"peakHeapBytes\":%zu,\"peakRssKb\":%ld}}\n"
+                  : " total_us=%llu cells=%llu improvements=%llu peak_heap_bytes=%zu "
+                    "peak_rss_kb=%ld\n",
+             (unsigned long long)total, (unsigned long long)profile->cells,
+             (unsigned long long)profile->improvements, profile->peakBytes, peakResidentKB());
+    fputs(text, stderr);
+}
+
+#endif
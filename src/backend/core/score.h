@@ -0,0 +1,23 @@
+#ifndef SMARTFARM_SCORE_H
+#define SMARTFARM_SCORE_H
+
+#include <stdint.h>
+
+#include "farm.h"
+
+// Fixed-point objective shared by the exact schedulers, so their scores can
+// be compared bit for bit.
+
+#define SCORE_SHIFT 32
+
+// Fixed-point score, in units of 2^-SCORE_SHIFT.
+typedef int64_t Score;
+
+// Score per unit of water for a field with waterNeeded > 0:
+// (100 - moisture) / waterNeeded, rounded to nearest.
+static inline Score fieldRate(const Field *field) {
+    int64_t numerator = (int64_t)(100 - field->moisture) << SCORE_SHIFT;
+    return (numerator + field->waterNeeded / 2) / field->waterNeeded;
+}
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef SMARTFARM_SERVE_H
+#define SMARTFARM_SERVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "arena.h"
+#include "batch.h"
+#include "emit.h"
+#include "json.h"
+#include "latency.h"
+#include "profile.h"
+#include "snapshot.h"
+
+typedef enum {
+    SERVE_ONCE,
+    SERVE_STDIN,
+    SERVE_SOCKET,
+    SERVE_BATCH
+} ServeMode;
+
+typedef struct {
+    ServeMode mode;
+    const char *socketPath;
+    const char *batchPath;
+    int workers;
+    OutputFormat format;
+    ProfileFormat profile;
+    const char *snapshotPath;   // --snapshot: requests are deltas on this farm
+} ServeOptions;
+
+// The snapshot runScheduler mapped for --snapshot, NULL without one. Shared
+// read-only by every request and batch worker.
+static const FarmSnapshot *servedSnapshot = NULL;
+
+// Reads a request: a full JSON request, or with --snapshot a delta on the
+// mapped farm (see snapshot.h). Same contract as parseIrrigationInput.
+static inline int parseServedInput(const char *input, size_t length, IrrigationData *data,
+                                   Arena *arena) {
+    if (servedSnapshot) return parseSnapshotInput(servedSnapshot, input, length, data, arena);
+    return parseIrrigationInput(input, length, data, arena);
+}
+
+// True for a {"command":"<name>"} request, such as {"command":"stats"},
+// which asks the worker for its counters instead of a schedule.
+static inline int isCommand(const char *line, size_t length, const char *name) {
+    JsonCursor json;
+    JsonSlice key, value;
+    int first = 1;
+
+    jsonInit(&json, line, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        if (jsonSliceEquals(key, "command")) {
+            return jsonPeek(&json) == '"' && jsonString(&json, &value) &&
+                   jsonSliceEquals(value, name);
+        }
+        if (!jsonSkipValue(&json)) return 0;
+    }
+    return 0;
+}
+
+// Reads one line into the growable *line buffer (newline stripped).
+// Returns 0 at end of input.
+static inline int readLine(FILE *in, char **line, size_t *capacity, size_t *length) {
+    size_t used = 0;
+
+    for (;;) {
+        if (*capacity - used < 2) {
+            size_t grown = *capacity ? *capacity * 2 : 4096;
+            char *next = realloc(*line, grown);
+            if (!next) return 0;
+            *line = next;
+            *capacity = grown;
+        }
+        if (!fgets(*line + used, (int)(*capacity - used), in)) break;
+        used += strlen(*line + used);
+        if (used > 0 && (*line)[used - 1] == '\n') break;
+    }
+    if (used == 0 && feof(in)) return 0;
+
+    while (used > 0 && ((*line)[used - 1] == '\n' || (*line)[used - 1] == '\r')) used--;
+    (*line)[used] = '\0';
+    *length = used;
+    return 1;
+}
+
+// Newline-delimited JSON loop: one request per input line, one response per
+// output line, flushed after each. The line buffer and the arena blocks are
+// reused for every request.
+static inline void serveStream(FILE *in, FILE *out, RequestHandler handler, void *context,
+                               Arena *arena, LatencyCounters *counters) {
+    char *line = NULL;
+    size_t capacity = 0, length = 0;
+
+    while (readLine(in, &line, &capacity, &length)) {
+        if (length == 0) continue;
+        if (isCommand(line, length, "stats")) {
+            latencyWrite(out, counters);
+            fflush(out);
+            continue;
+        }
+
+        PhaseProfile profile;
+        uint64_t start = monotonicMicros();
+        profileBegin(&profile, arena);
+        int ok = handler(line, length, out, arena, context);
+        fflush(out);
+        profileEnd(ok);
+        latencyRecord(counters, monotonicMicros() - start, ok);
+        arenaReset(arena);
+    }
+    free(line);
+}
+
+// Accepts connections on a Unix domain socket and serves each one as an
+// NDJSON stream, one connection at a time.
+static inline int serveUnixSocket(const char *path, RequestHandler handler, void *context,
+                                  Arena *arena, LatencyCounters *counters) {
+#ifdef _WIN32
+    (void)handler;
+    (void)context;
+    (void)arena;
+    (void)counters;
+    fprintf(stderr, "Error: Unix socket mode is not supported on Windows: %s\n", path);
+    return 0;
+#else
+    struct sockaddr_un address;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0 || strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Cannot create socket %s\n", path);
+        if (listener >= 0) close(listener);
+        return 0;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, 16) != 0) {
+        fprintf(stderr, "Error: Cannot listen on socket %s\n", path);
+        close(listener);
+        return 0;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int connection = accept(listener, NULL, NULL);
+        if (connection < 0) continue;
+
+        int writeSide = dup(connection);
+        FILE *in = fdopen(connection, "r");
+        FILE *out = writeSide >= 0 ? fdopen(writeSide, "w") : NULL;
+        if (in && out) {
+            serveStream(in, out, handler, context, arena, counters);
+        }
+        if (in) fclose(in); else close(connection);
+        if (out) fclose(out); else if (writeSide >= 0) close(writeSide);
+    }
+#endif
+}
+
+static inline void serveOptionsInit(ServeOptions *options) {
+    options->mode = SERVE_ONCE;
+    options->socketPath = NULL;
+    options->batchPath = NULL;
+    options->workers = 0;
+    options->format = OUTPUT_PRETTY;
+    options->profile = PROFILE_OFF;
+    options->snapshotPath = NULL;
+}
+
+// Consumes --serve (NDJSON on stdin/stdout), --socket PATH, --batch PATH
+// (JSON array or NDJSON file, "-" for stdin), --workers N, --format
+// pretty|compact|binary, --profile line|json or --snapshot PATH at
+// argv[*index]. Returns 0 if the argument is not a serve option.
+static inline int parseServeOption(int argc, char **argv, int *index, ServeOptions *options) {
+    if (strcmp(argv[*index], "--serve") == 0) {
+        options->mode = SERVE_STDIN;
+        return 1;
+    }
+    if (strcmp(argv[*index], "--socket") == 0 && *index + 1 < argc) {
+        options->mode = SERVE_SOCKET;
+        options->socketPath = argv[++*index];
+        return 1;
+    }
+    if (strcmp(argv[*index], "--batch") == 0 && *index + 1 < argc) {
+        options->mode = SERVE_BATCH;
+        options->batchPath = argv[++*index];
+        return 1;
+    }
+    if (strcmp(argv[*index], "--workers") == 0 && *index + 1 < argc) {
+        options->workers = atoi(argv[++*index]);
+        return 1;
+    }
+    if (strcmp(argv[*index], "--format") == 0 && *index + 1 < argc) {
+        const char *name = argv[++*index];
+        if (strcmp(name, "pretty") == 0) {
+            options->format = OUTPUT_PRETTY;
+        } else if (strcmp(name, "compact") == 0) {
+            options->format = OUTPUT_COMPACT;
+        } else if (strcmp(name, "binary") == 0) {
+            options->format = OUTPUT_BINARY;
+        } else {
+            // Leave the value in argv so the caller reports it as unknown.
+            --*index;
+            return 0;
+        }
+        return 1;
+    }
+    if (strcmp(argv[*index], "--snapshot") == 0 && *index + 1 < argc) {
+        options->snapshotPath = argv[++*index];
+        return 1;
+    }
+    if (strcmp(argv[*index], "--profile") == 0 && *index + 1 < argc) {
+        const char *name = argv[++*index];
+        if (strcmp(name, "line") == 0) {
+            options->profile = PROFILE_LINE;
+        } else if (strcmp(name, "json") == 0) {
+            options->profile = PROFILE_JSON;
+        } else {
+            --*index;
+            return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Output format for responses. Every mode except the one-shot run writes one
+// response per line, so pretty output is compacted there.
+static inline OutputFormat serveOutputFormat(const ServeOptions *options) {
+    if (options->mode != SERVE_ONCE && options->format == OUTPUT_PRETTY) {
+        return OUTPUT_COMPACT;
+    }
+    return options->format;
+}
+
+// Shared main body: one request from stdin by default, a persistent worker
+// loop in the serve modes, or a whole batch on a worker pool. Returns the
+// process exit code.
+static inline int runScheduler(const ServeOptions *options, RequestHandler handler, void *context) {
+    Arena arena;
+    LatencyCounters counters;
+    FarmSnapshot snapshot;
+    int ok = 1;
+
+    if (options->snapshotPath) {
+        if (!snapshotOpen(options->snapshotPath, &snapshot)) {
+            printf("{\"error\":\"Cannot open snapshot\"}\n");
+            return 1;
+        }
+        servedSnapshot = &snapshot;
+    }
+    arenaInit(&arena);
+    memset(&counters, 0, sizeof(counters));
+    profileFormat = options->profile;
+
+    if (options->mode == SERVE_STDIN) {
+        serveStream(stdin, stdout, handler, context, &arena, &counters);
+    } else if (options->mode == SERVE_SOCKET) {
+        ok = serveUnixSocket(options->socketPath, handler, context, &arena, &counters);
+    } else if (options->mode == SERVE_BATCH) {
+        ok = runBatch(options->batchPath, options->workers, handler, context, stdout);
+    } else {
+        PhaseProfile profile;
+        size_t inputLength = 0;
+        profileBegin(&profile, &arena);
+        uint64_t start = phaseBegin();
+        char *input = arenaReadStream(&arena, stdin, &inputLength);
+        phaseEnd(PHASE_READ, start);
+        if (!input) {
+            fprintf(stderr, "Error: Out of memory reading input\n");
+            printf("{\"error\":\"Out of memory\"}\n");
+            ok = 0;
+        } else if (inputLength == 0) {
+            fprintf(stderr, "Error: No input received\n");
+            printf("{\"error\":\"No input received\"}\n");
+            ok = 0;
+        } else {
+            ok = handler(input, inputLength, stdout, &arena, context);
+        }
+        fflush(stdout);
+        profileEnd(ok);
+    }
+
+    arenaRelease(&arena);
+    if (servedSnapshot) {
+        servedSnapshot = NULL;
+        snapshotClose(&snapshot);
+    }
+    return ok ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef SMARTFARM_SNAPSHOT_H
+#define SMARTFARM_SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "arena.h"
+#include "farm.h"
+#include "json.h"
+#include "profile.h"
+
+// Binary farm snapshot: the field set of a request, mapped straight into
+// memory so a run skips the JSON parse. Only moisture moves between runs,
+// so a request against a snapshot is a small delta in the update command's
+// shape, with the budgets optional:
+//
+//   {"totalWater": 5000, "fields": [{"name": "Field 7", "moisture": 41},
+//                                   {"index": 3, "waterNeeded": 120}]}
+//
+// Fields the delta does not name keep the snapshot's readings, and so do
+// the budgets; {} schedules the snapshot as written.
+//
+// Layout, in host byte order, every section on a 64-byte boundary:
+//
+//   SnapshotHeader
+//   int32_t  moisture[fieldCount]
+//   int32_t  waterNeeded[fieldCount]
+//   uint32_t nameOffsets[fieldCount + 1]   field i's name is
+//   char     names[nameBytes]              names[off[i] .. off[i + 1])
+//   int32_t  nameIndex[nameBuckets]        open-addressed, -1 for empty
+//
+// Names are kept JSON-escaped, as the parser leaves them, so the emitters
+// copy them out unchanged. The name index resolves a delta's names without
+// building anything at load; a repeated name finds its first field.
+
+#define SNAPSHOT_MAGIC "SFSNAP\r\n"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_ALIGN 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;         // SNAPSHOT_BYTE_ORDER as the writer saw it
+    int32_t fieldCount;
+    int32_t totalWater;
+    int32_t totalElectricity;
+    int32_t waterDeliveryRate;
+    uint32_t nameBuckets;       // power of two
+    uint32_t nameBytes;
+    uint64_t moistureOffset;
+    uint64_t needOffset;
+    uint64_t nameOffsetsOffset;
+    uint64_t namesOffset;
+    uint64_t nameIndexOffset;
+    uint64_t fileSize;
+} SnapshotHeader;
+
+typedef struct {
+    const unsigned char *base;
+    size_t size;
+    int mapped;                 // 1 for mmap, 0 for a malloc'd copy
+    const SnapshotHeader *header;
+    const int32_t *moisture;
+    const int32_t *waterNeeded;
+    const uint32_t *nameOffsets;
+    const char *names;
+    const int32_t *nameIndex;
+} FarmSnapshot;
+
+static inline uint32_t snapshotNameHash(const char *name, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return hash;
+}
+
+static inline uint64_t snapshotAlign(uint64_t offset) {
+    return (offset + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+static inline int snapshotWriteSection(FILE *out, uint64_t *written, uint64_t offset,
+                                       const void *data, size_t size) {
+    static const unsigned char padding[SNAPSHOT_ALIGN];
+    while (*written < offset) {
+        size_t gap = (size_t)(offset - *written);
+        if (gap > sizeof(padding)) gap = sizeof(padding);
+        if (fwrite(padding, 1, gap, out) != gap) return 0;
+        *written += gap;
+    }
+    if (size > 0 && fwrite(data, 1, size, out) != size) return 0;
+    *written += size;
+    return 1;
+}
+
+// Writes the fields and budgets of a parsed request. Returns 0 if out of
+// memory, the names do not fit 32-bit offsets, or the write fails.
+static inline int snapshotWrite(FILE *out, const IrrigationData *data, Arena *arena) {
+    size_t count = (size_t)data->fieldCount;
+    uint64_t nameBytes = 0;
+    uint32_t buckets = 16;
+    SnapshotHeader header;
+
+    for (size_t i = 0; i < count; i++) nameBytes += (uint64_t)data->fields[i].nameLength;
+    if (nameBytes > UINT32_MAX) {
+        fprintf(stderr, "Error: Field names too long for a snapshot\n");
+        return 0;
+    }
+    while (buckets < 2 * count) buckets <<= 1;
+
+    int32_t *moisture = arenaAlloc(arena, (count + 1) * sizeof(int32_t));
+    int32_t *waterNeeded = arenaAlloc(arena, (count + 1) * sizeof(int32_t));
+    uint32_t *nameOffsets = arenaAlloc(arena, (count + 1) * sizeof(uint32_t));
+    char *names = arenaAlloc(arena, (size_t)nameBytes + 1);
+    int32_t *nameIndex = arenaAlloc(arena, (size_t)buckets * sizeof(int32_t));
+    if (!moisture || !waterNeeded || !nameOffsets || !names || !nameIndex) return 0;
+
+    memset(nameIndex, 0xff, (size_t)buckets * sizeof(int32_t));
+    nameOffsets[0] = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Field *field = &data->fields[i];
+        moisture[i] = field->moisture;
+        waterNeeded[i] = field->waterNeeded;
+        memcpy(names + nameOffsets[i], field->name, (size_t)field->nameLength);
+        nameOffsets[i + 1] = nameOffsets[i] + (uint32_t)field->nameLength;
+
+        uint32_t slot = snapshotNameHash(field->name, field->nameLength) & (buckets - 1);
+        int repeated = 0;
+        while (nameIndex[slot] >= 0 && !repeated) {
+            const Field *other = &data->fields[nameIndex[slot]];
+            repeated = other->nameLength == field->nameLength &&
+                       memcmp(other->name, field->name, (size_t)field->nameLength) == 0;
+            if (!repeated) slot = (slot + 1) & (buckets - 1);
+        }
+        if (!repeated) nameIndex[slot] = (int32_t)i;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.fieldCount = data->fieldCount;
+    header.totalWater = data->totalWater;
+    header.totalElectricity = data->totalElectricity;
+    header.waterDeliveryRate = data->waterDeliveryRate;
+    header.nameBuckets = buckets;
+    header.nameBytes = (uint32_t)nameBytes;
+    header.moistureOffset = snapshotAlign(sizeof(header));
+    header.needOffset = snapshotAlign(header.moistureOffset + count * sizeof(int32_t));
+    header.nameOffsetsOffset = snapshotAlign(header.needOffset + count * sizeof(int32_t));
+    header.namesOffset = snapshotAlign(header.nameOffsetsOffset + (count + 1) * sizeof(uint32_t));
+    header.nameIndexOffset = snapshotAlign(header.namesOffset + nameBytes);
+    header.fileSize = header.nameIndexOffset + (uint64_t)buckets * sizeof(int32_t);
+
+    uint64_t written = 0;
+    return snapshotWriteSection(out, &written, 0, &header, sizeof(header)) &&
+           snapshotWriteSection(out, &written, header.moistureOffset, moisture,
+                                count * sizeof(int32_t)) &&
+           snapshotWriteSection(out, &written, header.needOffset, waterNeeded,
+                                count * sizeof(int32_t)) &&
+           snapshotWriteSection(out, &written, header.nameOffsetsOffset, nameOffsets,
+                                (count + 1) * sizeof(uint32_t)) &&
+           snapshotWriteSection(out, &written, header.namesOffset, names, (size_t)nameBytes) &&
+           snapshotWriteSection(out, &written, header.nameIndexOffset, nameIndex,
+                                (size_t)buckets * sizeof(int32_t)) &&
+           fflush(out) == 0;
+}
+
+static inline int snapshotSectionFits(const SnapshotHeader *header, uint64_t offset,
+                                      uint64_t size) {
+    return offset % sizeof(int32_t) == 0 && offset <= header->fileSize &&
+           size <= header->fileSize - offset;
+}
+
+// Checks the header against the file, so every later read stays inside it.
+// The name offsets are checked as the fields are loaded.
+static inline int snapshotCheck(FarmSnapshot *snapshot) {
+    const SnapshotHeader *header = (const SnapshotHeader *)snapshot->base;
+    uint64_t count;
+
+    if (snapshot->size < sizeof(SnapshotHeader) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        fprintf(stderr, "Error: Not a farm snapshot\n");
+        return 0;
+    }
+    if (header->version != SNAPSHOT_VERSION || header->byteOrder != SNAPSHOT_BYTE_ORDER) {
+        fprintf(stderr, "Error: Snapshot version %u or byte order is not supported\n",
+                header->version);
+        return 0;
+    }
+    count = header->fieldCount > 0 ? (uint64_t)header->fieldCount : 0;
+    if (header->fieldCount <= 0 || header->fileSize != snapshot->size ||
+        header->nameBuckets == 0 || (header->nameBuckets & (header->nameBuckets - 1)) != 0 ||
+        !snapshotSectionFits(header, header->moistureOffset, count * sizeof(int32_t)) ||
+        !snapshotSectionFits(header, header->needOffset, count * sizeof(int32_t)) ||
+        !snapshotSectionFits(header, header->nameOffsetsOffset, (count + 1) * sizeof(uint32_t)) ||
+        header->namesOffset > header->fileSize ||
+        header->nameBytes > header->fileSize - header->namesOffset ||
+        !snapshotSectionFits(header, header->nameIndexOffset,
+                             (uint64_t)header->nameBuckets * sizeof(int32_t))) {
+        fprintf(stderr, "Error: Snapshot is truncated or corrupt\n");
+        return 0;
+    }
+
+    snapshot->header = header;
+    snapshot->moisture = (const int32_t *)(snapshot->base + header->moistureOffset);
+    snapshot->waterNeeded = (const int32_t *)(snapshot->base + header->needOffset);
+    snapshot->nameOffsets = (const uint32_t *)(snapshot->base + header->nameOffsetsOffset);
+    snapshot->names = (const char *)(snapshot->base + header->namesOffset);
+    snapshot->nameIndex = (const int32_t *)(snapshot->base + header->nameIndexOffset);
+    return 1;
+}
+
+static inline void snapshotClose(FarmSnapshot *snapshot) {
+#ifndef _WIN32
+    if (snapshot->mapped) munmap((void *)snapshot->base, snapshot->size);
+#endif
+    if (!snapshot->mapped) free((void *)snapshot->base);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// Maps the snapshot read-only (reads it into memory on Windows). Returns 0,
+// with the reason on stderr, if it cannot be opened or is not a snapshot.
+static inline int snapshotOpen(const char *path, FarmSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+#ifdef _WIN32
+    FILE *file = fopen(path, "rb");
+    long size;
+    if (!file || fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 ||
+        fseek(file, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "Error: Cannot open snapshot %s\n", path);
+        if (file) fclose(file);
+        return 0;
+    }
+    unsigned char *copy = malloc((size_t)size);
+    if (!copy || fread(copy, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "Error: Cannot read snapshot %s\n", path);
+        free(copy);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    snapshot->base = copy;
+    snapshot->size = (size_t)size;
+#else
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size <= 0) {
+        fprintf(stderr, "Error: Cannot open snapshot %s\n", path);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map snapshot %s\n", path);
+        return 0;
+    }
+    snapshot->base = base;
+    snapshot->size = (size_t)info.st_size;
+    snapshot->mapped = 1;
+#endif
+    if (!snapshotCheck(snapshot)) {
+        snapshotClose(snapshot);
+        return 0;
+    }
+    return 1;
+}
+
+// Field index for a JSON-escaped name, or -1.
+static inline int snapshotFindField(const FarmSnapshot *snapshot, const char *name, int length) {
+    uint32_t mask = snapshot->header->nameBuckets - 1;
+    uint32_t slot = snapshotNameHash(name, length) & mask;
+
+    for (uint32_t probe = 0; probe <= mask; probe++) {
+        int32_t index = snapshot->nameIndex[slot];
+        if (index < 0 || index >= snapshot->header->fieldCount) return -1;
+        uint32_t begin = snapshot->nameOffsets[index];
+        uint32_t end = snapshot->nameOffsets[index + 1];
+        if (end - begin == (uint32_t)length &&
+            memcmp(snapshot->names + begin, name, (size_t)length) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// Applies one {"index"|"name", "moisture", "waterNeeded"} entry.
+static inline int applySnapshotUpdate(JsonCursor *json, const FarmSnapshot *snapshot,
+                                      IrrigationData *data) {
+    JsonSlice key;
+    JsonSlice name = {NULL, 0};
+    int first = 1;
+    int index = -1, named = 0, hasMoisture = 0, hasNeed = 0;
+    int moisture = 0, waterNeeded = 0;
+
+    if (!jsonConsume(json, '{')) return 0;
+    while (jsonNextKey(json, &first, &key)) {
+        int ok;
+        if (jsonSliceEquals(key, "index")) {
+            ok = jsonInt(json, &index);
+        } else if (jsonSliceEquals(key, "name") && jsonPeek(json) == '"') {
+            ok = jsonString(json, &name);
+            named = 1;
+        } else if (jsonSliceEquals(key, "moisture")) {
+            ok = jsonInt(json, &moisture);
+            hasMoisture = 1;
+        } else if (jsonSliceEquals(key, "waterNeeded")) {
+            ok = jsonInt(json, &waterNeeded);
+            hasNeed = 1;
+        } else {
+            ok = jsonSkipValue(json);
+        }
+        if (!ok) return 0;
+    }
+    if (json->error) return 0;
+
+    if (index < 0 && named) index = snapshotFindField(snapshot, name.ptr, name.length);
+    if (index < 0 || index >= data->fieldCount) {
+        fprintf(stderr, "Error: Update names no field of the snapshot\n");
+        return 0;
+    }
+    if (hasMoisture) data->fields[index].moisture = moisture;
+    if (hasNeed) data->fields[index].waterNeeded = waterNeeded;
+    return 1;
+}
+
+// Builds the request from the snapshot and a delta. The Field records are
+// copied out of the arrays; names point into the snapshot, which has to
+// stay open while the request is in use. Same contract as
+// parseIrrigationInput.
+static inline int parseSnapshotText(const FarmSnapshot *snapshot, const char *input,
+                                    size_t length, IrrigationData *data, Arena *arena) {
+    const SnapshotHeader *header = snapshot->header;
+    size_t count = (size_t)header->fieldCount;
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+    int ok = 1;
+
+    memset(data, 0, sizeof(*data));
+    data->fields = arenaAlloc(arena, count * sizeof(Field));
+    if (!data->fields) {
+        fprintf(stderr, "Error: Out of memory loading the snapshot\n");
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        Field *field = &data->fields[i];
+        uint32_t begin = snapshot->nameOffsets[i];
+        uint32_t end = snapshot->nameOffsets[i + 1];
+        if (end < begin || end > header->nameBytes) {
+            fprintf(stderr, "Error: Snapshot is truncated or corrupt\n");
+            return 0;
+        }
+        memset(field, 0, sizeof(*field));
+        field->name = snapshot->names + begin;
+        field->nameLength = (int)(end - begin);
+        field->moisture = snapshot->moisture[i];
+        field->waterNeeded = snapshot->waterNeeded[i];
+        field->originalIndex = (int)i;
+    }
+    data->fieldCount = header->fieldCount;
+    data->totalWater = header->totalWater;
+    data->totalElectricity = header->totalElectricity;
+    data->waterDeliveryRate = header->waterDeliveryRate;
+
+    jsonInit(&json, input, length);
+    if (jsonConsume(&json, '{')) {
+        while (ok && jsonNextKey(&json, &first, &key)) {
+            if (jsonSliceEquals(key, "totalWater")) {
+                ok = parseIntMember(&json, &data->totalWater);
+            } else if (jsonSliceEquals(key, "totalElectricity")) {
+                ok = parseIntMember(&json, &data->totalElectricity);
+            } else if (jsonSliceEquals(key, "waterDeliveryRate")) {
+                ok = parseIntMember(&json, &data->waterDeliveryRate);
+            } else if (jsonSliceEquals(key, "deadlineMs")) {
+                ok = parseIntMember(&json, &data->deadlineMs);
+            } else if (jsonSliceEquals(key, "fields") && jsonPeek(&json) == '[') {
+                int firstElement = 1;
+                json.cur++;
+                while (ok && jsonNextElement(&json, &firstElement)) {
+                    ok = applySnapshotUpdate(&json, snapshot, data);
+                }
+            } else {
+                ok = jsonSkipValue(&json);
+            }
+        }
+    }
+    if (!ok && !json.error) return 0;
+    if (json.error) {
+        fprintf(stderr, "Error: Malformed JSON near offset %ld\n", jsonOffset(&json));
+        return 0;
+    }
+    return validateIrrigationInput(data, data->fieldCount, 1);
+}
+
+static inline int parseSnapshotInput(const FarmSnapshot *snapshot, const char *input,
+                                     size_t length, IrrigationData *data, Arena *arena) {
+    uint64_t start = phaseBegin();
+    int ok = parseSnapshotText(snapshot, input, length, data, arena);
+    phaseEnd(PHASE_PARSE, start);
+    return ok;
+}
+
+#endif
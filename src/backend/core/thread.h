@@ -0,0 +1,117 @@
+#ifndef SMARTFARM_THREAD_H
+#define SMARTFARM_THREAD_H
+
+// Minimal portable threading layer: Win32 threads and condition variables
+// on Windows, pthreads elsewhere.
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+typedef HANDLE ThreadHandle;
+typedef CRITICAL_SECTION PoolMutex;
+typedef CONDITION_VARIABLE PoolCond;
+#define poolMutexInit(m) InitializeCriticalSection(m)
+#define poolMutexDestroy(m) DeleteCriticalSection(m)
+#define poolLock(m) EnterCriticalSection(m)
+#define poolUnlock(m) LeaveCriticalSection(m)
+#define poolCondInit(c) InitializeConditionVariable(c)
+#define poolCondDestroy(c) ((void)(c))
+#define poolWait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define poolBroadcast(c) WakeAllConditionVariable(c)
+#define poolSignal(c) WakeConditionVariable(c)
+#else
+typedef pthread_t ThreadHandle;
+typedef pthread_mutex_t PoolMutex;
+typedef pthread_cond_t PoolCond;
+#define poolMutexInit(m) pthread_mutex_init(m, NULL)
+#define poolMutexDestroy(m) pthread_mutex_destroy(m)
+#define poolLock(m) pthread_mutex_lock(m)
+#define poolUnlock(m) pthread_mutex_unlock(m)
+#define poolCondInit(c) pthread_cond_init(c, NULL)
+#define poolCondDestroy(c) pthread_cond_destroy(c)
+#define poolWait(c, m) pthread_cond_wait(c, m)
+#define poolBroadcast(c) pthread_cond_broadcast(c)
+#define poolSignal(c) pthread_cond_signal(c)
+#endif
+
+#ifdef _WIN32
+typedef DWORD ThreadResult;
+#define THREAD_CALL WINAPI
+#else
+typedef void *ThreadResult;
+#define THREAD_CALL
+#endif
+
+typedef ThreadResult (THREAD_CALL *ThreadMain)(void *arg);
+
+static inline int threadCreate(ThreadHandle *thread, ThreadMain main, void *arg) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, main, arg, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, main, arg) == 0;
+#endif
+}
+
+static inline void threadJoin(ThreadHandle thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+// 64-bit atomics for counters and bounds shared between workers.
+static inline int64_t atomicLoad64(volatile int64_t *target) {
+#ifdef _WIN32
+    return InterlockedCompareExchange64((volatile LONG64 *)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline int64_t atomicAdd64(volatile int64_t *target, int64_t amount) {
+#ifdef _WIN32
+    return InterlockedExchangeAdd64((volatile LONG64 *)target, amount) + amount;
+#else
+    return __atomic_add_fetch(target, amount, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Raises *target to value if it is larger.
+static inline void atomicMax64(volatile int64_t *target, int64_t value) {
+    int64_t seen = atomicLoad64(target);
+    while (value > seen) {
+#ifdef _WIN32
+        int64_t previous = InterlockedCompareExchange64((volatile LONG64 *)target, value, seen);
+        if (previous == seen) return;
+        seen = previous;
+#else
+        if (__atomic_compare_exchange_n(target, &seen, value, 0, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            return;
+        }
+#endif
+    }
+}
+
+static inline int onlineCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+#endif
@@ -0,0 +1,547 @@
+#ifndef SMARTFARM_ZONES_H
+#define SMARTFARM_ZONES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "dp.h"
+#include "farm.h"
+#include "json.h"
+#include "latency.h"
+#include "score.h"
+#include "thread.h"
+
+// Zone decomposition of the DP. Fields only interact through the shared
+// water budget, so each zone is solved on its own: a lean DP over the
+// zone's fields, with the budget capped at what the zone can use, gives
+// its value-versus-water curve (the best score over budgets up to w, as in
+// frontier.h). A tree of max-plus convolutions then splits totalWater
+// between the zones. The score is the flat DP's, bit for bit, and so is
+// the water used: the split is walked back from the smallest budget that
+// reaches the optimum.
+//
+// A field joins the zone its "zone" names; the rest go into zones of
+// fieldsPerZone in input order. Zones are solved and pairs of curves are
+// merged on `threads` workers, each with its own arena, so a zone's table
+// stays small enough to live in cache.
+//
+// Merging A and B exactly costs |A| x |B| in general. The DP curves are
+// concave but for the dents the minimum allocations make, so each merge
+// bounds both curves by their concave hulls and, for every budget, only
+// looks at the splits that bound cannot rule out (see zoneMergeCurves):
+// a few per budget where the curves are concave.
+
+#define ZONE_DEFAULT_FIELDS 64
+
+typedef struct {
+    int zones;
+    int threadsUsed;
+    int largestZone;            // fields in the biggest zone
+    size_t peakZoneTableBytes;  // the largest table a single zone solve built
+    int64_t zoneCells;          // DP cells over all zones
+    int64_t flatCells;          // what the flat DP fills
+    Score hullGap;              // the most a merged curve fell below its concave hull
+    int64_t mergeSteps;         // candidate splits looked at
+    Score bestScore;
+    uint64_t solveMicros;
+    uint64_t mergeMicros;
+} ZoneStats;
+
+// A zone's curve, or the merge of two: curve[w] for w in 0..length.
+typedef struct {
+    Score *curve;
+    int length;
+    int left, right;            // children, -1 for a zone
+    int *split;                 // merge: water the right child gets at w
+    int *bestAt;                // zone: the exact budget that curve[w] comes from
+    IrrigationData data;        // zone: its fields, in priority order
+    int *fieldIndex;            // zone: each field's index in the request
+    const int *order;           // zone: identity order for the DP
+    DPTables tables;
+    DPStats dpStats;
+} ZoneNode;
+
+typedef struct ZoneRun ZoneRun;
+typedef int (*ZoneJobFn)(ZoneRun *run, int job, int worker);
+
+struct ZoneRun {
+    IrrigationData *data;
+    const DPOptions *options;
+    ZoneNode *nodes;
+    int *members;               // field indices grouped by zone, priority order within
+    int *memberStart;           // zone z: members[memberStart[z] .. memberStart[z + 1])
+    int *jobNodes;              // merge level: node each job builds
+    Arena *arenas;              // one per worker
+    int threads;
+    ZoneStats *stats;
+    // Current batch of jobs
+    ZoneJobFn job;
+    int jobCount;
+    volatile int64_t nextJob;
+    volatile int64_t failed;
+    volatile int64_t hullGap;
+    volatile int64_t mergeSteps;
+};
+
+typedef struct {
+    ZoneRun *run;
+    int worker;
+} ZoneWorkerArg;
+
+static inline void zoneWorkerLoop(ZoneRun *run, int worker) {
+    for (;;) {
+        int64_t job = atomicAdd64(&run->nextJob, 1) - 1;
+        if (job >= run->jobCount || atomicLoad64(&run->failed)) return;
+        if (!run->job(run, (int)job, worker)) atomicAdd64(&run->failed, 1);
+    }
+}
+
+static ThreadResult THREAD_CALL zoneThreadMain(void *arg) {
+    ZoneWorkerArg *worker = arg;
+    zoneWorkerLoop(worker->run, worker->worker);
+    return 0;
+}
+
+// Runs jobs 0..count-1 on the workers, the caller being worker 0. Returns 0
+// if a job failed.
+static inline int zoneRunJobs(ZoneRun *run, ZoneJobFn job, int count) {
+    ThreadHandle threads[MAX_THREADS];
+    ZoneWorkerArg args[MAX_THREADS];
+    int workers = run->threads < count ? run->threads : count;
+    int started = 0;
+
+    run->job = job;
+    run->jobCount = count;
+    run->nextJob = 0;
+    for (int t = 1; t < workers; t++) {
+        args[t].run = run;
+        args[t].worker = t;
+        if (!threadCreate(&threads[started + 1], zoneThreadMain, &args[t])) break;
+        started++;
+    }
+    zoneWorkerLoop(run, 0);
+    for (int t = 1; t <= started; t++) threadJoin(threads[t]);
+    return atomicLoad64(&run->failed) == 0;
+}
+
+// Reads each field's "zone" from the request data was parsed from, counted
+// as farm.h counts fields. labels[i].ptr is NULL for a field without one.
+static inline int parseFieldZones(const char *input, size_t length, const IrrigationData *data,
+                                  Arena *arena, JsonSlice **labels) {
+    JsonCursor json;
+    JsonSlice key;
+    int first = 1;
+
+    *labels = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+    if (!*labels) return 0;
+    memset(*labels, 0, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+
+    jsonInit(&json, input, length);
+    if (!jsonConsume(&json, '{')) return 0;
+    while (jsonNextKey(&json, &first, &key)) {
+        int ok = 1;
+        if (jsonSliceEquals(key, "fields") && jsonPeek(&json) == '[') {
+            int firstElement = 1;
+            int index = 0;
+            json.cur++;
+            while (ok && jsonNextElement(&json, &firstElement)) {
+                JsonSlice zone = {NULL, 0};
+                int firstKey = 1, named = 0;
+                if (jsonPeek(&json) != '{') {
+                    ok = jsonSkipValue(&json);
+                    continue;
+                }
+                json.cur++;
+                while (ok && jsonNextKey(&json, &firstKey, &key)) {
+                    if (jsonSliceEquals(key, "name") && jsonPeek(&json) == '"') {
+                        JsonSlice name;
+                        ok = jsonString(&json, &name);
+                        named = 1;
+                    } else if (jsonSliceEquals(key, "zone") && jsonPeek(&json) == '"') {
+                        ok = jsonString(&json, &zone);
+                    } else {
+                        ok = jsonSkipValue(&json);
+                    }
+                }
+                if (named) {
+                    if (index < data->fieldCount) (*labels)[index] = zone;
+                    index++;
+                }
+            }
+            ok = ok && !json.error;
+        } else {
+            ok = jsonSkipValue(&json);
+        }
+        if (!ok) return 0;
+    }
+    return !json.error;
+}
+
+static inline uint32_t zoneLabelHash(JsonSlice label) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < label.length; i++) hash = (hash ^ (unsigned char)label.ptr[i]) * 16777619u;
+    return hash;
+}
+
+// Gives every field a zone: one per distinct label, then blocks of
+// fieldsPerZone unlabelled fields in input order. Returns the zone count,
+// or -1 if out of memory.
+static inline int assignZones(const IrrigationData *data, const JsonSlice *labels,
+                              int fieldsPerZone, int *zoneOf, Arena *arena) {
+    int mask = 1;
+    int zones = 0, unlabelled = 0;
+
+    while (mask < 2 * data->fieldCount + 1) mask <<= 1;
+    int *slots = arenaAlloc(arena, (size_t)mask * sizeof(int));
+    if (!slots) return -1;
+    memset(slots, 0xff, (size_t)mask * sizeof(int));
+    mask--;
+
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (!labels[i].ptr) continue;
+        uint32_t slot = zoneLabelHash(labels[i]) & (uint32_t)mask;
+        while (slots[slot] >= 0) {
+            JsonSlice other = labels[slots[slot]];
+            if (other.length == labels[i].length &&
+                memcmp(other.ptr, labels[i].ptr, (size_t)other.length) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (uint32_t)mask;
+        }
+        if (slots[slot] < 0) {
+            slots[slot] = i;
+            zoneOf[i] = zones++;
+        } else {
+            zoneOf[i] = zoneOf[slots[slot]];
+        }
+    }
+    for (int i = 0; i < data->fieldCount; i++) {
+        if (labels[i].ptr) continue;
+        if (unlabelled % fieldsPerZone == 0) zones++;
+        zoneOf[i] = zones - 1;
+        unlabelled++;
+    }
+    return zones;
+}
+
+// Solves zone `job`: its DP, then its curve over budgets up to w.
+static int zoneSolveJob(ZoneRun *run, int job, int worker) {
+    ZoneNode *node = &run->nodes[job];
+    Arena *arena = &run->arenas[worker];
+    int begin = run->memberStart[job];
+    int count = run->memberStart[job + 1] - begin;
+    int64_t need = 0;
+    DPOptions options = *run->options;
+
+    node->left = node->right = -1;
+    node->data = *run->data;
+    node->data.fieldCount = count;
+    node->data.fields = arenaAlloc(arena, (size_t)count * sizeof(Field));
+    node->fieldIndex = run->members + begin;
+    int *order = arenaAlloc(arena, (size_t)count * sizeof(int));
+    if (!node->data.fields || !order) return 0;
+    for (int k = 0; k < count; k++) {
+        node->data.fields[k] = run->data->fields[node->fieldIndex[k]];
+        order[k] = k;
+        need += node->data.fields[k].waterNeeded;
+    }
+    node->order = order;
+    node->data.totalWater = need < run->data->totalWater ? (int)need : run->data->totalWater;
+    node->length = node->data.totalWater;
+
+    options.threads = 1;
+    if (!dpScheduleTables(&node->data, node->order, &options, arena, &node->dpStats,
+                          &node->tables)) {
+        return 0;
+    }
+    node->curve = arenaAlloc(arena, ((size_t)node->length + 1) * sizeof(Score));
+    node->bestAt = arenaAlloc(arena, ((size_t)node->length + 1) * sizeof(int));
+    if (!node->curve || !node->bestAt) return 0;
+    const Score *last = node->tables.last;
+    for (int w = 0; w <= node->length; w++) {
+        if (w > 0 && last[w] <= node->curve[w - 1]) {
+            node->curve[w] = node->curve[w - 1];
+            node->bestAt[w] = node->bestAt[w - 1];
+        } else {
+            node->curve[w] = last[w];
+            node->bestAt[w] = w;
+        }
+    }
+    return 1;
+}
+
+// True when the slope rise / run (rise >= 0, run > 0) is below
+// rise2 / run2, compared exactly: whole parts first, then the remainders,
+// whose products stay far below 2^63.
+static inline int zoneSlopeLess(Score rise, int run, Score rise2, int run2) {
+    Score whole = rise / run, whole2 = rise2 / run2;
+    if (whole != whole2) return whole < whole2;
+    return (rise % run) * run2 < (rise2 % run2) * run;
+}
+
+// Upper concave hull of a curve, evaluated at every w and rounded up, so
+// hull[w] >= curve[w] and hull[w] is less than one unit above a concave
+// function. vertices needs length + 1 ints. Returns the largest gap
+// between hull and curve.
+static inline Score zoneHull(const Score *curve, int length, Score *hull, int *vertices) {
+    int count = 0;
+    Score gap = 0;
+
+    for (int w = 0; w <= length; w++) {
+        while (count >= 2) {
+            int p = vertices[count - 2], q = vertices[count - 1];
+            if (zoneSlopeLess(curve[q] - curve[p], q - p, curve[w] - curve[q], w - q)) {
+                count--;
+            } else if (!zoneSlopeLess(curve[w] - curve[q], w - q, curve[q] - curve[p], q - p)) {
+                count--;
+            } else {
+                break;
+            }
+        }
+        vertices[count++] = w;
+    }
+    hull[0] = curve[0];
+    for (int v = 1; v < count; v++) {
+        int p = vertices[v - 1], q = vertices[v];
+        Score rise = curve[q] - curve[p];
+        Score whole = rise / (q - p), rest = rise % (q - p);
+        for (int w = p + 1; w <= q; w++) {
+            Score part = rest * (w - p);
+            hull[w] = curve[p] + whole * (w - p) + (part + (q - p) - 1) / (q - p);
+            if (hull[w] - curve[w] > gap) gap = hull[w] - curve[w];
+        }
+    }
+    return gap;
+}
+
+// out[w] = max over x of a[w - x] + b[x], with split[w] the best x.
+//
+// ha and hb bound a and b from above and are within one unit of concave
+// functions, so u(x) = ha[w - x] + hb[x] is within two units of a concave
+// function of x that bounds every candidate. The scan starts from the last
+// budget's split and walks outwards on each side until u falls more than
+// two units below the best value found: past that point the concave
+// function is below the best, and stays below it all the way to the end.
+// Where the curves are concave the scan looks at a handful of splits per
+// budget; the dents the minimum allocations make widen it a little.
+static inline int64_t zoneMergeCurves(const Score *a, const Score *ha, int lengthA,
+                                      const Score *b, const Score *hb, int lengthB, Score *out,
+                                      int *split, int lengthOut) {
+    int64_t steps = 0;
+    int x = 0;
+
+    for (int w = 0; w <= lengthOut; w++) {
+        int low = w - lengthA > 0 ? w - lengthA : 0;
+        int high = w < lengthB ? w : lengthB;
+        if (x < low) x = low;
+        if (x > high) x = high;
+
+        int best = x;
+        Score bestValue = a[w - x] + b[x];
+        for (int right = x + 1; right <= high; right++) {
+            if (ha[w - right] + hb[right] < bestValue - 2) break;
+            Score value = a[w - right] + b[right];
+            if (value > bestValue) {
+                bestValue = value;
+                best = right;
+            }
+            steps++;
+        }
+        for (int left = x - 1; left >= low; left--) {
+            if (ha[w - left] + hb[left] < bestValue - 2) break;
+            Score value = a[w - left] + b[left];
+            if (value > bestValue) {
+                bestValue = value;
+                best = left;
+            }
+            steps++;
+        }
+        out[w] = bestValue;
+        split[w] = best;
+        x = best;
+        steps++;
+    }
+    return steps;
+}
+
+// Builds merge node jobNodes[job] from its two children.
+static int zoneMergeJob(ZoneRun *run, int job, int worker) {
+    ZoneNode *node = &run->nodes[run->jobNodes[job]];
+    const ZoneNode *left = &run->nodes[node->left];
+    const ZoneNode *right = &run->nodes[node->right];
+    Arena *arena = &run->arenas[worker];
+    int64_t length = (int64_t)left->length + right->length;
+    size_t widest = (size_t)(left->length > right->length ? left->length : right->length) + 1;
+
+    node->length = length < run->data->totalWater ? (int)length : run->data->totalWater;
+    node->curve = arenaAlloc(arena, ((size_t)node->length + 1) * sizeof(Score));
+    node->split = arenaAlloc(arena, ((size_t)node->length + 1) * sizeof(int));
+    Score *hullLeft = arenaAlloc(arena, ((size_t)left->length + 1) * sizeof(Score));
+    Score *hullRight = arenaAlloc(arena, ((size_t)right->length + 1) * sizeof(Score));
+    int *vertices = arenaAlloc(arena, widest * sizeof(int));
+    if (!node->curve || !node->split || !hullLeft || !hullRight || !vertices) return 0;
+
+    Score gap = zoneHull(left->curve, left->length, hullLeft, vertices);
+    Score gapRight = zoneHull(right->curve, right->length, hullRight, vertices);
+    atomicMax64(&run->hullGap, gap > gapRight ? gap : gapRight);
+    atomicAdd64(&run->mergeSteps,
+                zoneMergeCurves(left->curve, hullLeft, left->length, right->curve, hullRight,
+                                right->length, node->curve, node->split, node->length));
+    return 1;
+}
+
+// Hands budget w down the tree and backtracks each zone's DP from its share.
+static void zoneBacktrack(ZoneRun *run, int node, int w) {
+    while (run->nodes[node].left >= 0) {
+        const ZoneNode *merge = &run->nodes[node];
+        int right = merge->split[w];
+        zoneBacktrack(run, merge->left, w - right);
+        node = merge->right;
+        w = right;
+    }
+
+    ZoneNode *zone = &run->nodes[node];
+    for (int k = 0; k < zone->data.fieldCount; k++) {
+        zone->data.fields[k].scheduled = 0;
+        zone->data.fields[k].allocated = 0;
+    }
+    dpBacktrackFrom(&zone->data, zone->order, &zone->tables.log, zone->bestAt[w]);
+    for (int k = 0; k < zone->data.fieldCount; k++) {
+        Field *field = &run->data->fields[zone->fieldIndex[k]];
+        field->scheduled = zone->data.fields[k].scheduled;
+        field->allocated = zone->data.fields[k].allocated;
+    }
+}
+
+// Solves every zone, then merges the curves pairwise, level by level; an
+// odd one out waits a level. Returns the root node, or -1 if out of memory.
+static inline int zoneSolveTree(ZoneRun *run, int zones, Arena *arena) {
+    uint64_t start = monotonicMicros();
+    int *level = arenaAlloc(arena, (size_t)zones * sizeof(int));
+    int nodeCount = zones;
+
+    if (!level || !zoneRunJobs(run, zoneSolveJob, zones)) return -1;
+    run->stats->solveMicros = monotonicMicros() - start;
+
+    start = monotonicMicros();
+    for (int z = 0; z < zones; z++) level[z] = z;
+    for (int width = zones; width > 1;) {
+        int pairs = width / 2;
+        for (int p = 0; p < pairs; p++) {
+            ZoneNode *node = &run->nodes[nodeCount];
+            node->left = level[2 * p];
+            node->right = level[2 * p + 1];
+            run->jobNodes[p] = nodeCount;
+            level[p] = nodeCount++;
+        }
+        if (width % 2) level[pairs] = level[width - 1];
+        if (!zoneRunJobs(run, zoneMergeJob, pairs)) return -1;
+        width = pairs + width % 2;
+    }
+    run->stats->mergeMicros = monotonicMicros() - start;
+    return level[0];
+}
+
+// Backtracks from the smallest budget that reaches the optimum, as the flat
+// DP picks it, and fills in the stats.
+static inline void zoneFinish(ZoneRun *run, int rootNode, int zones) {
+    IrrigationData *data = run->data;
+    ZoneStats *stats = run->stats;
+    const ZoneNode *root = &run->nodes[rootNode];
+    int best = root->length;
+
+    while (best > 0 && root->curve[best - 1] == root->curve[root->length]) best--;
+    for (int i = 0; i < data->fieldCount; i++) {
+        data->fields[i].scheduled = 0;
+        data->fields[i].allocated = 0;
+    }
+    zoneBacktrack(run, rootNode, best);
+    data->totalWaterUsed = best;
+    data->remainingWater = data->totalWater - best;
+
+    stats->zones = zones;
+    stats->threadsUsed = run->threads;
+    stats->bestScore = root->curve[root->length];
+    stats->hullGap = run->hullGap;
+    stats->mergeSteps = run->mergeSteps;
+    stats->flatCells = (int64_t)data->fieldCount * ((int64_t)data->totalWater + 1);
+    for (int z = 0; z < zones; z++) {
+        const ZoneNode *zone = &run->nodes[z];
+        if (zone->data.fieldCount > stats->largestZone) stats->largestZone = zone->data.fieldCount;
+        if (zone->dpStats.peakTableBytes > stats->peakZoneTableBytes) {
+            stats->peakZoneTableBytes = zone->dpStats.peakTableBytes;
+        }
+        stats->zoneCells += (int64_t)zone->data.fieldCount * ((int64_t)zone->length + 1);
+    }
+}
+
+// Schedules data with the fields split into zones (labels from
+// parseFieldZones, or NULL). options->threads sets the worker count.
+// Returns 0 if out of memory.
+static inline int zoneSchedule(IrrigationData *data, const JsonSlice *labels, int fieldsPerZone,
+                               const DPOptions *options, Arena *arena, ZoneStats *stats) {
+    ZoneRun run;
+    int ok = 0;
+    const int *priority = prioritizeFields(data, arena);
+    int *zoneOf = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    JsonSlice *none = NULL;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&run, 0, sizeof(run));
+    if (!priority || !zoneOf) return 0;
+    if (!labels) {
+        none = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+        if (!none) return 0;
+        memset(none, 0, ((size_t)data->fieldCount + 1) * sizeof(JsonSlice));
+        labels = none;
+    }
+    int zones = assignZones(data, labels, fieldsPerZone, zoneOf, arena);
+    if (zones < 0) return 0;
+
+    run.data = data;
+    run.options = options;
+    run.threads = options->threads < zones ? options->threads : zones;
+    run.stats = stats;
+    run.nodes = arenaAlloc(arena, (size_t)(2 * zones) * sizeof(ZoneNode));
+    run.members = arenaAlloc(arena, ((size_t)data->fieldCount + 1) * sizeof(int));
+    run.memberStart = arenaAlloc(arena, ((size_t)zones + 1) * sizeof(int));
+    run.jobNodes = arenaAlloc(arena, (size_t)zones * sizeof(int));
+    run.arenas = malloc((size_t)run.threads * sizeof(Arena));
+    if (!run.nodes || !run.members || !run.memberStart || !run.jobNodes || !run.arenas) {
+        free(run.arenas);
+        return 0;
+    }
+    memset(run.nodes, 0, (size_t)(2 * zones) * sizeof(ZoneNode));
+    for (int t = 0; t < run.threads; t++) arenaInit(&run.arenas[t]);
+
+    // Members by zone, in priority order within each
+    memset(run.memberStart, 0, ((size_t)zones + 1) * sizeof(int));
+    for (int i = 0; i < data->fieldCount; i++) run.memberStart[zoneOf[i] + 1]++;
+    for (int z = 0; z < zones; z++) run.memberStart[z + 1] += run.memberStart[z];
+    for (int k = 0; k < data->fieldCount; k++) {
+        int z = zoneOf[priority[k]];
+        run.members[run.memberStart[z]++] = priority[k];
+    }
+    for (int z = zones; z > 0; z--) run.memberStart[z] = run.memberStart[z - 1];
+    run.memberStart[0] = 0;
+
+    int root = zoneSolveTree(&run, zones, arena);
+    if (root >= 0) {
+        zoneFinish(&run, root, zones);
+        ok = 1;
+    }
+
+    // The workers' arenas only grow, so they peak just before this
+    size_t workerBytes = (size_t)run.threads * sizeof(Arena);
+    for (int t = 0; t < run.threads; t++) workerBytes += run.arenas[t].usedBytes;
+    profileAlloc(workerBytes);
+    for (int t = 0; t < run.threads; t++) arenaRelease(&run.arenas[t]);
+    free(run.arenas);
+    profileFree(workerBytes);
+    return ok;
+}
+
+#endif
@@ -1,294 +1,667 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <float.h>
 
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
 #endif
 
-#define MAX_FIELDS 10
-#define MAX_NAME_LENGTH 100
-#define MAX_INPUT_SIZE 8192
+#include "core/anytime.h"
+#include "core/approx.h"
+#include "core/arena.h"
+#include "core/emit.h"
+#include "core/farm.h"
+#include "core/frontier.h"
+#include "core/horizon.h"
+#include "core/dp.h"
+#include "core/incremental.h"
+#include "core/serve.h"
+#include "core/zones.h"
+
 #define MAX_WATER 100000
 
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    int moisture;
-    int waterNeeded;
-    int allocated;
-    int scheduled;
-    int originalIndex;
-} Field;
+    DPOptions dp;
+    ServeOptions serve;
+    int incremental;
+    size_t rowBudget;
+    IncrementalDP *session;     // set with --incremental in the serve modes
+    double epsilon;             // 0 for the exact DP
+    int compareExact;           // with --epsilon, also run the exact DP and report both
+    int frontier;
+    double frontierTolerance;
+    Frontier *curve;            // set with --frontier
+    int horizon;
+    Horizon *plan;              // set with --horizon
+    int zones;                  // --zones: per-zone DPs merged over the budget
+    int zoneFields;             // unlabelled fields per zone
+} SchedulerOptions;
 
-typedef struct {
-    Field fields[MAX_FIELDS];
-    int fieldCount;
-    int totalWater;
-    int totalWaterUsed;
-    int remainingWater;
-} IrrigationData;
-
-char* findJsonValue(const char* json, const char* key) {
-    char searchKey[256];
-    snprintf(searchKey, sizeof(searchKey), "\"%s\":", key);
-    
-    char* pos = strstr(json, searchKey);
-    if (!pos) return NULL;
-    
-    pos += strlen(searchKey);
-    while (*pos == ' ' || *pos == '\t') pos++;
-    return pos;
+int generateOutput(FILE *out, const IrrigationData *data, OutputFormat format) {
+    if (!data) {
+        fprintf(out, "{\"error\":\"Invalid data\"}\n");
+        return 0;
+    }
+    return emitSchedule(out, data, NULL, "DynamicProgramming", 0, format);
+}
+
+static const char *kernelName(const DPOptions *options) {
+    if (options->memoryMode == DP_MEMORY_FULL) return "float-reference";
+    switch (options->kernel) {
+        case DP_KERNEL_SIMD: return "simd";
+        case DP_KERNEL_REFERENCE: return "reference";
+        default: return "deque";
+    }
 }
 
-int extractJsonNumber(const char* json, const char* key) {
-    char* pos = findJsonValue(json, key);
-    if (!pos) return 0;
-    return atoi(pos);
+static const char *simdName(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE42: return "sse4.2";
+        case SIMD_SCALAR: return "scalar";
+        default: return "none";
+    }
 }
 
-char* extractJsonString(const char* json, const char* key, char* buffer, int bufferSize) {
-    char* pos = findJsonValue(json, key);
-    if (!pos || *pos != '"') return NULL;
-    
-    pos++;
-    int i = 0;
-    while (i < bufferSize - 1 && *pos != '"' && *pos != '\0') {
-        buffer[i++] = *pos++;
-    }
-    buffer[i] = '\0';
-    return buffer;
+static void reportStats(const IrrigationData *data, const DPOptions *options,
+                        const DPStats *stats) {
+    fprintf(stderr,
+            "dp_stats mode=%s kernel=%s simd=%s threads=%d fields=%d water=%d "
+            "best_score=%lld peak_table_bytes=%zu full_table_bytes=%zu peak_rss_kb=%ld\n",
+            options->memoryMode == DP_MEMORY_LEAN ? "lean" : "full",
+            kernelName(options), simdName(stats->simdLevel), stats->threadsUsed,
+            data->fieldCount, data->totalWater, (long long)stats->bestScore,
+            stats->peakTableBytes, stats->fullTableBytes, peakResidentKB());
 }
 
-int compareFields(const void *a, const void *b) {
-    const Field *fieldA = (const Field *)a;
-    const Field *fieldB = (const Field *)b;
-    
-    if (fieldA->moisture != fieldB->moisture) {
-        return fieldA->moisture - fieldB->moisture;
+// Achieved objective against the bound and, with --compare-exact, against
+// the exact DP's optimum.
+static void reportApproxStats(const IrrigationData *data, const ApproxStats *stats,
+                              Score exactScore) {
+    double boundGap = stats->upperBound > 0
+                          ? (double)(stats->upperBound - stats->bestScore) / stats->upperBound
+                          : 0.0;
+    fprintf(stderr,
+            "approx_stats fields=%d water=%d epsilon=%g quantum=%d coarse_water=%d band=%d "
+            "rounds=%d full_fallback=%d coarse_score=%lld best_score=%lld upper_bound=%lld "
+            "bound_gap=%.6f peak_table_bytes=%zu",
+            data->fieldCount, data->totalWater, stats->epsilon, stats->quantum,
+            stats->coarseWater, stats->band, stats->rounds, stats->fullFallback,
+            (long long)stats->coarseScore, (long long)stats->bestScore,
+            (long long)stats->upperBound, boundGap, stats->peakTableBytes);
+    if (exactScore >= 0) {
+        double error = exactScore > 0 ? (double)(exactScore - stats->bestScore) / exactScore : 0.0;
+        fprintf(stderr, " exact_score=%lld error=%.6f", (long long)exactScore, error);
     }
-    return fieldB->waterNeeded - fieldA->waterNeeded;
+    fprintf(stderr, "\n");
 }
 
-int parseInput(const char *jsonString, IrrigationData *data) {
-    if (!jsonString || !data) return 0;
-    
-    memset(data, 0, sizeof(IrrigationData));
-    data->totalWater = extractJsonNumber(jsonString, "totalWater");
-    if (data->totalWater <= 0) {
-        fprintf(stderr, "Error: Invalid total water amount\n");
-        return 0;
-    }
-    
-    data->fieldCount = extractJsonNumber(jsonString, "fieldCount");
-    if (data->fieldCount <= 0 || data->fieldCount > MAX_FIELDS) {
-        fprintf(stderr, "Error: Invalid field count: %d\n", data->fieldCount);
-        return 0;
-    }
-    
-    char* fieldsStart = strstr(jsonString, "\"fields\":");
-    if (!fieldsStart) {
-        fprintf(stderr, "Error: Fields array not found\n");
-        return 0;
-    }
-    
-    fieldsStart = strchr(fieldsStart, '[');
-    if (!fieldsStart) {
-        fprintf(stderr, "Error: Fields array start not found\n");
-        return 0;
-    }
-    
-    char* fieldPos = fieldsStart + 1;
-    int fieldIndex = 0;
-    
-    while (fieldIndex < data->fieldCount && fieldPos) {
-        fieldPos = strchr(fieldPos, '{');
-        if (!fieldPos) break;
-        
-        char* fieldEnd = strchr(fieldPos, '}');
-        if (!fieldEnd) break;
-        
-        int fieldLen = fieldEnd - fieldPos + 1;
-        char fieldStr[1024];
-        if (fieldLen < sizeof(fieldStr)) {
-            strncpy(fieldStr, fieldPos, fieldLen);
-            fieldStr[fieldLen] = '\0';
-            
-            char nameBuffer[MAX_NAME_LENGTH];
-            if (extractJsonString(fieldStr, "name", nameBuffer, sizeof(nameBuffer))) {
-                strncpy(data->fields[fieldIndex].name, nameBuffer, MAX_NAME_LENGTH - 1);
-                data->fields[fieldIndex].name[MAX_NAME_LENGTH - 1] = '\0';
-                data->fields[fieldIndex].originalIndex = fieldIndex;
-                
-                data->fields[fieldIndex].moisture = extractJsonNumber(fieldStr, "moisture");
-                data->fields[fieldIndex].waterNeeded = extractJsonNumber(fieldStr, "waterNeeded");
-                
-                if (data->fields[fieldIndex].moisture < 0 || data->fields[fieldIndex].moisture > 100) {
-                    fprintf(stderr, "Error: Invalid moisture level for field %s: %d\n", 
-                            data->fields[fieldIndex].name, data->fields[fieldIndex].moisture);
-                    return 0;
-                }
-                
-                if (data->fields[fieldIndex].waterNeeded < 0) {
-                    fprintf(stderr, "Error: Invalid water needed for field %s: %d\n", 
-                            data->fields[fieldIndex].name, data->fields[fieldIndex].waterNeeded);
-                    return 0;
-                }
-                
-                fieldIndex++;
+static void reportAnytimeStats(const IrrigationData *data, const AnytimeStats *stats) {
+    fprintf(stderr,
+            "anytime_stats fields=%d water=%d deadline_ms=%d rounds=%d band=%d exact=%d "
+            "optimal=%d cut_short=%d greedy_score=%lld best_score=%lld upper_bound=%lld "
+            "cells_per_us=%.1f peak_table_bytes=%zu greedy_us=%llu elapsed_us=%llu\n",
+            data->fieldCount, data->totalWater, stats->deadlineMs, stats->rounds, stats->band,
+            stats->exact, stats->optimal, stats->cutShort, (long long)stats->greedyScore,
+            (long long)stats->bestScore, (long long)stats->upperBound, stats->cellsPerMicro,
+            stats->peakTableBytes, (unsigned long long)stats->greedyMicros,
+            (unsigned long long)stats->elapsedMicros);
+}
+
+static void reportFrontierStats(const Frontier *frontier) {
+    const IrrigationData *data = &frontier->session.data;
+    fprintf(stderr,
+            "frontier_stats fields=%d water=%d points=%d tolerance=%g max_error=%.6f "
+            "best_score=%lld peak_table_bytes=%zu build_us=%llu\n",
+            data->fieldCount, data->totalWater, frontier->pointCount, frontier->tolerance,
+            frontier->maxError, (long long)frontier->dpStats.bestScore,
+            frontier->dpStats.peakTableBytes, (unsigned long long)frontier->buildMicros);
+}
+
+static void reportZoneStats(const IrrigationData *data, const ZoneStats *stats) {
+    fprintf(stderr,
+            "zone_stats fields=%d water=%d zones=%d threads=%d largest_zone=%d "
+            "zone_cells=%lld flat_cells=%lld peak_zone_table_bytes=%zu hull_gap=%lld "
+            "merge_steps=%lld best_score=%lld solve_us=%llu merge_us=%llu\n",
+            data->fieldCount, data->totalWater, stats->zones, stats->threadsUsed,
+            stats->largestZone, (long long)stats->zoneCells, (long long)stats->flatCells,
+            stats->peakZoneTableBytes, (long long)stats->hullGap, (long long)stats->mergeSteps,
+            (long long)stats->bestScore, (unsigned long long)stats->solveMicros,
+            (unsigned long long)stats->mergeMicros);
+}
+
+static void reportHorizonStats(const Horizon *horizon) {
+    fprintf(stderr,
+            "horizon_stats fields=%d water=%d days=%d window=%d day=%d season_water=%d "
+            "season_days=%d passes=%d rows=%lld/%lld plan_us=%llu\n",
+            horizon->fieldCount, horizon->dailyWater, horizon->days, horizon->window,
+            horizon->day, horizon->seasonWater, horizon->seasonDays, horizon->stats.passes,
+            (long long)horizon->stats.rowsRun, (long long)horizon->stats.rowCount,
+            (unsigned long long)horizon->stats.planMicros);
+}
+
+static int parseOptions(int argc, char **argv, SchedulerOptions *scheduler) {
+    DPOptions *options = &scheduler->dp;
+    dpOptionsInit(options);
+    serveOptionsInit(&scheduler->serve);
+    scheduler->incremental = 0;
+    scheduler->rowBudget = INCREMENTAL_DEFAULT_ROW_BUDGET;
+    scheduler->session = NULL;
+    scheduler->epsilon = 0;
+    scheduler->compareExact = 0;
+    scheduler->frontier = 0;
+    scheduler->frontierTolerance = 0;
+    scheduler->curve = NULL;
+    scheduler->horizon = 0;
+    scheduler->plan = NULL;
+    scheduler->zones = 0;
+    scheduler->zoneFields = ZONE_DEFAULT_FIELDS;
+
+    for (int i = 1; i < argc; i++) {
+        if (parseServeOption(argc, argv, &i, &scheduler->serve)) {
+            continue;
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "lean") == 0) {
+                options->memoryMode = DP_MEMORY_LEAN;
+            } else if (strcmp(argv[i], "full") == 0) {
+                options->memoryMode = DP_MEMORY_FULL;
+            } else {
+                fprintf(stderr, "Error: Unknown memory mode: %s\n", argv[i]);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "auto") == 0) {
+                options->kernel = DP_KERNEL_DEQUE;
+            } else if (strcmp(argv[i], "deque") == 0) {
+                options->kernel = DP_KERNEL_DEQUE;
+            } else if (strcmp(argv[i], "simd") == 0) {
+                options->kernel = DP_KERNEL_SIMD;
+            } else if (strcmp(argv[i], "reference") == 0) {
+                options->kernel = DP_KERNEL_REFERENCE;
+            } else {
+                fprintf(stderr, "Error: Unknown DP kernel: %s\n", argv[i]);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "auto") == 0) {
+                options->simd = SIMD_AUTO;
+            } else if (strcmp(argv[i], "avx2") == 0) {
+                options->simd = SIMD_AVX2;
+            } else if (strcmp(argv[i], "sse4.2") == 0) {
+                options->simd = SIMD_SSE42;
+            } else if (strcmp(argv[i], "scalar") == 0) {
+                options->simd = SIMD_SCALAR;
+            } else {
+                fprintf(stderr, "Error: Unknown SIMD level: %s\n", argv[i]);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options->threads = atoi(argv[++i]);
+            if (options->threads < 1 || options->threads > MAX_THREADS) {
+                fprintf(stderr, "Error: Thread count must be between 1 and %d\n", MAX_THREADS);
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options->reportStats = 1;
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            scheduler->incremental = 1;
+        } else if (strcmp(argv[i], "--row-budget") == 0 && i + 1 < argc) {
+            long megabytes = atol(argv[++i]);
+            if (megabytes < 1) {
+                fprintf(stderr, "Error: Row budget must be at least 1 MB\n");
+                return 0;
+            }
+            scheduler->rowBudget = (size_t)megabytes << 20;
+        } else if (strcmp(argv[i], "--epsilon") == 0 && i + 1 < argc) {
+            scheduler->epsilon = atof(argv[++i]);
+            if (scheduler->epsilon <= 0 || scheduler->epsilon >= 1) {
+                fprintf(stderr, "Error: Epsilon must be between 0 and 1\n");
+                return 0;
             }
+        } else if (strcmp(argv[i], "--compare-exact") == 0) {
+            scheduler->compareExact = 1;
+        } else if (strcmp(argv[i], "--frontier") == 0) {
+            scheduler->frontier = 1;
+        } else if (strcmp(argv[i], "--frontier-tolerance") == 0 && i + 1 < argc) {
+            scheduler->frontierTolerance = atof(argv[++i]);
+            if (scheduler->frontierTolerance < 0) {
+                fprintf(stderr, "Error: Frontier tolerance must not be negative\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--horizon") == 0) {
+            scheduler->horizon = 1;
+        } else if (strcmp(argv[i], "--zones") == 0) {
+            scheduler->zones = 1;
+        } else if (strcmp(argv[i], "--zone-fields") == 0 && i + 1 < argc) {
+            scheduler->zoneFields = atoi(argv[++i]);
+            if (scheduler->zoneFields < 1) {
+                fprintf(stderr, "Error: Zone size must be at least 1 field\n");
+                return 0;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
         }
-        fieldPos = fieldEnd + 1;
     }
-    data->fieldCount = fieldIndex;
-    return fieldIndex > 0;
+
+    if (scheduler->incremental && scheduler->serve.mode != SERVE_STDIN &&
+        scheduler->serve.mode != SERVE_SOCKET) {
+        fprintf(stderr, "Error: --incremental needs --serve or --socket\n");
+        return 0;
+    }
+    if (scheduler->incremental && options->memoryMode == DP_MEMORY_FULL) {
+        fprintf(stderr, "Error: --incremental needs the lean DP engine\n");
+        return 0;
+    }
+    if (scheduler->epsilon > 0 &&
+        (scheduler->incremental || options->memoryMode == DP_MEMORY_FULL)) {
+        fprintf(stderr, "Error: --epsilon needs the lean DP engine without --incremental\n");
+        return 0;
+    }
+    if (scheduler->compareExact && scheduler->epsilon <= 0) {
+        fprintf(stderr, "Error: --compare-exact needs --epsilon\n");
+        return 0;
+    }
+    if (scheduler->frontier && (scheduler->incremental || scheduler->epsilon > 0 ||
+                                options->memoryMode == DP_MEMORY_FULL)) {
+        fprintf(stderr, "Error: --frontier needs the exact lean DP engine without --incremental\n");
+        return 0;
+    }
+    if (scheduler->frontier && scheduler->serve.mode == SERVE_BATCH) {
+        fprintf(stderr, "Error: --frontier keeps one frontier and cannot run in batch mode\n");
+        return 0;
+    }
+    if (scheduler->horizon && (scheduler->incremental || scheduler->frontier ||
+                               scheduler->epsilon > 0 || options->memoryMode == DP_MEMORY_FULL)) {
+        fprintf(stderr, "Error: --horizon needs the exact lean DP engine without --incremental "
+                        "or --frontier\n");
+        return 0;
+    }
+    if (scheduler->horizon && scheduler->serve.mode == SERVE_BATCH) {
+        fprintf(stderr, "Error: --horizon keeps one plan and cannot run in batch mode\n");
+        return 0;
+    }
+    if (scheduler->serve.snapshotPath &&
+        (scheduler->incremental || scheduler->frontier || scheduler->horizon)) {
+        fprintf(stderr, "Error: --incremental, --frontier and --horizon take full requests, "
+                        "not --snapshot\n");
+        return 0;
+    }
+    if (scheduler->zones && (scheduler->incremental || scheduler->frontier || scheduler->horizon ||
+                             scheduler->epsilon > 0 || options->memoryMode == DP_MEMORY_FULL)) {
+        fprintf(stderr, "Error: --zones needs the exact lean DP engine without --incremental, "
+                        "--frontier or --horizon\n");
+        return 0;
+    }
+    return 1;
 }
 
-void generateOutput(const IrrigationData *data) {
-    if (!data) {
-        printf("{\"error\":\"Invalid data\"}\n");
-        return;
-    }
-    
-    printf("{\n");
-    printf("  \"algorithm\": \"DynamicProgramming\",\n");
-    printf("  \"scheduled\": [\n");
-    
-    int scheduledCount = 0;
-    for (int i = 0; i < data->fieldCount; i++) {
-        if (data->fields[i].scheduled) {
-            if (scheduledCount > 0) printf(",\n");
-            printf("    {\n");
-            printf("      \"name\": \"%s\",\n", data->fields[i].name);
-            printf("      \"moisture\": %d,\n", data->fields[i].moisture);
-            printf("      \"need\": %d,\n", data->fields[i].waterNeeded);
-            printf("      \"allocated\": %d\n", data->fields[i].allocated);
-            printf("    }");
-            scheduledCount++;
-        }
+// A full request in incremental mode starts a new session.
+static int startSession(const char *input, size_t length, FILE *out,
+                        const SchedulerOptions *options) {
+    IncrementalDP *session = options->session;
+    IncrementalResult result = incrementalDPStart(session, input, length);
+
+    if (result == INCREMENTAL_INVALID) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    if (result == INCREMENTAL_NO_MEMORY) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    if (!generateOutput(out, &session->session.data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) {
+        reportStats(&session->session.data, &session->options, &session->dpStats);
+        incrementalReport(stderr, "dp", "start", &session->session);
     }
-    
-    printf("\n  ],\n");
-    printf("  \"totalWaterUsed\": %d,\n", data->totalWaterUsed);
-    printf("  \"remainingWater\": %d\n", data->remainingWater);
-    printf("}\n");
+    return 1;
 }
 
-int main() {
-    char input[MAX_INPUT_SIZE] = {0};
-#ifdef _WIN32
-    _setmode(_fileno(stdin), _O_BINARY);
-    _setmode(_fileno(stdout), _O_BINARY);
-#endif
+// {"command":"update","fields":[...]} against the current session.
+static int handleUpdate(const char *input, size_t length, FILE *out, Arena *arena,
+                        const SchedulerOptions *options) {
+    IncrementalDP *session = options->session;
+    FieldUpdate *updates;
+    int count;
 
-    size_t totalRead = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), stdin) && totalRead < sizeof(input) - 1) {
-        size_t bufferLen = strlen(buffer);
-        if (totalRead + bufferLen < sizeof(input)) {
-            strcat(input + totalRead, buffer);
-            totalRead += bufferLen;
-        } else break;
-    }
-    
-    if (totalRead == 0) {
-        fprintf(stderr, "Error: No input received\n");
-        printf("{\"error\":\"No input received\"}\n");
-        return 1;
+    if (!session) {
+        fprintf(stderr, "Error: Updates need --incremental\n");
+        fprintf(out, "{\"error\":\"Incremental updates are not enabled\"}\n");
+        return 0;
     }
-    
-    IrrigationData data;
-    if (!parseInput(input, &data)) {
+    if (!session->session.active) {
+        fprintf(stderr, "Error: No schedule to update; send a full request first\n");
+        fprintf(out, "{\"error\":\"No incremental session\"}\n");
+        return 0;
+    }
+    if (!parseFieldUpdates(input, length, &session->session.data, arena, &updates, &count)) {
+        fprintf(stderr, "Error: Failed to parse field update\n");
+        fprintf(out, "{\"error\":\"Invalid field update\"}\n");
+        return 0;
+    }
+    if (incrementalDPUpdate(session, updates, count, arena) != INCREMENTAL_OK) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    if (!generateOutput(out, &session->session.data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) {
+        incrementalReport(stderr, "dp", "update", &session->session);
+    }
+    return 1;
+}
+
+// A full request in frontier mode runs the DP once and answers with the
+// breakpoints.
+static int startFrontier(const char *input, size_t length, FILE *out,
+                         const SchedulerOptions *options) {
+    Frontier *frontier = options->curve;
+    IncrementalResult result = frontierStart(frontier, input, length);
+
+    if (result == INCREMENTAL_INVALID) {
         fprintf(stderr, "Error: Failed to parse input JSON\n");
-        printf("{\"error\":\"Failed to parse input JSON\"}\n");
-        return 1;
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    if (result == INCREMENTAL_NO_MEMORY) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    if (!emitFrontier(out, frontier, "DynamicProgramming",
+                      serveOutputFormat(&options->serve) != OUTPUT_PRETTY)) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
     }
+    if (options->dp.reportStats) reportFrontierStats(frontier);
+    return 1;
+}
 
-    // Sort fields by priority
-    qsort(data.fields, data.fieldCount, sizeof(Field), compareFields);
-    
-    // DP setup
-    float **dp = malloc((data.fieldCount + 1) * sizeof(float *));
-    int **parent = malloc((data.fieldCount + 1) * sizeof(int *));
-    for (int i = 0; i <= data.fieldCount; i++) {
-        dp[i] = malloc((data.totalWater + 1) * sizeof(float));
-        parent[i] = malloc((data.totalWater + 1) * sizeof(int));
-        for (int w = 0; w <= data.totalWater; w++) {
-            dp[i][w] = -FLT_MAX;
-            parent[i][w] = -1;
-        }
+// {"command":"budget","water":N}: the schedule for N units from the
+// current frontier.
+static int handleBudget(const char *input, size_t length, FILE *out,
+                        const SchedulerOptions *options) {
+    Frontier *frontier = options->curve;
+    int water = -1;
+
+    if (!frontier) {
+        fprintf(stderr, "Error: Budget commands need --frontier\n");
+        fprintf(out, "{\"error\":\"Frontier mode is not enabled\"}\n");
+        return 0;
+    }
+    if (!frontier->session.active) {
+        fprintf(stderr, "Error: No frontier; send a full request first\n");
+        fprintf(out, "{\"error\":\"No frontier\"}\n");
+        return 0;
+    }
+    if (!parseBudgetCommand(input, length, &water) || !frontierSchedule(frontier, water)) {
+        fprintf(stderr, "Error: Budget must be between 0 and %d\n",
+                frontier->session.data.totalWater);
+        fprintf(out, "{\"error\":\"Invalid budget\"}\n");
+        return 0;
     }
-    dp[0][0] = 0;
+    if (!generateOutput(out, &frontier->session.data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) {
+        fprintf(stderr, "frontier_budget water=%d used=%d budget_us=%llu\n", water,
+                frontier->session.data.totalWaterUsed,
+                (unsigned long long)frontier->budgetMicros);
+    }
+    return 1;
+}
 
-    // DP computation
-    for (int i = 0; i < data.fieldCount; i++) {
-        int minWater = (data.fields[i].waterNeeded + 9) / 10;
-        for (int w = 0; w <= data.totalWater; w++) {
-            // Skip field
-            if (dp[i][w] > dp[i + 1][w]) {
-                dp[i + 1][w] = dp[i][w];
-                parent[i + 1][w] = -1;
-            }
+// A full request in horizon mode plans the window from scratch.
+static int startHorizon(const char *input, size_t length, FILE *out, Arena *arena,
+                        const SchedulerOptions *options) {
+    Horizon *horizon = options->plan;
+    IncrementalResult result = horizonStart(horizon, input, length, arena);
 
-            // Allocate to field
-            for (int x = minWater; x <= data.fields[i].waterNeeded; x++) {
-                if (w < x) break;
-                float value = (100.0 - data.fields[i].moisture) * 
-                             (x / (float)data.fields[i].waterNeeded);
-                float candidate = dp[i][w - x] + value;
-                
-                if (candidate > dp[i + 1][w]) {
-                    dp[i + 1][w] = candidate;
-                    parent[i + 1][w] = x;
-                }
-            }
-        }
+    if (result == INCREMENTAL_INVALID) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    if (result == INCREMENTAL_NO_MEMORY) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
     }
+    if (!emitHorizon(out, horizon, serveOutputFormat(&options->serve) != OUTPUT_PRETTY)) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) reportHorizonStats(horizon);
+    return 1;
+}
 
-    // Find optimal water usage
-    int best_w = 0;
-    float best_value = -FLT_MAX;
-    for (int w = 0; w <= data.totalWater; w++) {
-        if (dp[data.fieldCount][w] > best_value) {
-            best_value = dp[data.fieldCount][w];
-            best_w = w;
-        }
+// {"command":"advance","fields":[...]}: commits day 0 and replans from the
+// next day, with any readings given for it.
+static int handleAdvance(const char *input, size_t length, FILE *out, Arena *arena,
+                         const SchedulerOptions *options) {
+    Horizon *horizon = options->plan;
+    FieldUpdate *readings;
+    int count;
+
+    if (!horizon) {
+        fprintf(stderr, "Error: Advance commands need --horizon\n");
+        fprintf(out, "{\"error\":\"Horizon mode is not enabled\"}\n");
+        return 0;
+    }
+    if (!horizon->active) {
+        fprintf(stderr, "Error: No plan to advance; send a full request first\n");
+        fprintf(out, "{\"error\":\"No horizon plan\"}\n");
+        return 0;
+    }
+    if (horizon->seasonDays <= 1) {
+        fprintf(stderr, "Error: The season has no days left to plan\n");
+        fprintf(out, "{\"error\":\"Season is over\"}\n");
+        return 0;
+    }
+    if (!parseFieldUpdates(input, length, &horizonSlot(horizon, 0)->session.data, arena,
+                           &readings, &count)) {
+        fprintf(stderr, "Error: Failed to parse field readings\n");
+        fprintf(out, "{\"error\":\"Invalid field update\"}\n");
+        return 0;
+    }
+    if (horizonAdvance(horizon, readings, count, arena) != INCREMENTAL_OK) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
     }
+    if (!emitHorizon(out, horizon, serveOutputFormat(&options->serve) != OUTPUT_PRETTY)) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) reportHorizonStats(horizon);
+    return 1;
+}
 
-    // Backtrack allocations
-    int current_w = best_w;
-    for (int i = data.fieldCount - 1; i >= 0; i--) {
-        int x = parent[i + 1][current_w];
-        if (x >= 0) {
-            data.fields[i].allocated = x;
-            data.fields[i].scheduled = 1;
-            current_w -= x;
-        }
+// Zone labels come from the request; a snapshot delta carries none, so
+// its fields are only split into blocks.
+static int handleZones(const char *input, size_t length, IrrigationData *data, FILE *out,
+                       Arena *arena, const SchedulerOptions *options) {
+    JsonSlice *labels = NULL;
+    ZoneStats stats;
+
+    if (!options->serve.snapshotPath && !parseFieldZones(input, length, data, arena, &labels)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    if (!zoneSchedule(data, labels, options->zoneFields, &options->dp, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    if (!generateOutput(out, data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
     }
-    data.totalWaterUsed = best_w;
-    data.remainingWater = data.totalWater - best_w;
+    if (options->dp.reportStats) reportZoneStats(data, &stats);
+    return 1;
+}
 
-    // Restore original field order
-    for (int i = 0; i < data.fieldCount; i++) {
-        for (int j = i + 1; j < data.fieldCount; j++) {
-            if (data.fields[j].originalIndex < data.fields[i].originalIndex) {
-                Field temp = data.fields[i];
-                data.fields[i] = data.fields[j];
-                data.fields[j] = temp;
-            }
+// A request with a "deadlineMs" gets the best schedule found by then,
+// counted from when the request arrived, whatever engine flags were given.
+static int handleDeadline(IrrigationData *data, uint64_t arrived, FILE *out, Arena *arena,
+                          const SchedulerOptions *options) {
+    AnytimeStats stats;
+    uint64_t deadline = arrived + (uint64_t)data->deadlineMs * 1000;
+
+    if (!anytimeSchedule(data, &options->dp, deadline, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    double wallMs = (double)(monotonicMicros() - arrived) / 1000.0;
+    if (!emitAnytime(out, data, &stats, "DynamicProgramming", wallMs,
+                     serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats) reportAnytimeStats(data, &stats);
+    return 1;
+}
+
+static int handleApprox(IrrigationData *data, FILE *out, Arena *arena,
+                        const SchedulerOptions *options) {
+    ApproxStats stats;
+    Score exactScore = -1;
+
+    if (options->compareExact) {
+        IrrigationData exact = *data;
+        DPStats exactStats;
+        exact.fields = arenaAlloc(arena, (size_t)data->fieldCount * sizeof(Field));
+        if (!exact.fields) {
+            fprintf(stderr, "Error: Out of memory for DP tables\n");
+            fprintf(out, "{\"error\":\"Out of memory\"}\n");
+            return 0;
+        }
+        memcpy(exact.fields, data->fields, (size_t)data->fieldCount * sizeof(Field));
+        if (!dpSchedule(&exact, &options->dp, arena, &exactStats)) {
+            fprintf(stderr, "Error: Out of memory for DP tables\n");
+            fprintf(out, "{\"error\":\"Out of memory\"}\n");
+            return 0;
         }
+        exactScore = exactStats.bestScore;
+    }
+
+    if (!approxSchedule(data, &options->dp, options->epsilon, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    if (!generateOutput(out, data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->dp.reportStats || options->compareExact) {
+        reportApproxStats(data, &stats, exactScore);
+    }
+    return 1;
+}
+
+int handleRequest(const char *input, size_t length, FILE *out, Arena *arena, void *context) {
+    const SchedulerOptions *options = context;
+    uint64_t arrived = monotonicMicros();
+    IrrigationData data;
+    DPStats stats;
+
+    if (isCommand(input, length, "update")) {
+        return handleUpdate(input, length, out, arena, options);
+    }
+    if (options->session) {
+        return startSession(input, length, out, options);
+    }
+    if (isCommand(input, length, "budget")) {
+        return handleBudget(input, length, out, options);
+    }
+    if (options->curve) {
+        return startFrontier(input, length, out, options);
+    }
+    if (isCommand(input, length, "advance")) {
+        return handleAdvance(input, length, out, arena, options);
+    }
+    if (options->plan) {
+        return startHorizon(input, length, out, arena, options);
+    }
+
+    if (!parseServedInput(input, length, &data, arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+
+    if (data.deadlineMs > 0) return handleDeadline(&data, arrived, out, arena, options);
+    if (options->epsilon > 0) return handleApprox(&data, out, arena, options);
+    if (options->zones) return handleZones(input, length, &data, out, arena, options);
+
+    if (!dpSchedule(&data, &options->dp, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+
+    if (!generateOutput(out, &data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+
+    if (options->dp.reportStats) {
+        reportStats(&data, &options->dp, &stats);
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    SchedulerOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printf("{\"error\":\"Invalid command line options\"}\n");
+        return 1;
     }
 
-    generateOutput(&data);
+    IncrementalDP session;
+    if (options.incremental) {
+        incrementalDPInit(&session, &options.dp, options.rowBudget);
+        options.session = &session;
+    }
+
+    Frontier frontier;
+    if (options.frontier) {
+        frontierInit(&frontier, &options.dp, options.frontierTolerance);
+        options.curve = &frontier;
+    }
 
-    // Cleanup
-    for (int i = 0; i <= data.fieldCount; i++) {
-        free(dp[i]);
-        free(parent[i]);
+    // Static: a horizon holds a session per day
+    static Horizon horizon;
+    if (options.horizon) {
+        horizonInit(&horizon, &options.dp, options.rowBudget);
+        options.plan = &horizon;
     }
-    free(dp);
-    free(parent);
 
-    return 0;
+    int status = runScheduler(&options.serve, handleRequest, &options);
+    if (options.session) incrementalDPRelease(options.session);
+    if (options.curve) frontierRelease(options.curve);
+    if (options.plan) horizonRelease(options.plan);
+    return status;
 }
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "core/arena.h"
+#include "core/farm.h"
+#include "core/snapshot.h"
+
+// Writes a full request from stdin as a binary farm snapshot (see
+// core/snapshot.h). The schedulers then take --snapshot PATH and read
+// each request as a delta on it:
+//
+//   ./farm_snapshot farm.snap < farm.json
+//   echo '{"fields":[{"name":"North","moisture":35}]}' |
+//       ./dp_scheduler.out --snapshot farm.snap
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    Arena arena;
+    IrrigationData data;
+    size_t length = 0;
+    FILE *out;
+    int ok;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: farm_snapshot OUTPUT < request.json\n");
+        return 1;
+    }
+    arenaInit(&arena);
+    char *input = arenaReadStream(&arena, stdin, &length);
+    if (!input || !parseIrrigationInput(input, length, &data, &arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        arenaRelease(&arena);
+        return 1;
+    }
+    out = fopen(argv[1], "wb");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create %s\n", argv[1]);
+        arenaRelease(&arena);
+        return 1;
+    }
+    ok = snapshotWrite(out, &data, &arena);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write %s\n", argv[1]);
+        remove(argv[1]);
+    }
+    arenaRelease(&arena);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,486 @@
+#define NAPI_VERSION 8
+#include <node_api.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/anytime.h"
+#include "../core/arena.h"
+#include "../core/cache.h"
+#include "../core/farm.h"
+#include "../core/dp.h"
+#include "../core/greedy.h"
+#include "../core/brute_force.h"
+#include "../core/power.h"
+
+// Node binding for the C schedulers. The request object is read straight
+// into an IrrigationData on the JS thread, the scheduler runs on the libuv
+// threadpool, and the result object is built back on the JS thread.
+//
+// Schedules are cached (core/cache.h) for the life of the process, shared
+// by every threadpool worker: a resubmitted field set is answered from the
+// cache on the worker without running the scheduler.
+//
+// A DP request with a "deadlineMs" runs the anytime scheduler
+// (core/anytime.h) against a deadline counted from the schedule() call, so
+// time spent queued for a threadpool worker counts against it. Only the
+// schedules the full DP produced go into the cache.
+
+typedef enum {
+    ALGORITHM_GREEDY,
+    ALGORITHM_DP,
+    ALGORITHM_BRUTE_FORCE,
+    ALGORITHM_POWER
+} Algorithm;
+
+typedef struct {
+    napi_async_work work;
+    napi_deferred deferred;
+    Algorithm algorithm;
+    DPOptions dpOptions;
+    BruteForceOptions bruteForceOptions;
+    PowerOptions powerOptions;
+    Arena arena;
+    IrrigationData data;
+    const int *order;           // output order, NULL for input order
+    uint64_t arrived;           // monotonicMicros() when schedule() was called
+    AnytimeStats anytime;       // set for DP requests with a deadline
+    int useCache;
+    const char *error;
+} ScheduleJob;
+
+static ScheduleCache scheduleCache;
+static int scheduleCacheReady;
+
+#define NAPI_CHECK(env, call)                                      \
+    do {                                                           \
+        if ((call) != napi_ok) {                                   \
+            napi_throw_error((env), NULL, "N-API call failed");    \
+            return NULL;                                           \
+        }                                                          \
+    } while (0)
+
+static int parseAlgorithm(const char *name, Algorithm *algorithm) {
+    if (strcmp(name, "greedy") == 0) {
+        *algorithm = ALGORITHM_GREEDY;
+    } else if (strcmp(name, "dp") == 0) {
+        *algorithm = ALGORITHM_DP;
+    } else if (strcmp(name, "bruteForce") == 0) {
+        *algorithm = ALGORITHM_BRUTE_FORCE;
+    } else if (strcmp(name, "power") == 0) {
+        *algorithm = ALGORITHM_POWER;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static const char *algorithmName(Algorithm algorithm) {
+    switch (algorithm) {
+        case ALGORITHM_GREEDY: return "Greedy";
+        case ALGORITHM_DP: return "DynamicProgramming";
+        case ALGORITHM_POWER: return "PowerConstrainedDP";
+        default: return "BranchAndBound";
+    }
+}
+
+// Numbers are truncated to ints; anything else reads as 0, the same as a
+// missing key in the JSON parser.
+static int readIntProperty(napi_env env, napi_value object, const char *key, int *out) {
+    napi_value value;
+    napi_valuetype type;
+    double number;
+
+    *out = 0;
+    if (napi_get_named_property(env, object, key, &value) != napi_ok) return 0;
+    if (napi_typeof(env, value, &type) != napi_ok) return 0;
+    if (type != napi_number) return 1;
+    if (napi_get_value_double(env, value, &number) != napi_ok) return 0;
+    if (number != number) return 1;
+    if (number > 2147483647.0) number = 2147483647.0;
+    if (number < -2147483648.0) number = -2147483648.0;
+    *out = (int)number;
+    return 1;
+}
+
+// Copies a field's name into the job arena. Returns 1 with *named = 0 when
+// the element has no string name, so it is skipped like in the JSON path.
+static int readFieldName(napi_env env, napi_value object, Field *field, Arena *arena,
+                         int *named) {
+    napi_value value;
+    napi_valuetype type;
+    size_t length;
+
+    *named = 0;
+    if (napi_get_named_property(env, object, "name", &value) != napi_ok) return 0;
+    if (napi_typeof(env, value, &type) != napi_ok) return 0;
+    if (type != napi_string) return 1;
+    if (napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok) return 0;
+
+    char *name = arenaAlloc(arena, length + 1);
+    if (!name) return 0;
+    if (napi_get_value_string_utf8(env, value, name, length + 1, &length) != napi_ok) return 0;
+    field->name = name;
+    field->nameLength = (int)length;
+    *named = 1;
+    return 1;
+}
+
+static int readFields(napi_env env, napi_value array, IrrigationData *data, Arena *arena) {
+    uint32_t length;
+
+    if (napi_get_array_length(env, array, &length) != napi_ok) return 0;
+    data->fields = arenaAlloc(arena, ((size_t)length + 1) * sizeof(Field));
+    if (!data->fields) return 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value element;
+        napi_valuetype type;
+        int named;
+
+        if (napi_get_element(env, array, i, &element) != napi_ok) return 0;
+        if (napi_typeof(env, element, &type) != napi_ok) return 0;
+        if (type != napi_object) continue;
+
+        Field *field = &data->fields[data->fieldCount];
+        memset(field, 0, sizeof(*field));
+        if (!readFieldName(env, element, field, arena, &named)) return 0;
+        if (!named) continue;
+        if (!readIntProperty(env, element, "moisture", &field->moisture) ||
+            !readIntProperty(env, element, "waterNeeded", &field->waterNeeded)) {
+            return 0;
+        }
+        field->originalIndex = data->fieldCount;
+        data->fieldCount++;
+    }
+    return 1;
+}
+
+// Same contract as parseIrrigationInput, but reading a JS object.
+static int readRequest(napi_env env, napi_value input, IrrigationData *data, Arena *arena) {
+    napi_value fields;
+    napi_valuetype type;
+    bool isArray = false;
+    int declaredCount;
+
+    memset(data, 0, sizeof(IrrigationData));
+    if (napi_typeof(env, input, &type) != napi_ok || type != napi_object) return 0;
+
+    if (!readIntProperty(env, input, "totalWater", &data->totalWater) ||
+        !readIntProperty(env, input, "totalElectricity", &data->totalElectricity) ||
+        !readIntProperty(env, input, "waterDeliveryRate", &data->waterDeliveryRate) ||
+        !readIntProperty(env, input, "fieldCount", &declaredCount) ||
+        !readIntProperty(env, input, "deadlineMs", &data->deadlineMs)) {
+        return 0;
+    }
+
+    if (napi_get_named_property(env, input, "fields", &fields) != napi_ok) return 0;
+    if (napi_is_array(env, fields, &isArray) != napi_ok) return 0;
+    if (isArray && !readFields(env, fields, data, arena)) return 0;
+
+    return validateIrrigationInput(data, declaredCount, isArray);
+}
+
+static void executeSchedule(napi_env env, void *context) {
+    ScheduleJob *job = context;
+    DPStats stats;
+    BruteForceStats bruteForceStats;
+    PowerStats powerStats;
+    uint64_t hash = 0;
+    int ok = 1, cacheable = 1;
+    int anytime = job->algorithm == ALGORITHM_DP && job->data.deadlineMs > 0;
+    (void)env;
+
+    const int *order = prioritizeFields(&job->data, &job->arena);
+    if (!order) {
+        job->error = "Out of memory";
+        return;
+    }
+    // Greedy lists the fields in priority order
+    if (job->algorithm == ALGORITHM_GREEDY) job->order = order;
+    if (job->useCache) {
+        hash = scheduleCacheHash((int)job->algorithm, &job->data, order);
+        if (scheduleCacheLookup(&scheduleCache, (int)job->algorithm, &job->data, order, hash)) {
+            if (anytime) {
+                job->anytime.optimal = 1;
+                job->anytime.bestScore = anytimeScore(&job->data);
+            }
+            return;
+        }
+    }
+
+    switch (job->algorithm) {
+        case ALGORITHM_GREEDY:
+            greedyScheduleOrdered(&job->data, order);
+            break;
+        case ALGORITHM_DP:
+            if (anytime) {
+                uint64_t deadline = job->arrived + (uint64_t)job->data.deadlineMs * 1000;
+                ok = anytimeScheduleOrdered(&job->data, order, &job->dpOptions, deadline,
+                                            &job->arena, &job->anytime);
+                cacheable = job->anytime.exact;
+            } else {
+                ok = dpScheduleOrdered(&job->data, order, &job->dpOptions, &job->arena, &stats);
+            }
+            break;
+        case ALGORITHM_BRUTE_FORCE:
+            ok = bruteForceScheduleOrdered(&job->data, order, &job->bruteForceOptions,
+                                           &job->arena, &bruteForceStats);
+            break;
+        case ALGORITHM_POWER:
+            ok = powerScheduleOrdered(&job->data, order, &job->powerOptions, &job->arena,
+                                      &powerStats);
+            break;
+    }
+    if (!ok) {
+        job->error = "Out of memory";
+    } else if (job->useCache && cacheable) {
+        scheduleCacheStore(&scheduleCache, (int)job->algorithm, &job->data, order, hash);
+    }
+}
+
+static napi_status setInt(napi_env env, napi_value object, const char *key, int number) {
+    napi_value value;
+    napi_status status = napi_create_int32(env, number, &value);
+    if (status != napi_ok) return status;
+    return napi_set_named_property(env, object, key, value);
+}
+
+static napi_status setString(napi_env env, napi_value object, const char *key,
+                             const char *text, size_t length) {
+    napi_value value;
+    napi_status status = napi_create_string_utf8(env, text, length, &value);
+    if (status != napi_ok) return status;
+    return napi_set_named_property(env, object, key, value);
+}
+
+static napi_status setNumber(napi_env env, napi_value object, const char *key, double number) {
+    napi_value value;
+    napi_status status = napi_create_double(env, number, &value);
+    if (status != napi_ok) return status;
+    return napi_set_named_property(env, object, key, value);
+}
+
+static napi_status setBool(napi_env env, napi_value object, const char *key, int flag) {
+    napi_value value;
+    napi_status status = napi_get_boolean(env, flag != 0, &value);
+    if (status != napi_ok) return status;
+    return napi_set_named_property(env, object, key, value);
+}
+
+// Mirrors generateOutput() in the matching scheduler binary.
+static napi_status buildResult(napi_env env, const ScheduleJob *job, napi_value *result) {
+    const IrrigationData *data = &job->data;
+    int timed = (job->algorithm == ALGORITHM_GREEDY || job->algorithm == ALGORITHM_POWER) &&
+                data->useTimeConstraints;
+    napi_value scheduled;
+    napi_status status;
+    uint32_t count = 0;
+
+    if ((status = napi_create_object(env, result)) != napi_ok) return status;
+    if (job->error) {
+        return setString(env, *result, "error", job->error, NAPI_AUTO_LENGTH);
+    }
+
+    if ((status = setString(env, *result, "algorithm", algorithmName(job->algorithm),
+                            NAPI_AUTO_LENGTH)) != napi_ok ||
+        (status = napi_create_array(env, &scheduled)) != napi_ok) {
+        return status;
+    }
+    if (job->algorithm == ALGORITHM_DP && data->deadlineMs > 0) {
+        double wallMs = (double)(monotonicMicros() - job->arrived) / 1000.0;
+        if ((status = setNumber(env, *result, "objective",
+                                anytimeObjective(job->anytime.bestScore))) != napi_ok ||
+            (status = setNumber(env, *result, "wallMs", wallMs)) != napi_ok ||
+            (status = setBool(env, *result, "optimal", job->anytime.optimal)) != napi_ok) {
+            return status;
+        }
+    }
+
+    for (int k = 0; k < data->fieldCount; k++) {
+        const Field *field = &data->fields[job->order ? job->order[k] : k];
+        napi_value entry;
+        if (!field->scheduled) continue;
+
+        if ((status = napi_create_object(env, &entry)) != napi_ok ||
+            (status = setString(env, entry, "name", field->name, field->nameLength)) != napi_ok ||
+            (status = setInt(env, entry, "moisture", field->moisture)) != napi_ok ||
+            (status = setInt(env, entry, "need", field->waterNeeded)) != napi_ok ||
+            (status = setInt(env, entry, "allocated", field->allocated)) != napi_ok ||
+            (timed && (status = setInt(env, entry, "timeNeeded", field->timeNeeded)) != napi_ok) ||
+            (status = napi_set_element(env, scheduled, count++, entry)) != napi_ok) {
+            return status;
+        }
+    }
+
+    if ((status = napi_set_named_property(env, *result, "scheduled", scheduled)) != napi_ok ||
+        (status = setInt(env, *result, "totalWaterUsed", data->totalWaterUsed)) != napi_ok) {
+        return status;
+    }
+    if (timed) {
+        if ((status = setInt(env, *result, "totalTimeUsed", data->totalTimeUsed)) != napi_ok ||
+            (status = setInt(env, *result, "remainingElectricity",
+                             data->remainingElectricity)) != napi_ok) {
+            return status;
+        }
+    }
+    return setInt(env, *result, "remainingWater", data->remainingWater);
+}
+
+static void completeSchedule(napi_env env, napi_status status, void *context) {
+    ScheduleJob *job = context;
+    napi_value result;
+
+    if (status == napi_ok && buildResult(env, job, &result) == napi_ok) {
+        napi_resolve_deferred(env, job->deferred, result);
+    } else {
+        napi_value message, error;
+        napi_create_string_utf8(env, "Scheduler failed", NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, job->deferred, error);
+    }
+
+    napi_delete_async_work(env, job->work);
+    arenaRelease(&job->arena);
+    free(job);
+}
+
+// Input errors resolve to {error} like the JavaScript ports, so callers can
+// treat both implementations the same way.
+static napi_value resolveError(napi_env env, napi_value promise, napi_deferred deferred,
+                               const char *message) {
+    napi_value result;
+    NAPI_CHECK(env, napi_create_object(env, &result));
+    NAPI_CHECK(env, setString(env, result, "error", message, NAPI_AUTO_LENGTH));
+    NAPI_CHECK(env, napi_resolve_deferred(env, deferred, result));
+    return promise;
+}
+
+// schedule(algorithm, input[, options]) -> Promise<result>
+// algorithm is "greedy", "dp", "bruteForce" or "power"; options.threads sets the DP
+// and branch-and-bound worker count, and options.cache = false skips the
+// schedule cache. For "dp", input.deadlineMs bounds the run and the result
+// gains objective, wallMs and optimal.
+static napi_value schedule(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3];
+    napi_value promise, resourceName;
+    napi_deferred deferred;
+    char name[32];
+    size_t nameLength;
+    Algorithm algorithm;
+
+    NAPI_CHECK(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+    if (argc < 2 ||
+        napi_get_value_string_utf8(env, argv[0], name, sizeof(name), &nameLength) != napi_ok ||
+        !parseAlgorithm(name, &algorithm)) {
+        napi_throw_type_error(env, NULL, "schedule(algorithm, input): unknown algorithm");
+        return NULL;
+    }
+
+    NAPI_CHECK(env, napi_create_promise(env, &deferred, &promise));
+
+    ScheduleJob *job = calloc(1, sizeof(ScheduleJob));
+    if (!job) return resolveError(env, promise, deferred, "Out of memory");
+    job->arrived = monotonicMicros();
+    job->deferred = deferred;
+    job->algorithm = algorithm;
+    dpOptionsInit(&job->dpOptions);
+    bruteForceOptionsInit(&job->bruteForceOptions);
+    powerOptionsInit(&job->powerOptions);
+    arenaInit(&job->arena);
+    job->useCache = 1;
+
+    if (argc > 2) {
+        napi_valuetype type;
+        int threads = 0;
+        if (napi_typeof(env, argv[2], &type) == napi_ok && type == napi_object) {
+            napi_value cache;
+            bool useCache = true;
+            if (readIntProperty(env, argv[2], "threads", &threads) && threads > 0) {
+                job->dpOptions.threads = threads < MAX_THREADS ? threads : MAX_THREADS;
+                job->bruteForceOptions.threads = job->dpOptions.threads;
+            }
+            if (napi_get_named_property(env, argv[2], "cache", &cache) == napi_ok &&
+                napi_get_value_bool(env, cache, &useCache) == napi_ok) {
+                job->useCache = useCache;
+            }
+        }
+    }
+
+    if (!readRequest(env, argv[1], &job->data, &job->arena)) {
+        arenaRelease(&job->arena);
+        free(job);
+        return resolveError(env, promise, deferred, "Failed to parse input JSON");
+    }
+    if (algorithm == ALGORITHM_GREEDY) {
+        greedyApplyDefaults(&job->data);
+    }
+
+    NAPI_CHECK(env, napi_create_string_utf8(env, "smartfarm.schedule", NAPI_AUTO_LENGTH,
+                                            &resourceName));
+    if (napi_create_async_work(env, NULL, resourceName, executeSchedule, completeSchedule,
+                               job, &job->work) != napi_ok) {
+        job->work = NULL;
+    }
+    if (!job->work || napi_queue_async_work(env, job->work) != napi_ok) {
+        if (job->work) napi_delete_async_work(env, job->work);
+        arenaRelease(&job->arena);
+        free(job);
+        napi_throw_error(env, NULL, "Failed to queue scheduler work");
+        return NULL;
+    }
+    return promise;
+}
+
+// cacheStats() -> {hits, misses, evictions, entries, bytes, limitBytes}
+static napi_value cacheStats(napi_env env, napi_callback_info info) {
+    ScheduleCacheStats stats = scheduleCacheStats(&scheduleCache);
+    napi_value result;
+    (void)info;
+
+    NAPI_CHECK(env, napi_create_object(env, &result));
+    NAPI_CHECK(env, setNumber(env, result, "hits", (double)stats.hits));
+    NAPI_CHECK(env, setNumber(env, result, "misses", (double)stats.misses));
+    NAPI_CHECK(env, setNumber(env, result, "evictions", (double)stats.evictions));
+    NAPI_CHECK(env, setNumber(env, result, "entries", (double)stats.entries));
+    NAPI_CHECK(env, setNumber(env, result, "bytes", (double)stats.bytes));
+    NAPI_CHECK(env, setNumber(env, result, "limitBytes", (double)stats.limitBytes));
+    return result;
+}
+
+// setCacheLimit(bytes): 0 turns the cache off and empties it.
+static napi_value setCacheLimit(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    double bytes;
+
+    NAPI_CHECK(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+    if (argc < 1 || napi_get_value_double(env, argv[0], &bytes) != napi_ok || !(bytes >= 0)) {
+        napi_throw_type_error(env, NULL, "setCacheLimit(bytes): bytes must be a number >= 0");
+        return NULL;
+    }
+    scheduleCacheSetLimit(&scheduleCache, bytes < (double)SIZE_MAX ? (size_t)bytes : SIZE_MAX);
+    return NULL;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    napi_value fn;
+
+    // One cache per process, however many environments load the addon
+    if (!scheduleCacheReady) {
+        scheduleCacheInit(&scheduleCache, SCHEDULE_CACHE_DEFAULT_BYTES);
+        scheduleCacheReady = 1;
+    }
+    NAPI_CHECK(env, napi_create_function(env, "schedule", NAPI_AUTO_LENGTH, schedule, NULL, &fn));
+    NAPI_CHECK(env, napi_set_named_property(env, exports, "schedule", fn));
+    NAPI_CHECK(env, napi_create_function(env, "cacheStats", NAPI_AUTO_LENGTH, cacheStats, NULL,
+                                         &fn));
+    NAPI_CHECK(env, napi_set_named_property(env, exports, "cacheStats", fn));
+    NAPI_CHECK(env, napi_create_function(env, "setCacheLimit", NAPI_AUTO_LENGTH, setCacheLimit,
+                                         NULL, &fn));
+    NAPI_CHECK(env, napi_set_named_property(env, exports, "setCacheLimit", fn));
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "core/arena.h"
+#include "core/emit.h"
+#include "core/farm.h"
+#include "core/latency.h"
+#include "core/network.h"
+#include "core/serve.h"
+
+// Pump- and pipe-constrained scheduler: the DP objective with water routed
+// through the request's "network", as a min-cost flow (see core/network.h).
+typedef struct {
+    int reportStats;
+    ServeOptions serve;
+} SchedulerOptions;
+
+int generateOutput(FILE *out, const IrrigationData *data, OutputFormat format) {
+    if (!data) {
+        fprintf(out, "{\"error\":\"Invalid data\"}\n");
+        return 0;
+    }
+    return emitSchedule(out, data, NULL, "NetworkFlow", 0, format);
+}
+
+static void reportStats(const IrrigationData *data, const WaterNetwork *network,
+                        const NetworkStats *stats, double wallMs) {
+    double gap = stats->relaxedScore > 0
+                     ? (double)(stats->relaxedScore - stats->bestScore) / stats->relaxedScore
+                     : 0.0;
+    fprintf(stderr,
+            "network_stats fields=%d water=%d network=%d pumps=%d pipes=%d nodes=%d "
+            "searches=%d augments=%d cut_off=%d below_minimum=%d relaxed_score=%lld "
+            "best_score=%lld gap=%.6f exact=%d wall_ms=%.3f\n",
+            data->fieldCount, data->totalWater, stats->present, network->pumpCount,
+            network->pipeCount, network->nodeCount, stats->searches, stats->augments,
+            stats->cutOff, stats->belowMinimum, (long long)stats->relaxedScore,
+            (long long)stats->bestScore, gap, stats->exact, wallMs);
+}
+
+int handleRequest(const char *input, size_t length, FILE *out, Arena *arena, void *context) {
+    const SchedulerOptions *options = context;
+    IrrigationData data;
+    WaterNetwork network;
+    NetworkStats stats;
+    if (!parseIrrigationInput(input, length, &data, arena) ||
+        !parseWaterNetwork(input, length, &data, &network, arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    uint64_t start = monotonicMicros();
+    if (!networkSchedule(&data, &network, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for the network\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    double wallMs = (monotonicMicros() - start) / 1000.0;
+    if (!generateOutput(out, &data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->reportStats) reportStats(&data, &network, &stats, wallMs);
+    return 1;
+}
+
+static int parseOptions(int argc, char **argv, SchedulerOptions *options) {
+    options->reportStats = 0;
+    serveOptionsInit(&options->serve);
+    for (int i = 1; i < argc; i++) {
+        if (parseServeOption(argc, argv, &i, &options->serve)) {
+            continue;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options->reportStats = 1;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
+        }
+    }
+    if (options->serve.snapshotPath) {
+        // A snapshot has no network, and a delta names no mains
+        fprintf(stderr, "Error: The network scheduler takes full requests, not --snapshot\n");
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    SchedulerOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printf("{\"error\":\"Invalid command line options\"}\n");
+        return 1;
+    }
+    return runScheduler(&options.serve, handleRequest, &options);
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "core/arena.h"
+#include "core/emit.h"
+#include "core/farm.h"
+#include "core/latency.h"
+#include "core/power.h"
+#include "core/serve.h"
+
+// Water- and electricity-constrained scheduler: the DP objective under both
+// budgets, through a Lagrangian multiplier search (see core/power.h).
+typedef struct {
+    PowerOptions search;
+    int reportStats;
+    ServeOptions serve;
+} SchedulerOptions;
+
+int generateOutput(FILE *out, const IrrigationData *data, OutputFormat format) {
+    if (!data) {
+        fprintf(out, "{\"error\":\"Invalid data\"}\n");
+        return 0;
+    }
+    return emitSchedule(out, data, NULL, "PowerConstrainedDP", data->useTimeConstraints, format);
+}
+
+// Gap between the dual bound and the score, relative to the bound.
+static double relativeGap(Score bound, Score score) {
+    return bound > 0 ? (double)(bound - score) / (double)bound : 0.0;
+}
+
+static void reportStats(const IrrigationData *data, const PowerStats *stats, double wallMs) {
+    fprintf(stderr,
+            "power_stats fields=%d water=%d electricity=%d constrained=%d iterations=%d "
+            "multiplier=%.6f water_only_score=%lld dual_bound=%lld best_score=%lld "
+            "time_used=%d gap=%.6f exact=%d peak_table_bytes=%zu wall_ms=%.3f\n",
+            data->fieldCount, data->totalWater, data->totalElectricity, stats->constrained,
+            stats->iterations, (double)stats->multiplier / (double)(1ll << SCORE_SHIFT),
+            (long long)stats->waterOnlyScore, (long long)stats->dualBound,
+            (long long)stats->bestScore, stats->timeUsed,
+            relativeGap(stats->dualBound, stats->bestScore), stats->exact,
+            stats->peakTableBytes, wallMs);
+}
+
+int handleRequest(const char *input, size_t length, FILE *out, Arena *arena, void *context) {
+    const SchedulerOptions *options = context;
+    IrrigationData data;
+    PowerStats stats;
+    if (!parseServedInput(input, length, &data, arena)) {
+        fprintf(stderr, "Error: Failed to parse input JSON\n");
+        fprintf(out, "{\"error\":\"Failed to parse input JSON\"}\n");
+        return 0;
+    }
+    uint64_t start = monotonicMicros();
+    if (!powerSchedule(&data, &options->search, arena, &stats)) {
+        fprintf(stderr, "Error: Out of memory for DP tables\n");
+        fprintf(out, "{\"error\":\"Out of memory\"}\n");
+        return 0;
+    }
+    double wallMs = (monotonicMicros() - start) / 1000.0;
+    if (!generateOutput(out, &data, serveOutputFormat(&options->serve))) {
+        fprintf(stderr, "Error: Failed to write output\n");
+        return 0;
+    }
+    if (options->reportStats) reportStats(&data, &stats, wallMs);
+    return 1;
+}
+
+static int parseOptions(int argc, char **argv, SchedulerOptions *options) {
+    powerOptionsInit(&options->search);
+    options->reportStats = 0;
+    serveOptionsInit(&options->serve);
+    for (int i = 1; i < argc; i++) {
+        if (parseServeOption(argc, argv, &i, &options->serve)) {
+            continue;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options->search.maxIterations = atoi(argv[++i]);
+            if (options->search.maxIterations < 1) {
+                fprintf(stderr, "Error: Iteration limit must be at least 1\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc) {
+            options->search.gapTolerance = atof(argv[++i]);
+            if (options->search.gapTolerance < 0 || options->search.gapTolerance >= 1) {
+                fprintf(stderr, "Error: Gap tolerance must be at least 0 and below 1\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options->reportStats = 1;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    SchedulerOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printf("{\"error\":\"Invalid command line options\"}\n");
+        return 1;
+    }
+    return runScheduler(&options.serve, handleRequest, &options);
+}
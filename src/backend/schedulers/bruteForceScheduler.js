@@ -29,7 +29,7 @@ function parseInput(input) {
     return null
   }
 
-  if (data.fieldCount <= 0 || data.fieldCount > 10) {
+  if (data.fieldCount <= 0) {
     console.error("Error: Invalid field count:", data.fieldCount)
     return null
   }
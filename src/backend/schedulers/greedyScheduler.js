@@ -41,7 +41,7 @@ function parseInput(input) {
     data.waterDeliveryRate = 50
   }
 
-  if (data.fieldCount <= 0 || data.fieldCount > 10) {
+  if (data.fieldCount <= 0) {
     console.error("Error: Invalid field count:", data.fieldCount)
     return null
   }
@@ -3,6 +3,7 @@ import cors from "cors"
 import path from "path"
 import { fileURLToPath } from "url"
 import fs from "fs"
+import { createRequire } from "module"
 
 // Import algorithm implementations
 import { dpScheduler } from "./schedulers/dpScheduler.js"
@@ -12,6 +13,40 @@ import { bruteForceScheduler } from "./schedulers/bruteForceScheduler.js"
 // Required for ES module support (__dirname)
 const __filename = fileURLToPath(import.meta.url)
 const __dirname = path.dirname(__filename)
+const require = createRequire(import.meta.url)
+
+// Native C schedulers (built with `npm run build:native`). They run on the
+// libuv threadpool, so a long DP request does not block the event loop.
+// Without the addon the JavaScript ports are used instead.
+const loadNativeScheduler = () => {
+  try {
+    const addon = require(path.join(__dirname, "build/Release/smartfarm_scheduler.node"))
+    console.log("⚙️  Using native C schedulers")
+    return addon
+  } catch (error) {
+    console.log("⚠️  Native schedulers not built, using JavaScript ports:", error.message)
+    return null
+  }
+}
+const nativeScheduler = loadNativeScheduler()
+
+// Resubmitted field sets are answered from the native schedule cache.
+// SCHEDULE_CACHE_MB sets its size; 0 turns it off.
+if (nativeScheduler && process.env.SCHEDULE_CACHE_MB !== undefined) {
+  const cacheMb = Number(process.env.SCHEDULE_CACHE_MB)
+  if (Number.isFinite(cacheMb) && cacheMb >= 0) {
+    nativeScheduler.setCacheLimit(Math.floor(cacheMb * 1024 * 1024))
+  } else {
+    console.log("⚠️  Ignoring invalid SCHEDULE_CACHE_MB:", process.env.SCHEDULE_CACHE_MB)
+  }
+}
+
+// technique -> native algorithm name and JavaScript fallback
+const techniques = {
+  greedy: { native: "greedy", port: greedyScheduler },
+  dynamic: { native: "dp", port: dpScheduler },
+  genetic: { native: "bruteForce", port: bruteForceScheduler },
+}
 
 // Initialize app
 const app = express()
@@ -37,13 +72,15 @@ app.use((req, res, next) => {
 app.get("/health", (req, res) => {
   res.json({
     status: "OK",
+    schedulers: nativeScheduler ? "native" : "javascript",
+    cache: nativeScheduler ? nativeScheduler.cacheStats() : null,
     timestamp: new Date().toISOString(),
     environment: process.env.NODE_ENV || "development",
   })
 })
 
 // API route with enhanced error handling
-app.post("/api/schedule", (req, res) => {
+app.post("/api/schedule", async (req, res) => {
   console.log("📨 Received scheduling request:", req.body)
 
   const { technique, ...input } = req.body
@@ -59,24 +96,33 @@ app.post("/api/schedule", (req, res) => {
     return res.status(400).json({ error: "Invalid input data" })
   }
 
+  const scheduler = Object.hasOwn(techniques, technique) ? techniques[technique] : null
+  if (!scheduler) {
+    console.error("❌ Invalid technique:", technique)
+    return res.status(400).json({ error: "Invalid technique specified" })
+  }
+
+  // deadlineMs bounds a native DP run: the best schedule found by then comes
+  // back with "optimal" set if it is proven optimal. The JavaScript port has
+  // no deadline and always runs to the end. The other techniques ignore it,
+  // so it is refused for them.
+  if (input.deadlineMs !== undefined) {
+    if (!(Number.isInteger(input.deadlineMs) && input.deadlineMs > 0)) {
+      console.error("❌ Invalid deadline:", input.deadlineMs)
+      return res.status(400).json({ error: "deadlineMs must be a positive integer" })
+    }
+    if (scheduler.native !== "dp") {
+      console.error("❌ Deadline given for technique:", technique)
+      return res.status(400).json({ error: "deadlineMs is only supported by the dynamic technique" })
+    }
+  }
+
   try {
-    let result
     console.log(`🔄 Processing with technique: ${technique}`)
 
-    switch (technique) {
-      case "greedy":
-        result = greedyScheduler(input)
-        break
-      case "dynamic":
-        result = dpScheduler(input)
-        break
-      case "genetic":
-        result = bruteForceScheduler(input)
-        break
-      default:
-        console.error("❌ Invalid technique:", technique)
-        return res.status(400).json({ error: "Invalid technique specified" })
-    }
+    const result = nativeScheduler
+      ? await nativeScheduler.schedule(scheduler.native, input)
+      : scheduler.port(input)
 
     console.log("✅ Scheduling completed successfully")
     res.json(result)